@@ -0,0 +1,182 @@
+// image decode benchmark: times Surface::FromFile on every image in the Images
+// directory (portable png / jpeg / bmp / tga decoders), and on the same pixels
+// saved as raw .bgra, which is mapped and used in place
+// (best and median of a number of loads, the file stays in the page cache)
+// fails if any image does not load, every bundled asset has to decode on every
+// platform (ctest runs one load of each as decode_images)
+#include "../Engine/Surface.h"
+#include "../Engine/ChiliException.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double,std::milli> Millis;
+
+	struct Options
+	{
+		std::string image;
+		unsigned int nRuns = 20u;
+		bool raw = true;
+	};
+
+	struct Timing
+	{
+		double bestMs;
+		double medianMs;
+	};
+
+	void PrintUsage()
+	{
+		std::cout <<
+			"usage: decode_bench [options]\n"
+			"  --image <name>        only this file of the Images directory\n"
+			"  --runs <n>            loads per image (20)\n"
+			"  --no-raw              skip the .bgra loads\n"
+			"  --data <dir>          directory that holds Images\n";
+	}
+
+	// loads the file nRuns times, the surface is dropped right away like a
+	// texture that failed to stay in the cache would be
+	Timing TimeLoads( const std::filesystem::path& path,unsigned int nRuns,unsigned int& width,unsigned int& height )
+	{
+		std::vector<double> times;
+		times.reserve( nRuns );
+		for( unsigned int i = 0; i < nRuns; i++ )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			const Surface surface = Surface::FromFile( path.wstring() );
+			times.push_back( Millis( std::chrono::steady_clock::now() - start ).count() );
+			width = surface.GetWidth();
+			height = surface.GetHeight();
+		}
+		std::sort( times.begin(),times.end() );
+		return { times.front(),times[times.size() / 2u] };
+	}
+}
+
+int main( int argc,char** argv )
+{
+	Options opts;
+#ifdef CHILI_ASSET_DIR
+	std::string dataDir = CHILI_ASSET_DIR;
+#else
+	std::string dataDir = ".";
+#endif
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if( arg == "--image" && hasValue )
+		{
+			opts.image = argv[++i];
+		}
+		else if( arg == "--runs" && hasValue )
+		{
+			opts.nRuns = std::max( unsigned( std::strtoul( argv[++i],nullptr,10 ) ),1u );
+		}
+		else if( arg == "--no-raw" )
+		{
+			opts.raw = false;
+		}
+		else if( arg == "--data" && hasValue )
+		{
+			dataDir = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	const auto rawDir = std::filesystem::temp_directory_path() / "chili_decode_bench";
+	try
+	{
+		std::vector<std::filesystem::path> images;
+		for( const auto& entry : std::filesystem::directory_iterator( std::filesystem::path( dataDir ) / "Images" ) )
+		{
+			if( entry.is_regular_file() && (opts.image.empty() || entry.path().filename() == opts.image) )
+			{
+				images.push_back( entry.path() );
+			}
+		}
+		if( images.empty() )
+		{
+			std::cerr << "no image [" << opts.image << "] in " << dataDir << "/Images\n";
+			return 1;
+		}
+		std::sort( images.begin(),images.end() );
+		if( opts.raw )
+		{
+			std::filesystem::create_directories( rawDir );
+		}
+
+		std::printf( "%-26s %9s %11s %10s %10s %10s %10s\n","image","file KB","size","best ms","median ms","Mpixel/s","bgra ms" );
+		double totalMs = 0.0;
+		double totalRawMs = 0.0;
+		unsigned int nFailed = 0u;
+		for( const auto& path : images )
+		{
+			unsigned int width = 0u;
+			unsigned int height = 0u;
+			Timing decode{};
+			try
+			{
+				decode = TimeLoads( path,opts.nRuns,width,height );
+			}
+			catch( const ChiliException& e )
+			{
+				std::printf( "%-26s FAILED: %ls\n",path.filename().string().c_str(),e.GetNote().c_str() );
+				nFailed++;
+				continue;
+			}
+			totalMs += decode.bestMs;
+			std::printf( "%-26s %9.1f %5ux%-5u %10.3f %10.3f %10.1f",path.filename().string().c_str(),
+				double( std::filesystem::file_size( path ) ) / 1024.0,width,height,
+				decode.bestMs,decode.medianMs,double( width ) * height / (decode.bestMs * 1000.0) );
+			if( opts.raw )
+			{
+				const auto rawPath = rawDir / (path.stem().string() + ".bgra");
+				Surface::FromFile( path.wstring() ).Save( rawPath.wstring() );
+				const Timing raw = TimeLoads( rawPath,opts.nRuns,width,height );
+				totalRawMs += raw.bestMs;
+				std::printf( " %10.3f",raw.bestMs );
+			}
+			std::printf( "\n" );
+		}
+		std::printf( "%-26s %9s %11s %10.3f %10s %10s",
+			"total","","",totalMs,"","" );
+		if( opts.raw )
+		{
+			std::printf( " %10.3f",totalRawMs );
+		}
+		std::printf( "\n" );
+		if( nFailed > 0u )
+		{
+			std::printf( "%u images failed to load\n",nFailed );
+			std::error_code ec;
+			std::filesystem::remove_all( rawDir,ec );
+			return 1;
+		}
+	}
+	catch( const ChiliException& e )
+	{
+		std::wcerr << e.GetExceptionType() << L": " << e.GetFullMessage() << std::endl;
+		return 1;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "Unhandled STL Exception: " << e.what() << std::endl;
+		return 1;
+	}
+	std::error_code ec;
+	std::filesystem::remove_all( rawDir,ec );
+	return 0;
+}
@@ -0,0 +1,249 @@
+// depth test microbenchmark: per pixel ZBuffer::TestAndSet against depth tests
+// of 4 pixel SIMD blocks, on random horizontal spans like the ones the
+// rasterizer produces (same spans and depths for both paths), the buffer is
+// cleared every spansPerFrame spans (about 3x overdraw)
+// the block tests live here rather than in DepthBuffer: wired into Pipeline's
+// scanline loop they made frames slower (shading still goes pixel by pixel)
+#include "../Engine/ZBuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <emmintrin.h>
+
+namespace
+{
+	constexpr int width = 640;
+	constexpr int height = 480;
+	constexpr size_t spansPerFrame = 20000u;
+
+	struct Span
+	{
+		int x0;
+		int x1;
+		int y;
+		float z;
+		float dz;
+	};
+
+	std::vector<Span> MakeSpans( size_t count )
+	{
+		std::mt19937 rng( 42u );
+		std::uniform_int_distribution<int> start( 0,width - 1 );
+		std::uniform_int_distribution<int> length( 1,96 );
+		std::uniform_int_distribution<int> row( 0,height - 1 );
+		std::uniform_real_distribution<float> depth( 0.0f,1.0f );
+		std::uniform_real_distribution<float> slope( -0.002f,0.002f );
+		std::vector<Span> spans( count );
+		for( auto& s : spans )
+		{
+			s.x0 = start( rng );
+			s.x1 = std::min( s.x0 + length( rng ),width );
+			s.y = row( rng );
+			s.z = depth( rng );
+			s.dz = slope( rng );
+		}
+		return spans;
+	}
+
+	// all ones in the lanes whose bit is set in coverage
+	__m128i CoverageLanes( int coverage )
+	{
+		const __m128i bits = _mm_setr_epi32( 1,2,4,8 );
+		return _mm_cmpeq_epi32( _mm_and_si128( _mm_set1_epi32( coverage ),bits ),bits );
+	}
+
+	// depth test of 4 neighboring pixels for each storage format (bit i of
+	// coverage / the result is pDst[i]), same result as Format::Closer()
+	template<class Format>
+	struct Block4;
+
+	template<>
+	struct Block4<DepthFloat32>
+	{
+		static int TestAndSet( float* pDst,__m128 depths,int coverage )
+		{
+			const __m128 stored = _mm_loadu_ps( pDst );
+			const __m128 pass = _mm_and_ps( _mm_cmplt_ps( depths,stored ),_mm_castsi128_ps( CoverageLanes( coverage ) ) );
+			_mm_storeu_ps( pDst,_mm_or_ps( _mm_and_ps( pass,depths ),_mm_andnot_ps( pass,stored ) ) );
+			return _mm_movemask_ps( pass );
+		}
+	};
+
+	template<>
+	struct Block4<DepthReversedFloat32>
+	{
+		static int TestAndSet( float* pDst,__m128 depths,int coverage )
+		{
+			const __m128 stored = _mm_loadu_ps( pDst );
+			const __m128 pass = _mm_and_ps( _mm_cmpgt_ps( depths,stored ),_mm_castsi128_ps( CoverageLanes( coverage ) ) );
+			_mm_storeu_ps( pDst,_mm_or_ps( _mm_and_ps( pass,depths ),_mm_andnot_ps( pass,stored ) ) );
+			return _mm_movemask_ps( pass );
+		}
+	};
+
+	template<>
+	struct Block4<DepthUnorm16>
+	{
+		static int TestAndSet( unsigned short* pDst,__m128 depths,int coverage )
+		{
+			// same rounding as Encode()
+			const __m128 z = _mm_min_ps( _mm_max_ps( depths,_mm_setzero_ps() ),_mm_set1_ps( 1.0f ) );
+			const __m128i encoded = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( z,_mm_set1_ps( 65535.0f ) ),_mm_set1_ps( 0.5f ) ) );
+			const __m128i stored = _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pDst ) ),_mm_setzero_si128() );
+			const __m128i pass = _mm_and_si128( _mm_cmplt_epi32( encoded,stored ),CoverageLanes( coverage ) );
+			const __m128i result = _mm_or_si128( _mm_and_si128( pass,encoded ),_mm_andnot_si128( pass,stored ) );
+			// back to 16 bits, packing saturates signed so shift the range down and back up
+			const __m128i packed = _mm_packs_epi32( _mm_sub_epi32( result,_mm_set1_epi32( 0x8000 ) ),_mm_setzero_si128() );
+			_mm_storel_epi64( reinterpret_cast<__m128i*>( pDst ),_mm_xor_si128( packed,_mm_set1_epi16( short( -0x8000 ) ) ) );
+			return _mm_movemask_ps( _mm_castsi128_ps( pass ) );
+		}
+	};
+
+	// no packed 24-bit loads, pixel by pixel
+	template<>
+	struct Block4<DepthUnorm24>
+	{
+		static int TestAndSet( DepthUnorm24::Stored* pDst,__m128 depths,int coverage )
+		{
+			float z[4];
+			_mm_storeu_ps( z,depths );
+			int passed = 0;
+			for( int i = 0; i < 4; i++ )
+			{
+				if( coverage & (1 << i) )
+				{
+					const auto d = DepthUnorm24::Encode( z[i] );
+					if( DepthUnorm24::Closer( d,pDst[i] ) )
+					{
+						pDst[i] = d;
+						passed |= 1 << i;
+					}
+				}
+			}
+			return passed;
+		}
+	};
+
+	// depth test of N (4, 8 or 16) pixels of a row starting at x, with x a multiple
+	// of N (so the block lies in one tile of the buffer), bit i of coverage / the
+	// result stands for pixel x + i, returns the pixels that passed
+	// (write pDepths with vector stores, a vector load right after scalar stores
+	// to the same place stalls on store forwarding and eats up the gain)
+	template<int N,class Depth>
+	unsigned int TestAndSetBlock( Depth& zb,int x,int y,const float* pDepths,unsigned int coverage )
+	{
+		static_assert( N == 4 || N == 8 || N == 16,"Bad block size" );
+		auto* const pBlock = &zb.At( x,y );
+		unsigned int passed = 0u;
+		for( int i = 0; i < N; i += 4 )
+		{
+			passed |= (unsigned int)Block4<typename Depth::Format>::TestAndSet( pBlock + i,_mm_loadu_ps( pDepths + i ),int( (coverage >> i) & 0xFu ) ) << i;
+		}
+		return passed;
+	}
+
+	template<class Depth>
+	unsigned long long RunScalar( Depth& zb,const std::vector<Span>& spans )
+	{
+		unsigned long long passed = 0u;
+		for( size_t i = 0; i < spans.size(); i++ )
+		{
+			if( i % spansPerFrame == 0u )
+			{
+				zb.Clear();
+			}
+			const Span& s = spans[i];
+			for( int x = s.x0; x < s.x1; x++ )
+			{
+				passed += zb.TestAndSet( x,s.y,s.z + s.dz * float( x - s.x0 ) ) ? 1u : 0u;
+			}
+		}
+		return passed;
+	}
+
+	template<class Depth>
+	unsigned long long RunBlocks( Depth& zb,const std::vector<Span>& spans )
+	{
+		constexpr int n = 4;
+		unsigned long long passed = 0u;
+		for( size_t i = 0; i < spans.size(); i++ )
+		{
+			if( i % spansPerFrame == 0u )
+			{
+				zb.Clear();
+			}
+			const Span& s = spans[i];
+			// depths computed 4 at a time the same way as in the scalar loop (the
+			// block has to be built in a register, scalar stores followed by a
+			// vector load stall on store forwarding)
+			const __m128 z0 = _mm_set1_ps( s.z );
+			const __m128 dz = _mm_set1_ps( s.dz );
+			const __m128 lanes = _mm_setr_ps( 0.0f,1.0f,2.0f,3.0f );
+			for( int xBlock = s.x0 & ~(n - 1); xBlock < s.x1; xBlock += n )
+			{
+				const int first = std::max( xBlock,s.x0 ) - xBlock;
+				const int last = std::min( xBlock + n,s.x1 ) - xBlock;
+				const unsigned int coverage = ((1u << last) - 1u) & ~((1u << first) - 1u);
+				alignas( 16 ) float depths[n];
+				_mm_store_ps( depths,_mm_add_ps( z0,_mm_mul_ps( dz,_mm_add_ps( _mm_set1_ps( float( xBlock - s.x0 ) ),lanes ) ) ) );
+				const unsigned int mask = TestAndSetBlock<n>( zb,xBlock,s.y,depths,coverage );
+				for( unsigned int m = mask; m != 0u; m &= m - 1u )
+				{
+					passed++;
+				}
+			}
+		}
+		return passed;
+	}
+
+	template<class Depth,class F>
+	double Measure( const char* name,const std::vector<Span>& spans,unsigned long long pixels,F run,unsigned long long& passed )
+	{
+		Depth zb( width,height );
+		double best = 1e30;
+		for( int rep = 0; rep < 10; rep++ )
+		{
+			const auto t0 = std::chrono::steady_clock::now();
+			passed = run( zb,spans );
+			const auto t1 = std::chrono::steady_clock::now();
+			best = std::min( best,std::chrono::duration<double,std::nano>( t1 - t0 ).count() / double( pixels ) );
+		}
+		printf( "  %-8s %6.3f ns/pixel  (%llu passed)\n",name,best,passed );
+		return best;
+	}
+
+	template<class Depth>
+	bool Compare( const char* format,const std::vector<Span>& spans,unsigned long long pixels )
+	{
+		printf( "%s\n",format );
+		unsigned long long passedScalar = 0u;
+		unsigned long long passedBlocks = 0u;
+		const double scalar = Measure<Depth>( "scalar",spans,pixels,[]( Depth& zb,const std::vector<Span>& s ) { return RunScalar( zb,s ); },passedScalar );
+		const double blocks = Measure<Depth>( "block4",spans,pixels,[]( Depth& zb,const std::vector<Span>& s ) { return RunBlocks( zb,s ); },passedBlocks );
+		printf( "  speedup %.2fx\n",scalar / blocks );
+		return passedScalar == passedBlocks;
+	}
+}
+
+int main()
+{
+	const auto spans = MakeSpans( 200000u );
+	unsigned long long pixels = 0u;
+	for( const auto& s : spans )
+	{
+		pixels += (unsigned long long)( s.x1 - s.x0 );
+	}
+	bool ok = true;
+	ok &= Compare<DepthBuffer<DepthFloat32>>( "float32",spans,pixels );
+	ok &= Compare<DepthBuffer<DepthReversedFloat32>>( "reversed float32",spans,pixels );
+	ok &= Compare<DepthBuffer<DepthUnorm16>>( "unorm16",spans,pixels );
+	ok &= Compare<DepthBuffer<DepthUnorm24>>( "unorm24",spans,pixels );
+	if( !ok )
+	{
+		printf( "block and scalar results differ\n" );
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+// vector / matrix microbenchmark: the float products, dot and cross products and
+// normalization of Vec3.h / Vec4.h / Mat.h and the affine Mat4x3 over arrays of random operands
+// built twice, math_bench with the sse specializations and math_bench_scalar
+// with CHILI_SCALAR_MATH (the templates), each operation prints its time and a
+// hash of the bits of its results, which have to match between the two
+#include "../Engine/Mat.h"
+#include "../Engine/Mat4x3.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr size_t count = 4096u;
+#ifdef CHILI_SCALAR_MATH
+	constexpr const char* mode = "scalar templates";
+#else
+	constexpr const char* mode = "sse specializations";
+#endif
+
+	// fnv-1a over the bytes of the results
+	template<typename T>
+	unsigned long long Hash( const std::vector<T>& results )
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for( const T& r : results )
+		{
+			unsigned char bytes[sizeof( T )];
+			memcpy( bytes,&r,sizeof( T ) );
+			for( const unsigned char b : bytes )
+			{
+				hash = (hash ^ b) * 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	constexpr int nRuns = 7;
+
+	// runs op over all operands repetitions times, nRuns times over, prints ns
+	// per operation of the fastest run (the others are mostly noise from the machine)
+	template<typename R,typename F>
+	void Run( const char* name,unsigned int repetitions,F op )
+	{
+		std::vector<R> results( count );
+		double best = 0.0;
+		for( int run = 0; run < nRuns; run++ )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for( unsigned int r = 0; r < repetitions; r++ )
+			{
+				// operands shifted every repetition so the compiler can't hoist the work
+				for( size_t i = 0; i < count; i++ )
+				{
+					results[i] = op( (i + r) % count );
+				}
+			}
+			const std::chrono::duration<double,std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			const double ns = elapsed.count() / (double( repetitions ) * double( count ));
+			best = run == 0 ? ns : std::min( best,ns );
+		}
+		std::printf( "%-24s %8.3f ns/op   results %016llx\n",name,best,Hash( results ) );
+	}
+}
+
+int main( int argc,char** argv )
+{
+	const unsigned int repetitions = argc > 1 ? unsigned( std::strtoul( argv[1],nullptr,10 ) ) : 500u;
+	std::mt19937 rng( 42u );
+	std::uniform_real_distribution<float> dist( -10.0f,10.0f );
+	const auto Random = [&]()
+	{
+		return dist( rng );
+	};
+	std::vector<Vec3> v3( count );
+	std::vector<Vec4> v4( count );
+	std::vector<Mat3> m3( count );
+	std::vector<Mat4> m4( count );
+	std::vector<Mat4x3> a4( count );
+	for( size_t i = 0; i < count; i++ )
+	{
+		v3[i] = { Random(),Random(),Random() };
+		v4[i] = { Random(),Random(),Random(),Random() };
+		for( auto& row : m3[i].elements )
+		{
+			for( float& e : row )
+			{
+				e = Random();
+			}
+		}
+		for( auto& row : m4[i].elements )
+		{
+			for( float& e : row )
+			{
+				e = Random();
+			}
+		}
+		for( auto& row : a4[i].elements )
+		{
+			for( float& e : row )
+			{
+				e = Random();
+			}
+		}
+	}
+	// neighbouring operands for the binary operations
+	const auto Next = []( size_t i )
+	{
+		return (i + 1u) % count;
+	};
+
+	std::printf( "math_bench: %s, %zu operands x %u\n",mode,count,repetitions );
+	Run<Mat4>( "Mat4 * Mat4",repetitions,[&]( size_t i )
+	{
+		return m4[i] * m4[Next( i )];
+	} );
+	Run<Mat3>( "Mat3 * Mat3",repetitions,[&]( size_t i )
+	{
+		return m3[i] * m3[Next( i )];
+	} );
+	Run<Vec4>( "Vec4 * Mat4",repetitions,[&]( size_t i )
+	{
+		return v4[i] * m4[i];
+	} );
+	Run<Vec3>( "Vec3 * Mat3",repetitions,[&]( size_t i )
+	{
+		return v3[i] * m3[i];
+	} );
+	// affine world / view transforms (Mat4x3.h)
+	Run<Mat4x3>( "Mat4x3 * Mat4x3",repetitions,[&]( size_t i )
+	{
+		return a4[i] * a4[Next( i )];
+	} );
+	Run<Mat4>( "Mat4x3 * Mat4",repetitions,[&]( size_t i )
+	{
+		return a4[i] * m4[i];
+	} );
+	Run<Vec4>( "Vec4 * Mat4x3",repetitions,[&]( size_t i )
+	{
+		return v4[i] * a4[i];
+	} );
+	Run<float>( "Vec3 * Vec3 (dot)",repetitions,[&]( size_t i )
+	{
+		return v3[i] * v3[Next( i )];
+	} );
+	Run<Vec3>( "Vec3 % Vec3 (cross)",repetitions,[&]( size_t i )
+	{
+		return v3[i] % v3[Next( i )];
+	} );
+	Run<Vec3>( "Vec3::GetNormalized",repetitions,[&]( size_t i )
+	{
+		return v3[i].GetNormalized();
+	} );
+	return 0;
+}
\ No newline at end of file
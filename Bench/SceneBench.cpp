@@ -0,0 +1,321 @@
+// scene benchmark: drives every scene with scripted camera input and a fixed
+// time step for a number of frames on the headless Graphics, reports frame time
+// percentiles and vertex / triangle / fragment throughput per scene and per
+// effect, optionally as json to track regressions across commits
+// (always built with CHILI_PIPELINE_STATS, the counting is part of the frame times)
+#include "../Engine/Graphics.h"
+#include "../Engine/Scenes.h"
+#include "../Engine/InputScript.h"
+#include "../Engine/PipelineStats.h"
+#include "../Engine/JobSystem.h"
+#include "../Engine/ChiliException.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double,std::milli> Millis;
+
+	struct Options
+	{
+		std::string scene;
+		unsigned int nFrames = 240u;
+		unsigned int nWarmup = 20u;
+		float dt = 1.0f / 60.0f;
+		std::string json;
+		std::string label;
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		// frame times in ms, sorted
+		std::vector<double> frameTimes;
+		double totalMs = 0.0;
+		std::vector<PipelineStats::Entry> effects;
+	};
+
+	void PrintUsage()
+	{
+		std::cout <<
+			"usage: scene_bench [options]\n"
+			"  --scene <index|name>  scene to run (all of them by default)\n"
+			"  --frames <n>          frames to time per scene (240)\n"
+			"  --warmup <n>          untimed frames before those (20)\n"
+			"  --dt <seconds>        fixed time step of the scene updates (1/60)\n"
+			"  --json <file>         write the results as json\n"
+			"  --label <text>        stored with the json results (commit, machine...)\n"
+			"  --data <dir>          directory the asset paths are relative to\n";
+	}
+
+	double Percentile( const std::vector<double>& sorted,double p )
+	{
+		if( sorted.empty() )
+		{
+			return 0.0;
+		}
+		const size_t i = std::min( size_t( p * double( sorted.size() - 1u ) + 0.5 ),sorted.size() - 1u );
+		return sorted[i];
+	}
+
+	double PerSecond( unsigned long long count,double ms )
+	{
+		return ms > 0.0 ? double( count ) * 1000.0 / ms : 0.0;
+	}
+
+	std::string Escape( const std::string& s )
+	{
+		std::string escaped;
+		for( const char c : s )
+		{
+			if( c == '"' || c == '\\' )
+			{
+				escaped.push_back( '\\' );
+			}
+			escaped.push_back( c );
+		}
+		return escaped;
+	}
+
+	void WriteStages( std::ostream& out,const PipelineStatistics& s )
+	{
+		out << "{ \"vertices_shaded\": " << s.verticesShaded
+			<< ", \"triangles_assembled\": " << s.trianglesAssembled
+			<< ", \"back_face_culled\": " << s.backFaceCulled
+			<< ", \"frustum_culled\": " << s.frustumCulled
+			<< ", \"near_clipped1\": " << s.nearClipped1
+			<< ", \"near_clipped2\": " << s.nearClipped2
+			<< ", \"triangles_rasterized\": " << s.trianglesRasterized
+			<< ", \"fragments_tested\": " << s.fragmentsTested
+			<< ", \"fragments_passed\": " << s.fragmentsPassed
+			<< ", \"ps_invocations\": " << s.psInvocations << " }";
+	}
+
+	// runs the frames of Game::Go back to back, returns the time of each frame
+	// (the scene updates while the present thread outputs the last frame, like the game does)
+	std::vector<double> RunFrames( Graphics& gfx,Scene& scene,const InputScript& script,unsigned int firstFrame,unsigned int nFrames,float dt,Keyboard& kbd,Mouse& mouse )
+	{
+		std::vector<double> frameTimes;
+		frameTimes.reserve( nFrames );
+		auto last = std::chrono::steady_clock::now();
+		for( unsigned int i = 0; i < nFrames; i++ )
+		{
+			script.Apply( firstFrame + i,kbd,mouse );
+			scene.Update( kbd,mouse,dt );
+			scene.Interpolate( 1.0f );
+			gfx.BeginFrame();
+			scene.Draw();
+			gfx.EndFrame();
+			if( i + 1u == nFrames )
+			{
+				gfx.Flush();
+			}
+			const auto now = std::chrono::steady_clock::now();
+			frameTimes.push_back( Millis( now - last ).count() );
+			last = now;
+		}
+		return frameTimes;
+	}
+
+	void WriteJson( const std::string& filename,const Options& opts,const std::vector<SceneResult>& results )
+	{
+		std::ofstream file( filename );
+		if( !file )
+		{
+			throw std::runtime_error( "cannot open " + filename );
+		}
+		file.precision( 9 );
+		file << "{\n";
+		file << "\t\"label\": \"" << Escape( opts.label ) << "\",\n";
+		file << "\t\"frames\": " << opts.nFrames << ",\n";
+		file << "\t\"warmup\": " << opts.nWarmup << ",\n";
+		file << "\t\"dt\": " << opts.dt << ",\n";
+		file << "\t\"workers\": " << JobSystem::Get().GetWorkerCount() << ",\n";
+		file << "\t\"scenes\": [";
+		for( size_t s = 0; s < results.size(); s++ )
+		{
+			const auto& r = results[s];
+			DrawCounters total;
+			for( const auto& e : r.effects )
+			{
+				total += e.counters;
+			}
+			file << (s > 0u ? "," : "") << "\n\t\t{\n";
+			file << "\t\t\t\"name\": \"" << Escape( r.name ) << "\",\n";
+			file << "\t\t\t\"total_ms\": " << r.totalMs << ",\n";
+			file << "\t\t\t\"frame_ms\": { \"mean\": " << r.totalMs / double( std::max( r.frameTimes.size(),size_t( 1u ) ) )
+				<< ", \"min\": " << Percentile( r.frameTimes,0.0 )
+				<< ", \"p50\": " << Percentile( r.frameTimes,0.5 )
+				<< ", \"p90\": " << Percentile( r.frameTimes,0.9 )
+				<< ", \"p99\": " << Percentile( r.frameTimes,0.99 )
+				<< ", \"max\": " << Percentile( r.frameTimes,1.0 ) << " },\n";
+			file << "\t\t\t\"vertices_per_s\": " << PerSecond( total.vertices,r.totalMs ) << ",\n";
+			file << "\t\t\t\"triangles_per_s\": " << PerSecond( total.triangles,r.totalMs ) << ",\n";
+			file << "\t\t\t\"fragments_per_s\": " << PerSecond( total.fragments,r.totalMs ) << ",\n";
+			file << "\t\t\t\"effects\": [";
+			for( size_t i = 0; i < r.effects.size(); i++ )
+			{
+				const auto& c = r.effects[i].counters;
+				const double drawMs = Millis( c.time ).count();
+				file << (i > 0u ? "," : "") << "\n\t\t\t\t{ \"effect\": \"" << Escape( r.effects[i].effect ) << "\""
+					<< ", \"draws\": " << c.draws
+					<< ", \"vertices\": " << c.vertices
+					<< ", \"triangles\": " << c.triangles
+					<< ", \"fragments\": " << c.fragments
+					<< ", \"draw_ms\": " << drawMs
+					<< ", \"vertices_per_s\": " << PerSecond( c.vertices,drawMs )
+					<< ", \"triangles_per_s\": " << PerSecond( c.triangles,drawMs )
+					<< ", \"fragments_per_s\": " << PerSecond( c.fragments,drawMs );
+				if constexpr( pipelineStatsEnabled )
+				{
+					file << ", \"stages\": ";
+					WriteStages( file,c.stages );
+				}
+				file << " }";
+			}
+			file << "\n\t\t\t]\n\t\t}";
+		}
+		file << "\n\t]\n}\n";
+	}
+}
+
+int main( int argc,char** argv )
+{
+	Options opts;
+#ifdef CHILI_ASSET_DIR
+	std::string dataDir = CHILI_ASSET_DIR;
+#else
+	std::string dataDir;
+#endif
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if( arg == "--scene" && hasValue )
+		{
+			opts.scene = argv[++i];
+		}
+		else if( arg == "--frames" && hasValue )
+		{
+			opts.nFrames = unsigned( std::strtoul( argv[++i],nullptr,10 ) );
+		}
+		else if( arg == "--warmup" && hasValue )
+		{
+			opts.nWarmup = unsigned( std::strtoul( argv[++i],nullptr,10 ) );
+		}
+		else if( arg == "--dt" && hasValue )
+		{
+			opts.dt = std::strtof( argv[++i],nullptr );
+		}
+		else if( arg == "--json" && hasValue )
+		{
+			// before changing to the data directory
+			opts.json = std::filesystem::absolute( argv[++i] ).string();
+		}
+		else if( arg == "--label" && hasValue )
+		{
+			opts.label = argv[++i];
+		}
+		else if( arg == "--data" && hasValue )
+		{
+			dataDir = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	try
+	{
+		if( !dataDir.empty() )
+		{
+			std::filesystem::current_path( dataDir );
+		}
+		Graphics gfx;
+		auto scenes = MakeScenes( gfx );
+		std::vector<SceneResult> results;
+		for( size_t s = 0; s < scenes.size(); s++ )
+		{
+			Scene& scene = *scenes[s];
+			if( !opts.scene.empty() && opts.scene != std::to_string( s ) && opts.scene != scene.GetName() )
+			{
+				continue;
+			}
+			// fresh input state for every scene, the script runs across warmup and timed frames
+			Keyboard kbd;
+			Mouse mouse;
+			const auto script = InputScript::Flythrough( opts.nWarmup + opts.nFrames );
+			RunFrames( gfx,scene,script,0u,opts.nWarmup,opts.dt,kbd,mouse );
+			PipelineStats::Get().Reset();
+			SceneResult result;
+			result.name = scene.GetName();
+			result.frameTimes = RunFrames( gfx,scene,script,opts.nWarmup,opts.nFrames,opts.dt,kbd,mouse );
+			result.effects = PipelineStats::Get().Collect();
+			for( const double t : result.frameTimes )
+			{
+				result.totalMs += t;
+			}
+			std::sort( result.frameTimes.begin(),result.frameTimes.end() );
+
+			DrawCounters total;
+			for( const auto& e : result.effects )
+			{
+				total += e.counters;
+			}
+			std::printf( "%s\n  frame ms: mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n"
+				"  per second: %.3g vertices  %.3g triangles  %.3g fragments\n",
+				result.name.c_str(),result.totalMs / double( std::max( opts.nFrames,1u ) ),
+				Percentile( result.frameTimes,0.5 ),Percentile( result.frameTimes,0.9 ),
+				Percentile( result.frameTimes,0.99 ),Percentile( result.frameTimes,1.0 ),
+				PerSecond( total.vertices,result.totalMs ),PerSecond( total.triangles,result.totalMs ),
+				PerSecond( total.fragments,result.totalMs ) );
+			for( const auto& e : result.effects )
+			{
+				const double drawMs = Millis( e.counters.time ).count();
+				std::printf( "    %-72.72s %8.2f ms in %6llu draws  %.3g vtx/s  %.3g tri/s  %.3g frag/s\n",
+					e.effect.c_str(),drawMs,e.counters.draws,
+					PerSecond( e.counters.vertices,drawMs ),PerSecond( e.counters.triangles,drawMs ),
+					PerSecond( e.counters.fragments,drawMs ) );
+				if constexpr( pipelineStatsEnabled )
+				{
+					const auto& st = e.counters.stages;
+					std::printf( "      %llu vertices, %llu triangles: %llu back face / %llu frustum culled, %llu / %llu near clipped (1 / 2 behind), %llu rasterized\n"
+						"      %llu fragments tested, %llu passed depth, %llu ps invocations\n",
+						st.verticesShaded,st.trianglesAssembled,st.backFaceCulled,st.frustumCulled,
+						st.nearClipped1,st.nearClipped2,st.trianglesRasterized,
+						st.fragmentsTested,st.fragmentsPassed,st.psInvocations );
+				}
+			}
+			results.push_back( std::move( result ) );
+		}
+		if( results.empty() )
+		{
+			std::cerr << "no scene [" << opts.scene << "]\n";
+			return 1;
+		}
+		if( !opts.json.empty() )
+		{
+			WriteJson( opts.json,opts,results );
+		}
+	}
+	catch( const ChiliException& e )
+	{
+		std::wcerr << e.GetExceptionType() << L": " << e.GetFullMessage() << std::endl;
+		return 1;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "Unhandled STL Exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 #include "Colors.h"
 #include "Vec3.h"
+#include "ShaderMath.h"
+#include "TiledLightList.h"
 
+// each params struct can pick the math precision of its term (see ShaderMath.h)
 struct DefaultPointDiffuseParams
 {
+	typedef FastMath Math;
 	static constexpr float linear_attenuation = 1.0f;
 	static constexpr float quadradic_attenuation = 2.619f;
 	static constexpr float constant_attenuation = 0.382f;
@@ -11,6 +15,7 @@ struct DefaultPointDiffuseParams
 
 struct DefaultSpecularParams
 {
+	typedef FastMath Math;
 	static constexpr float specular_power = 30.0f;
 	static constexpr float specular_intensity = 0.6f;
 };
@@ -18,28 +23,55 @@ struct DefaultSpecularParams
 template<class PointDiffuse = DefaultPointDiffuseParams,class Specular = DefaultSpecularParams>
 class BasePhongShader
 {
+	typedef typename ShaderMathOf<PointDiffuse>::Type DiffuseMath;
+	typedef typename ShaderMathOf<Specular>::Type SpecularMath;
+	struct SpecularPower
+	{
+		static constexpr float value = Specular::specular_power;
+	};
 public:
 	template<class Input>
 	Color Shade( const Input& in,const Vec3& material_color ) const
 	{
-		// re-normalize interpolated surface normal
-		const auto surf_norm = in.n.GetNormalized();
-		// vertex to light data
-		const auto v_to_l = light_pos - in.worldPos;
-		const auto dist = v_to_l.Len();
-		const auto dir = v_to_l / dist;
-		// calculate attenuation
-		const auto attenuation = 1.0f /
-			(PointDiffuse::constant_attenuation + PointDiffuse::linear_attenuation * dist + PointDiffuse::quadradic_attenuation * sq( dist ));
-		// calculate intensity based on angle of incidence and attenuation
-		const auto d = light_diffuse * attenuation * std::max( 0.0f,surf_norm * dir );
-		// reflected light vector
-		const auto w = surf_norm * (v_to_l * surf_norm);
-		const auto r = w * 2.0f - v_to_l;
-		// calculate specular intensity based on angle between viewing vector and reflection vector, narrow with power function
-		const auto s = light_diffuse * Specular::specular_intensity * std::pow( std::max( 0.0f,-r.GetNormalized() * in.worldPos.GetNormalized() ),Specular::specular_power );
+		// everything below is expressed in dot products of the raw (unnormalized)
+		// interpolated normal n, vertex to light vector l and view position p
+		// so the normalizations collapse into a few independent rsqrts
+		// (n and p terms are shared by all lights of the pixel)
+		const auto nn = in.n * in.n;
+		const auto pp = in.worldPos * in.worldPos;
+		const auto np = in.n * in.worldPos;
+		const PixelTerms px = {
+			in.n,
+			in.worldPos,
+			DiffuseMath::RSqrt( nn ),
+			SpecularMath::Rcp( nn ),
+			SpecularMath::RSqrt( pp ),
+			np
+		};
+		auto lit = light_ambient;
+		if( pLightList )
+		{
+			// lights of the tile, specular is attenuated here as well
+			// (otherwise it would not fade out within the light radius)
+			for( const auto& l : pLightList->GetTileLights( int( in.pos.x ),int( in.pos.y ) ) )
+			{
+				const auto v_to_l = l.pos - in.worldPos;
+				const auto ll = v_to_l * v_to_l;
+				if( ll < l.radiusSq )
+				{
+					const auto t = Light( px,v_to_l,ll );
+					lit += l.color * (t.attenuation * (t.diffuse + t.specular));
+				}
+			}
+		}
+		else
+		{
+			const auto v_to_l = light_pos - in.worldPos;
+			const auto t = Light( px,v_to_l,v_to_l * v_to_l );
+			lit += light_diffuse * (t.attenuation * t.diffuse + t.specular);
+		}
 		// add diffuse+ambient, filter by material color, saturate and scale
-		return Color( material_color.GetHadamard( d + light_ambient + s ).Saturate() * 255.0f );
+		return Color( material_color.GetHadamard( lit ).Saturate() * 255.0f );
 	}
 	void SetDiffuseLight( const Vec3& c )
 	{
@@ -53,7 +85,52 @@ public:
 	{
 		light_pos = pos_in;
 	}
+	// shade with the lights of a tiled list instead of the single light
+	// (the list must be built for the frame being drawn, nullptr to go back)
+	void SetLightList( const TiledLightList<PointDiffuse>* pList )
+	{
+		pLightList = pList;
+	}
+private:
+	struct PixelTerms
+	{
+		const Vec3& n;
+		const Vec3& p;
+		float n_rlen;
+		float n_rlen_sq;
+		float p_rlen;
+		float np;
+	};
+	struct LightTerms
+	{
+		float attenuation;
+		float diffuse;
+		float specular;
+	};
+	LightTerms Light( const PixelTerms& px,const Vec3& v_to_l,float ll ) const
+	{
+		const auto nl = px.n * v_to_l;
+		const auto lp = v_to_l * px.p;
+		const auto l_rlen = DiffuseMath::RSqrt( ll );
+		// calculate attenuation
+		const auto dist = ll * l_rlen;
+		const auto attenuation = DiffuseMath::Rcp(
+			PointDiffuse::constant_attenuation + dist * (PointDiffuse::linear_attenuation + PointDiffuse::quadradic_attenuation * dist) );
+		// calculate intensity based on angle of incidence
+		const auto cos_nl = nl * l_rlen * px.n_rlen;
+		// specular intensity based on angle between viewing vector and reflection vector, narrow with power function
+		// reflection of l about the normal is r = 2(l.n)n / n.n - l, which has the length of l, so
+		// -r.p / (|r||p|) = (l.p - 2(l.n)(n.p) / n.n) / (|l||p|)
+		const auto r_dot_v = lp - 2.0f * nl * px.np * px.n_rlen_sq;
+		const auto cos_rv = r_dot_v > 0.0f ? r_dot_v * l_rlen * px.p_rlen : 0.0f;
+		return {
+			attenuation,
+			std::max( 0.0f,cos_nl ),
+			Specular::specular_intensity * ConstPow<SpecularMath,SpecularPower>( cos_rv )
+		};
+	}
 private:
+	const TiledLightList<PointDiffuse>* pLightList = nullptr;
 	Vec3 light_pos = { 0.0f,0.0f,0.5f };
 	Vec3 light_diffuse = { 1.0f,1.0f,1.0f };
 	Vec3 light_ambient = { 0.1f,0.1f,0.1f };
@@ -1,4 +1,5 @@
 #pragma once
+#include "Mat4x3.h"
 
 template<class Vertex>
 class BaseVertexShader
@@ -6,7 +7,8 @@ class BaseVertexShader
 public:
 	typedef Vertex Output;
 public:
-	void BindWorldView( const Mat4& transformation_in )
+	// world and view are affine, the full 4x4 math only comes in with the projection
+	void BindWorldView( const Mat4x3& transformation_in )
 	{
 		worldView = transformation_in;
 		worldViewProj = worldView * proj;
@@ -20,8 +22,12 @@ public:
 	{
 		return proj;
 	}
+	const Mat4x3& GetWorldView() const
+	{
+		return worldView;
+	}
 protected:
 	Mat4 proj = Mat4::Identity();
-	Mat4 worldView = Mat4::Identity();
+	Mat4x3 worldView = Mat4x3::Identity();
 	Mat4 worldViewProj = Mat4::Identity();
 };
\ No newline at end of file
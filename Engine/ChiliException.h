@@ -21,6 +21,12 @@
 #pragma once
 #include <string>
 
+// the msvc crt provides this, other toolchains need it spelled out
+#ifndef _CRT_WIDE
+#define _CRT_WIDE_( s ) L ## s
+#define _CRT_WIDE( s ) _CRT_WIDE_( s )
+#endif
+
 class ChiliException
 {
 public:
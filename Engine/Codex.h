@@ -0,0 +1,207 @@
+#pragma once
+
+#include "Surface.h"
+#include "CompressedSurface.h"
+#include "IndexedTriangleList.h"
+#include "MappedFile.h"
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+// loader policies tell the codex how to create an asset from a file
+// and how many bytes it occupies (for budget accounting)
+template<class T>
+struct AssetLoader;
+
+template<>
+struct AssetLoader<Surface>
+{
+	static Surface Load( const std::wstring& path )
+	{
+		return Surface::FromFile( path );
+	}
+	static size_t GetSize( const Surface& s )
+	{
+		return size_t( s.GetPitch() ) * s.GetHeight() * sizeof( Color );
+	}
+};
+
+// textures compressed at load time (BC1, or BC3 if they have alpha)
+template<>
+struct AssetLoader<CompressedSurface>
+{
+	static CompressedSurface Load( const std::wstring& path )
+	{
+		return CompressedSurface( Surface::FromFile( path ) );
+	}
+	static size_t GetSize( const CompressedSurface& s )
+	{
+		return s.GetSizeBytes();
+	}
+};
+
+// loads position-only meshes
+template<class V>
+struct AssetLoader<IndexedTriangleList<V>>
+{
+	static IndexedTriangleList<V> Load( const std::wstring& path )
+	{
+		return IndexedTriangleList<V>::Load( ToNarrowPath( path ) );
+	}
+	static size_t GetSize( const IndexedTriangleList<V>& tl )
+	{
+		return tl.vertices.size() * sizeof( V ) + tl.indices.size() * sizeof( size_t );
+	}
+};
+
+// loads meshes with vertex normals
+template<class V>
+struct NormalsMeshLoader : public AssetLoader<IndexedTriangleList<V>>
+{
+	static IndexedTriangleList<V> Load( const std::wstring& path )
+	{
+		return IndexedTriangleList<V>::LoadNormals( ToNarrowPath( path ) );
+	}
+};
+
+// loads with Base and moves the mesh so the center of its bounding sphere is at
+// the origin, done once at load time so scenes share the recentered mesh instead
+// of recentering copies of their own (the codex of this loader is a separate
+// cache from the one of Base)
+template<class Base>
+struct CenteredMeshLoader : public Base
+{
+	static auto Load( const std::wstring& path )
+	{
+		auto tl = Base::Load( path );
+		tl.AdjustToTrueCenter();
+		return tl;
+	}
+};
+
+// central registry of assets keyed by path
+// each asset is loaded once and shared by everyone who retrieves it
+// assets nobody holds a handle to anymore are evicted (least recently
+// retrieved first) whenever the total size exceeds the memory budget
+template<class T,class Loader = AssetLoader<T>>
+class Codex
+{
+private:
+	struct Entry
+	{
+		std::shared_ptr<const T> pAsset;
+		size_t size;
+		unsigned long long lastUse;
+	};
+public:
+	// keys are normalized, so a\b, a/b and a/./b are the same asset
+	static std::shared_ptr<const T> Retrieve( const std::wstring& key )
+	{
+		return Get().Retrieve_( NormalizeKey( key ) );
+	}
+	// budget in bytes (assets still in use are never evicted, so the
+	// budget can be exceeded if everything cached is being held)
+	static void SetBudget( size_t bytes )
+	{
+		Get().SetBudget_( bytes );
+	}
+	static size_t GetBudget()
+	{
+		auto& codex = Get();
+		std::lock_guard<std::mutex> lock( codex.mtx );
+		return codex.budget;
+	}
+	static size_t GetUsage()
+	{
+		auto& codex = Get();
+		std::lock_guard<std::mutex> lock( codex.mtx );
+		return codex.usage;
+	}
+	// evict every asset that is not currently held by anyone
+	static void Purge()
+	{
+		auto& codex = Get();
+		std::lock_guard<std::mutex> lock( codex.mtx );
+		codex.Trim( 0u );
+	}
+private:
+	Codex() = default;
+	static Codex& Get()
+	{
+		static Codex codex;
+		return codex;
+	}
+	// forward slashes (backslashes aren't separators for std::filesystem on
+	// posix), with . and .. resolved
+	static std::wstring NormalizeKey( std::wstring key )
+	{
+		std::replace( key.begin(),key.end(),L'\\',L'/' );
+		return std::filesystem::path( key ).lexically_normal().generic_wstring();
+	}
+	std::shared_ptr<const T> Retrieve_( const std::wstring& key )
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		auto i = entries.find( key );
+		if( i == entries.end() )
+		{
+			auto pAsset = std::make_shared<const T>( Loader::Load( key ) );
+			const size_t size = Loader::GetSize( *pAsset );
+			i = entries.emplace( key,Entry{ std::move( pAsset ),size,0u } ).first;
+			usage += size;
+		}
+		i->second.lastUse = ++clock;
+		// hold a handle before trimming so that the new asset is not evicted
+		auto pAsset = i->second.pAsset;
+		Trim( budget );
+		return pAsset;
+	}
+	void SetBudget_( size_t bytes )
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		budget = bytes;
+		Trim( budget );
+	}
+	// evict unreferenced assets (oldest first) until usage fits in target
+	void Trim( size_t target )
+	{
+		if( usage <= target )
+		{
+			return;
+		}
+		// gather eviction candidates (only the codex holds a reference)
+		std::vector<typename std::unordered_map<std::wstring,Entry>::iterator> candidates;
+		for( auto i = entries.begin(); i != entries.end(); i++ )
+		{
+			if( i->second.pAsset.use_count() == 1 )
+			{
+				candidates.push_back( i );
+			}
+		}
+		std::sort( candidates.begin(),candidates.end(),
+			[]( const auto& lhs,const auto& rhs )
+			{
+				return lhs->second.lastUse < rhs->second.lastUse;
+			}
+		);
+		for( auto& i : candidates )
+		{
+			if( usage <= target )
+			{
+				break;
+			}
+			usage -= i->second.size;
+			entries.erase( i );
+		}
+	}
+private:
+	std::mutex mtx;
+	std::unordered_map<std::wstring,Entry> entries;
+	size_t usage = 0u;
+	// default budget of 256 MB
+	size_t budget = 256u * 1024u * 1024u;
+	unsigned long long clock = 0u;
+};
\ No newline at end of file
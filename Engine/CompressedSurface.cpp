@@ -0,0 +1,225 @@
+#include "CompressedSurface.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	unsigned int Quantize( float c,unsigned int max )
+	{
+		const float v = std::min( std::max( c,0.0f ),255.0f );
+		return (unsigned int)(v * float( max ) / 255.0f + 0.5f);
+	}
+	unsigned int To565( const Vec3& c )
+	{
+		return (Quantize( c.x,31u ) << 11u) | (Quantize( c.y,63u ) << 5u) | Quantize( c.z,31u );
+	}
+	int ColorDistance( unsigned int a,unsigned int b )
+	{
+		const int dr = int( (a >> 16u) & 0xFFu ) - int( (b >> 16u) & 0xFFu );
+		const int dg = int( (a >> 8u) & 0xFFu ) - int( (b >> 8u) & 0xFFu );
+		const int db = int( a & 0xFFu ) - int( b & 0xFFu );
+		return dr * dr + dg * dg + db * db;
+	}
+	Vec3 ToVec3( Color c )
+	{
+		return { float( c.GetR() ),float( c.GetG() ),float( c.GetB() ) };
+	}
+}
+
+CompressedSurface::CompressedSurface( const Surface& src )
+	:
+	CompressedSurface( src,PickFormat( src ) )
+{}
+
+CompressedSurface::Format CompressedSurface::PickFormat( const Surface& src )
+{
+	for( unsigned int y = 0u; y < src.GetHeight(); y++ )
+	{
+		for( unsigned int x = 0u; x < src.GetWidth(); x++ )
+		{
+			if( src.GetPixel( x,y ).GetA() != 255u )
+			{
+				return Format::BC3;
+			}
+		}
+	}
+	return Format::BC1;
+}
+
+CompressedSurface::CompressedSurface( const Surface& src,Format format )
+	:
+	format( format ),
+	width( src.GetWidth() ),
+	height( src.GetHeight() ),
+	blocksX( (src.GetWidth() + 3u) / 4u ),
+	blocksY( (src.GetHeight() + 3u) / 4u ),
+	blocks( size_t( blocksX ) * blocksY * GetQwordsPerBlock() )
+{
+	auto pBlock = blocks.begin();
+	for( unsigned int by = 0u; by < blocksY; by++ )
+	{
+		for( unsigned int bx = 0u; bx < blocksX; bx++ )
+		{
+			// gather block texels, repeating the edges past the border
+			Color texels[16];
+			for( unsigned int i = 0u; i < 16u; i++ )
+			{
+				const unsigned int x = std::min( bx * 4u + i % 4u,width - 1u );
+				const unsigned int y = std::min( by * 4u + i / 4u,height - 1u );
+				texels[i] = src.GetPixel( x,y );
+			}
+			if( format == Format::BC3 )
+			{
+				*pBlock++ = CompressAlpha( texels );
+			}
+			*pBlock++ = CompressColor( texels );
+		}
+	}
+}
+
+Surface CompressedSurface::Decompress() const
+{
+	Surface surf( width,height );
+	Color texels[16];
+	for( unsigned int by = 0u; by < blocksY; by++ )
+	{
+		for( unsigned int bx = 0u; bx < blocksX; bx++ )
+		{
+			DecodeBlock( bx,by,texels );
+			for( unsigned int i = 0u; i < 16u; i++ )
+			{
+				const unsigned int x = bx * 4u + i % 4u;
+				const unsigned int y = by * 4u + i / 4u;
+				if( x < width && y < height )
+				{
+					surf.PutPixel( x,y,texels[i] );
+				}
+			}
+		}
+	}
+	return surf;
+}
+
+unsigned long long CompressedSurface::CompressColor( const Color* texels )
+{
+	// principal axis of the block colors by power iteration on the covariance
+	Vec3 mean = { 0.0f,0.0f,0.0f };
+	Vec3 lo = ToVec3( texels[0] );
+	Vec3 hi = lo;
+	for( int i = 0; i < 16; i++ )
+	{
+		const Vec3 c = ToVec3( texels[i] );
+		mean += c;
+		lo = { std::min( lo.x,c.x ),std::min( lo.y,c.y ),std::min( lo.z,c.z ) };
+		hi = { std::max( hi.x,c.x ),std::max( hi.y,c.y ),std::max( hi.z,c.z ) };
+	}
+	mean /= 16.0f;
+	float cov[6] = {};
+	for( int i = 0; i < 16; i++ )
+	{
+		const Vec3 d = ToVec3( texels[i] ) - mean;
+		cov[0] += d.x * d.x;
+		cov[1] += d.x * d.y;
+		cov[2] += d.x * d.z;
+		cov[3] += d.y * d.y;
+		cov[4] += d.y * d.z;
+		cov[5] += d.z * d.z;
+	}
+	Vec3 axis = hi - lo;
+	for( int iter = 0; iter < 8; iter++ )
+	{
+		axis = {
+			cov[0] * axis.x + cov[1] * axis.y + cov[2] * axis.z,
+			cov[1] * axis.x + cov[3] * axis.y + cov[4] * axis.z,
+			cov[2] * axis.x + cov[4] * axis.y + cov[5] * axis.z
+		};
+		const float len = std::max( std::max( std::abs( axis.x ),std::abs( axis.y ) ),std::abs( axis.z ) );
+		if( len == 0.0f )
+		{
+			break;
+		}
+		axis /= len;
+	}
+
+	// extremes along the axis, pulled in slightly since the end points are
+	// rarely hit exactly and the inner palette entries do more of the work
+	Vec3 minColor = mean;
+	Vec3 maxColor = mean;
+	if( axis * axis > 0.0f )
+	{
+		float minT = 0.0f;
+		float maxT = 0.0f;
+		for( int i = 0; i < 16; i++ )
+		{
+			const float t = (ToVec3( texels[i] ) - mean) * axis;
+			minT = std::min( minT,t );
+			maxT = std::max( maxT,t );
+		}
+		const float inset = (maxT - minT) / 16.0f;
+		const float norm = 1.0f / (axis * axis);
+		minColor = mean + axis * ((minT + inset) * norm);
+		maxColor = mean + axis * ((maxT - inset) * norm);
+	}
+	unsigned int c0 = To565( maxColor );
+	unsigned int c1 = To565( minColor );
+	// 4 color mode needs c0 > c1 (equal end points means a flat block, any mode works)
+	if( c0 < c1 )
+	{
+		std::swap( c0,c1 );
+	}
+
+	// nearest palette entry per texel, using the palette the decoder produces
+	unsigned int palette[4];
+	DecodeColorPalette( c0,c1,palette );
+	unsigned long long indices = 0u;
+	for( int i = 0; i < 16; i++ )
+	{
+		unsigned long long best = 0u;
+		int bestDist = ColorDistance( texels[i].dword,palette[0] );
+		// (in 3 color mode index 3 is transparent, never pick it for opaque texels)
+		const unsigned long long nEntries = c0 > c1 ? 4u : 3u;
+		for( unsigned long long j = 1u; j < nEntries; j++ )
+		{
+			const int dist = ColorDistance( texels[i].dword,palette[j] );
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				best = j;
+			}
+		}
+		indices |= best << (i * 2);
+	}
+	return c0 | (c1 << 16u) | (indices << 32u);
+}
+
+unsigned long long CompressedSurface::CompressAlpha( const Color* texels )
+{
+	unsigned int a0 = 0u;
+	unsigned int a1 = 255u;
+	for( int i = 0; i < 16; i++ )
+	{
+		a0 = std::max( a0,(unsigned int)texels[i].GetA() );
+		a1 = std::min( a1,(unsigned int)texels[i].GetA() );
+	}
+	// a0 > a1 selects the 8 value mode, flat blocks are fine either way
+	unsigned int palette[8];
+	DecodeAlphaPalette( a0,a1,palette );
+	unsigned long long indices = 0u;
+	for( int i = 0; i < 16; i++ )
+	{
+		const int a = texels[i].GetA();
+		unsigned long long best = 0u;
+		int bestDist = std::abs( a - int( palette[0] ) );
+		for( unsigned long long j = 1u; j < 8u; j++ )
+		{
+			const int dist = std::abs( a - int( palette[j] ) );
+			if( dist < bestDist )
+			{
+				bestDist = dist;
+				best = j;
+			}
+		}
+		indices |= best << (i * 3);
+	}
+	return a0 | (a1 << 8u) | (indices << 16u);
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Surface.h"
+#include <vector>
+
+// texture stored as 4x4 texel blocks in the BC1 / BC3 (aka DXT1 / DXT5) layouts
+// BC1: 8 bytes per block (two 565 endpoints + 2-bit indices), opaque only
+// BC3: 16 bytes per block (BC1 style color + two 8-bit alpha endpoints with 3-bit indices)
+// sizes that are not multiples of 4 are padded by repeating the edge texels
+class CompressedSurface
+{
+public:
+	enum class Format
+	{
+		BC1,
+		BC3
+	};
+public:
+	// compresses to BC1 if every texel is opaque, BC3 otherwise
+	CompressedSurface( const Surface& src );
+	CompressedSurface( const Surface& src,Format format );
+	// decodes the 16 texels of a block in row major order
+	void DecodeBlock( unsigned int bx,unsigned int by,Color* pOut ) const
+	{
+		const unsigned long long* const pBlock = &blocks[(size_t( by ) * blocksX + bx) * GetQwordsPerBlock()];
+		if( format == Format::BC1 )
+		{
+			DecodeColor( pBlock[0],pOut );
+		}
+		else
+		{
+			DecodeColor( pBlock[1],pOut );
+			DecodeAlpha( pBlock[0],pOut );
+		}
+	}
+	Surface Decompress() const;
+	unsigned int GetWidth() const
+	{
+		return width;
+	}
+	unsigned int GetHeight() const
+	{
+		return height;
+	}
+	unsigned int GetBlocksX() const
+	{
+		return blocksX;
+	}
+	unsigned int GetBlocksY() const
+	{
+		return blocksY;
+	}
+	Format GetFormat() const
+	{
+		return format;
+	}
+	size_t GetSizeBytes() const
+	{
+		return blocks.size() * sizeof( unsigned long long );
+	}
+private:
+	size_t GetQwordsPerBlock() const
+	{
+		return format == Format::BC1 ? 1u : 2u;
+	}
+	static unsigned int Expand565( unsigned int c )
+	{
+		const unsigned int r = (c >> 11u) & 31u;
+		const unsigned int g = (c >> 5u) & 63u;
+		const unsigned int b = c & 31u;
+		return (((r << 3u) | (r >> 2u)) << 16u) | (((g << 2u) | (g >> 4u)) << 8u) | ((b << 3u) | (b >> 2u));
+	}
+	// palette of the color part of a block, in the layout of Color::dword
+	static void DecodeColorPalette( unsigned int c0,unsigned int c1,unsigned int* palette )
+	{
+		const unsigned int e0 = Expand565( c0 );
+		const unsigned int e1 = Expand565( c1 );
+		// blend the three channels of the endpoints
+		const auto Lerp = [e0,e1]( unsigned int w0,unsigned int w1,unsigned int d ) -> unsigned int
+		{
+			unsigned int result = 0xFF000000u;
+			for( unsigned int shift = 0u; shift < 24u; shift += 8u )
+			{
+				const unsigned int a = (e0 >> shift) & 0xFFu;
+				const unsigned int b = (e1 >> shift) & 0xFFu;
+				result |= ((a * w0 + b * w1) / d) << shift;
+			}
+			return result;
+		};
+		palette[0] = e0 | 0xFF000000u;
+		palette[1] = e1 | 0xFF000000u;
+		if( c0 > c1 )
+		{
+			palette[2] = Lerp( 2u,1u,3u );
+			palette[3] = Lerp( 1u,2u,3u );
+		}
+		else
+		{
+			// 3 color mode, index 3 is transparent black
+			palette[2] = Lerp( 1u,1u,2u );
+			palette[3] = 0u;
+		}
+	}
+	static void DecodeAlphaPalette( unsigned int a0,unsigned int a1,unsigned int* palette )
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if( a0 > a1 )
+		{
+			for( unsigned int i = 1u; i < 7u; i++ )
+			{
+				palette[i + 1u] = (a0 * (7u - i) + a1 * i) / 7u;
+			}
+		}
+		else
+		{
+			for( unsigned int i = 1u; i < 5u; i++ )
+			{
+				palette[i + 1u] = (a0 * (5u - i) + a1 * i) / 5u;
+			}
+			palette[6] = 0u;
+			palette[7] = 255u;
+		}
+	}
+	static void DecodeColor( unsigned long long block,Color* pOut )
+	{
+		unsigned int palette[4];
+		DecodeColorPalette( (unsigned int)(block & 0xFFFFu),(unsigned int)((block >> 16u) & 0xFFFFu),palette );
+		unsigned int indices = (unsigned int)(block >> 32u);
+		for( int i = 0; i < 16; i++,indices >>= 2u )
+		{
+			pOut[i] = palette[indices & 3u];
+		}
+	}
+	static void DecodeAlpha( unsigned long long block,Color* pOut )
+	{
+		unsigned int palette[8];
+		DecodeAlphaPalette( (unsigned int)(block & 0xFFu),(unsigned int)((block >> 8u) & 0xFFu),palette );
+		unsigned long long indices = block >> 16u;
+		for( int i = 0; i < 16; i++,indices >>= 3u )
+		{
+			pOut[i].SetA( (unsigned char)palette[indices & 7u] );
+		}
+	}
+	// BC1 if every texel is opaque, BC3 otherwise (scanned before compressing)
+	static Format PickFormat( const Surface& src );
+	// block encoders (texels are 16 Colors in row major order)
+	static unsigned long long CompressColor( const Color* texels );
+	static unsigned long long CompressAlpha( const Color* texels );
+private:
+	Format format;
+	unsigned int width;
+	unsigned int height;
+	unsigned int blocksX;
+	unsigned int blocksY;
+	// one qword per block for BC1, alpha qword followed by color qword for BC3
+	std::vector<unsigned long long> blocks;
+};
\ No newline at end of file
@@ -10,7 +10,7 @@
 class CubeSkinScene : public Scene
 {
 public:
-	typedef Pipeline<TextureEffect> Pipeline;
+	typedef Pipeline<TextureEffect<>> Pipeline;
 	typedef Pipeline::Vertex Vertex;
 public:
 	CubeSkinScene( Graphics& gfx,const std::wstring& filename )
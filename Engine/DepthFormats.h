@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+// storage formats for DepthBuffer
+// Encode() maps the depth coming out of the projection to the stored value,
+// Closer() is the depth test (true if a is in front of b) and Far() is the
+// clear value
+// reversed formats expect a projection with near and far swapped (depth 1 at the
+// near plane, 0 at the far plane, see Mat4::ProjectionHFOVReversed), the
+// pipeline clips against z = w instead of z = 0 for those
+
+// 32-bit float (what ZBuffer always used to be)
+struct DepthFloat32
+{
+	typedef float Stored;
+	static constexpr bool reversed = false;
+	static Stored Encode( float z )
+	{
+		return z;
+	}
+	static float Decode( Stored d )
+	{
+		return d;
+	}
+	static Stored Far()
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+	static bool Closer( Stored a,Stored b )
+	{
+		return a < b;
+	}
+};
+
+// 32-bit float with reversed z, the float exponent makes up for the 1 / z
+// distribution of projected depth so precision is nearly even over the range
+struct DepthReversedFloat32
+{
+	typedef float Stored;
+	static constexpr bool reversed = true;
+	static Stored Encode( float z )
+	{
+		return z;
+	}
+	static float Decode( Stored d )
+	{
+		return d;
+	}
+	static Stored Far()
+	{
+		return 0.0f;
+	}
+	static bool Closer( Stored a,Stored b )
+	{
+		return a > b;
+	}
+};
+
+// 16-bit unorm, half the bandwidth, fine for scenes with a short depth range
+struct DepthUnorm16
+{
+	typedef unsigned short Stored;
+	static constexpr bool reversed = false;
+	static Stored Encode( float z )
+	{
+		return Stored( std::min( std::max( z,0.0f ),1.0f ) * 65535.0f + 0.5f );
+	}
+	static float Decode( Stored d )
+	{
+		return float( d ) / 65535.0f;
+	}
+	static Stored Far()
+	{
+		return 0xFFFFu;
+	}
+	static bool Closer( Stored a,Stored b )
+	{
+		return a < b;
+	}
+};
+
+// 24-bit unorm packed in 3 bytes
+struct DepthUnorm24
+{
+	struct Stored
+	{
+		unsigned int Get() const
+		{
+			return (unsigned int)lo | ((unsigned int)mid << 8u) | ((unsigned int)hi << 16u);
+		}
+		unsigned char lo;
+		unsigned char mid;
+		unsigned char hi;
+	};
+	static constexpr bool reversed = false;
+	static Stored Encode( float z )
+	{
+		const auto d = (unsigned int)( std::min( std::max( z,0.0f ),1.0f ) * 16777215.0f + 0.5f );
+		return { (unsigned char)d,(unsigned char)(d >> 8u),(unsigned char)(d >> 16u) };
+	}
+	static float Decode( Stored d )
+	{
+		return float( d.Get() ) / 16777215.0f;
+	}
+	static Stored Far()
+	{
+		return { 0xFFu,0xFFu,0xFFu };
+	}
+	static bool Closer( Stored a,Stored b )
+	{
+		return a.Get() < b.Get();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Rect.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <emmintrin.h>
+
+// fills count 32-bit values (colors, floats) with value, works for any bit
+// pattern (unlike memset), 16-byte stores once the destination is aligned
+template<typename T>
+inline void Fill32( T* pDst,size_t count,T value )
+{
+	static_assert( sizeof( T ) == 4u,"Fill32 is for 32-bit values" );
+	int bits;
+	memcpy( &bits,&value,sizeof( bits ) );
+	const __m128i v = _mm_set1_epi32( bits );
+	for( ; count > 0u && (reinterpret_cast<uintptr_t>( pDst ) & 15u) != 0u; count-- )
+	{
+		*pDst++ = value;
+	}
+	for( ; count >= 8u; count -= 8u,pDst += 8 )
+	{
+		_mm_store_si128( reinterpret_cast<__m128i*>( pDst ),v );
+		_mm_store_si128( reinterpret_cast<__m128i*>( pDst + 4 ),v );
+	}
+	for( ; count > 0u; count-- )
+	{
+		*pDst++ = value;
+	}
+}
+
+// "cleared at epoch n" tags for the 16x16 tiles of a buffer
+// Invalidate() just moves on to the next epoch, tiles tagged with an older one
+// are stale and get cleared by the owner of the buffer the first time they are
+// touched, or all at once by ResolveAll() when the whole buffer is needed
+class TileEpochs
+{
+public:
+	static constexpr int tileShift = 4;
+	static constexpr int tileSize = 1 << tileShift;
+public:
+	// every tile starts out stale
+	TileEpochs( int width,int height )
+		:
+		width( width ),
+		height( height ),
+		tilesX( (width + tileSize - 1) >> tileShift ),
+		tilesY( (height + tileSize - 1) >> tileShift ),
+		epochs( size_t( tilesX * tilesY ),0u )
+	{}
+	// marks every tile stale, O(1) (except once every 4 billion calls)
+	void Invalidate()
+	{
+		if( ++epoch == 0u )
+		{
+			std::fill( epochs.begin(),epochs.end(),0u );
+			epoch = 1u;
+		}
+	}
+	// true if the tile holding x,y is stale, it counts as cleared afterwards
+	// (so the caller has to clear it, see GetTileRect)
+	bool Claim( int x,int y )
+	{
+		return ClaimTile( GetTileIndex( x,y ) );
+	}
+	bool ClaimTile( int tile )
+	{
+		unsigned int& tileEpoch = epochs[size_t( tile )];
+		if( tileEpoch == epoch )
+		{
+			return false;
+		}
+		tileEpoch = epoch;
+		return true;
+	}
+	// true if the tile has been claimed since the last Invalidate()
+	bool IsCurrent( int tile ) const
+	{
+		return epochs[size_t( tile )] == epoch;
+	}
+	// starts at 1 and goes up with every Invalidate(), back to 1 after wrapping around
+	unsigned int GetEpoch() const
+	{
+		return epoch;
+	}
+	int GetTileIndex( int x,int y ) const
+	{
+		return (y >> tileShift) * tilesX + (x >> tileShift);
+	}
+	int GetTilesX() const
+	{
+		return tilesX;
+	}
+	int GetTilesY() const
+	{
+		return tilesY;
+	}
+	// pixels of the tile holding x,y (clipped to the buffer)
+	RectI GetTileRect( int x,int y ) const
+	{
+		const int left = x & ~(tileSize - 1);
+		const int top = y & ~(tileSize - 1);
+		return { top,std::min( top + tileSize,height ),left,std::min( left + tileSize,width ) };
+	}
+	// calls clear( rect ) for every stale tile, they all count as cleared afterwards
+	template<class F>
+	void ResolveAll( F&& clear )
+	{
+		for( int ty = 0; ty < tilesY; ty++ )
+		{
+			for( int tx = 0; tx < tilesX; tx++ )
+			{
+				unsigned int& tileEpoch = epochs[size_t( ty * tilesX + tx )];
+				if( tileEpoch != epoch )
+				{
+					tileEpoch = epoch;
+					clear( GetTileRect( tx << tileShift,ty << tileShift ) );
+				}
+			}
+		}
+	}
+private:
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	unsigned int epoch = 1u;
+	std::vector<unsigned int> epochs;
+};
\ No newline at end of file
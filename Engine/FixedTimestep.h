@@ -0,0 +1,45 @@
+#pragma once
+#include <cmath>
+
+// turns the variable frame times into whole fixed simulation steps (none or
+// several per frame), what is left over carries into the next frame
+class FixedTimestep
+{
+public:
+	// more than maxSteps in one frame and the rest of the time is dropped (the
+	// simulation slows down instead of falling further behind every frame)
+	FixedTimestep( float step,unsigned int maxSteps )
+		:
+		step( step ),
+		maxSteps( maxSteps )
+	{}
+	// adds the time of a frame, returns how many steps to update
+	unsigned int Advance( float dt )
+	{
+		accumulator += dt;
+		unsigned int nSteps = 0u;
+		while( accumulator >= step && nSteps < maxSteps )
+		{
+			accumulator -= step;
+			nSteps++;
+		}
+		if( accumulator >= step )
+		{
+			accumulator = std::fmod( accumulator,step );
+		}
+		return nSteps;
+	}
+	float GetStep() const
+	{
+		return step;
+	}
+	// how far into the next step the frame is, [0,1)
+	float GetAlpha() const
+	{
+		return accumulator / step;
+	}
+private:
+	float step;
+	unsigned int maxSteps;
+	float accumulator = 0.0f;
+};
\ No newline at end of file
@@ -22,42 +22,88 @@
 #include "Game.h"
 #include "Sphere.h"
 #include "TestTriangle.h"
-//#include "CubeSkinScene.h"
-//#include "CubeVertexColorScene.h"
-//#include "CubeSolidScene.h"
-//#include "DoubleCubeScene.h"
-//#include "VertexWaveScene.h"
-//#include "CubeVertexPositionColorScene.h"
-//#include "CubeSolidGeometryScene.h"
-//#include "CubeFlatIndependentScene.h"
-//#include "GeometryFlatScene.h"
-//#include "GouraudScene.h"
-//#include "GouraudPointScene.h"
-//#include "PhongPointScene.h"
-#include "SpecularPhongPointScene.h"
+#include "Scenes.h"
+#include "Trace.h"
 #include <sstream>
 
 Game::Game( MainWindow& wnd )
 	:
 	wnd( wnd ),
-	gfx( wnd )
+	gfx( wnd ),
+	scenes( MakeScenes( gfx ) )
 {
-	scenes.push_back( std::make_unique<SpecularPhongPointScene>( gfx ) );
 	curScene = scenes.begin();
 	OutputSceneName();
+	Trace::SetThreadName( "main" );
+}
+
+Game::~Game()
+{
+	// don't pull the graphics out from under a frame still in flight
+	// (whatever it threw doesn't matter anymore)
+	try
+	{
+		if( updateJob )
+		{
+			JobSystem::Get().Wait( updateJob );
+		}
+	}
+	catch( ... )
+	{}
 }
 
 void Game::Go()
 {
-	gfx.BeginFrame();
-	UpdateModel();
-	ComposeFrame();
+	auto& jobs = JobSystem::Get();
+	HandleKeys();
+	Scene& scene = **curScene;
+	// however many fixed steps fit in the time since the last frame, the frame
+	// then draws between the last two states (one step behind, but smooth)
+	const unsigned int nSteps = timestep.Advance( ft.Mark() );
+	if( scene.CanUpdateWhileDrawing() )
+	{
+		// draws the state interpolated at the end of the last frame while this
+		// frame's updates run, whose state the next frame draws
+		updateJob = jobs.Schedule( [this,&scene,nSteps]()
+		{
+			UpdateModel( scene,nSteps );
+		} );
+		gfx.BeginFrame();
+		ComposeFrame();
+		PresentFrame();
+		jobs.Wait( updateJob );
+		scene.Interpolate( timestep.GetAlpha() );
+	}
+	else
+	{
+		// the scene updates while the present thread still works on the last frame,
+		// BeginFrame then waits out the frame latency limit (it blocks, so it runs
+		// here rather than tying up a worker, and the clear it does is lazy)
+		UpdateModel( scene,nSteps );
+		scene.Interpolate( timestep.GetAlpha() );
+		gfx.BeginFrame();
+		ComposeFrame();
+		PresentFrame();
+	}
+}
+
+void Game::PresentFrame()
+{
+	// hand the frame to the present thread
 	gfx.EndFrame();
 }
 
-void Game::UpdateModel()
+void Game::UpdateModel( Scene& scene,unsigned int nSteps )
+{
+	CHILI_TRACE( "Game::UpdateModel" );
+	for( unsigned int i = 0u; i < nSteps; i++ )
+	{
+		scene.Update( wnd.kbd,wnd.mouse,timestep.GetStep() );
+	}
+}
+
+void Game::HandleKeys()
 {
-	const float dt = ft.Mark();
 	// cycle through scenes when tab is pressed
 	while( !wnd.kbd.KeyIsEmpty() )
 	{
@@ -73,13 +119,22 @@ void Game::UpdateModel()
 				CycleScenes();
 			}
 		}
+		// f7 cycles through the overdraw / shading cost heatmaps
+		else if( e.GetCode() == VK_F7 && e.IsPress() )
+		{
+			CycleDebugView();
+		}
+		// f8 starts a frame capture, the second press writes it to trace.json
+		// (open in chrome://tracing or ui.perfetto.dev)
+		else if( e.GetCode() == VK_F8 && e.IsPress() )
+		{
+			ToggleTrace();
+		}
 		else if( e.GetCode() == VK_ESCAPE && e.IsPress() )
 		{
 			wnd.Kill();
 		}
 	}
-	// update scene
-	(*curScene)->Update( wnd.kbd,wnd.mouse,dt );
 }
 
 void Game::CycleScenes()
@@ -115,8 +170,36 @@ void Game::OutputSceneName() const
 	OutputDebugStringA( ss.str().c_str() );
 }
 
+void Game::CycleDebugView()
+{
+	const auto view = DebugView( (int( gfx.GetDebugView() ) + 1) % (int( DebugView::DepthPasses ) + 1) );
+	gfx.SetDebugView( view );
+	OutputDebugStringA( (std::string( "debug view: " ) + GetDebugViewName( view ) + "\n").c_str() );
+}
+
+void Game::ToggleTrace()
+{
+	if( !Trace::IsRecording() )
+	{
+		Trace::Start();
+		OutputDebugStringA( "trace started\n" );
+		return;
+	}
+	Trace::Stop();
+	try
+	{
+		Trace::Dump( L"trace.json" );
+		OutputDebugStringA( "trace written to trace.json\n" );
+	}
+	catch( const std::exception& e )
+	{
+		OutputDebugStringA( (std::string( e.what() ) + "\n").c_str() );
+	}
+}
+
 void Game::ComposeFrame()
 {
+	CHILI_TRACE( "Game::ComposeFrame" );
 	// draw scene
 	(*curScene)->Draw();
 }
\ No newline at end of file
@@ -25,6 +25,8 @@
 #include <vector>
 #include "Scene.h"
 #include "FrameTimer.h"
+#include "FixedTimestep.h"
+#include "JobSystem.h"
 
 class Game
 {
@@ -32,15 +34,20 @@ public:
 	Game( class MainWindow& wnd );
 	Game( const Game& ) = delete;
 	Game& operator=( const Game& ) = delete;
+	~Game();
 	void Go();
 private:
 	void ComposeFrame();
-	void UpdateModel();
+	void UpdateModel( Scene& scene,unsigned int nSteps );
+	void HandleKeys();
+	void PresentFrame();
 	/********************************/
 	/*  User Functions              */
 	void CycleScenes();
 	void ReverseCycleScenes();
 	void OutputSceneName() const;
+	void CycleDebugView();
+	void ToggleTrace();
 	/********************************/
 private:
 	MainWindow& wnd;
@@ -48,7 +55,11 @@ private:
 	/********************************/
 	/*  User Variables              */
 	FrameTimer ft;
+	// the scenes update at 60hz whatever the frame rate
+	FixedTimestep timestep = FixedTimestep( 1.0f / 60.0f,5u );
 	std::vector<std::unique_ptr<Scene>> scenes;
 	std::vector<std::unique_ptr<Scene>>::iterator curScene;
 	/********************************/
+	// the updates running while the frame is drawn (scenes that allow it)
+	JobSystem::JobHandle updateJob;
 };
\ No newline at end of file
@@ -1,8 +1,7 @@
 #pragma once
 
 #include "Pipeline.h"
-#include "DefaultVertexShader.h"
-#include "DefaultGeometryShader.h"
+#include "BaseVertexShader.h"
 
 // flat shading with face normals calculated in gs
 class GeometryFlatEffect
@@ -60,9 +59,30 @@ public:
 	public:
 		Vec3 pos;
 	};
-	// default vs rotates and translates vertices
-	// does not touch attributes
-	typedef DefaultVertexShader<Vertex> VertexShader;
+	// vs output, the clip space position for the pipeline and the view space
+	// position for the gs (only the gs reads vs output, no interpolation)
+	class VSOutput
+	{
+	public:
+		VSOutput() = default;
+		VSOutput( const Vec4& pos,const Vec4& viewPos )
+			:
+			pos( pos ),
+			viewPos( viewPos )
+		{}
+	public:
+		Vec4 pos;
+		Vec4 viewPos;
+	};
+	class VertexShader : public BaseVertexShader<VSOutput>
+	{
+	public:
+		Output operator()( const Vertex& v ) const
+		{
+			const Vec4 p = Vec4( v.pos );
+			return{ p * worldViewProj,p * worldView };
+		}
+	};
 	// calculate color based on face normal calculated from
 	// cross product of geometry--no interpolation of color
 	class GeometryShader
@@ -72,16 +92,16 @@ public:
 		{
 		public:
 			Output() = default;
-			Output( const Vec3& pos )
+			Output( const Vec4& pos )
 				:
 				pos( pos )
 			{}
-			Output( const Vec3& pos,const Output& src )
+			Output( const Vec4& pos,const Output& src )
 				:
 				color( src.color ),
 				pos( pos )
 			{}
-			Output( const Vec3& pos,const Color& color )
+			Output( const Vec4& pos,const Color& color )
 				:
 				color( color ),
 				pos( pos )
@@ -123,14 +143,18 @@ public:
 				return Output( *this ) /= rhs;
 			}
 		public:
-			Vec3 pos;
+			Vec4 pos;
 			Color color;
 		};
 	public:
 		Triangle<Output> operator()( const VertexShader::Output& in0,const VertexShader::Output& in1,const VertexShader::Output& in2,size_t triangle_index ) const
 		{
-			// calculate face normal
-			const auto n = ((in1.pos - in0.pos) % (in2.pos - in0.pos)).GetNormalized();
+			// view space face normal, precomputed for the mesh and moved with the
+			// world view of the vs (Pipeline::DrawWithFaceNormals), or from the
+			// cross product of the transformed geometry
+			const Vec3 n = pFaceNormals ?
+				worldView.TransformVector( (*pFaceNormals)[triangle_index] ) :
+				((Vec3( in1.viewPos ) - Vec3( in0.viewPos )) % (Vec3( in2.viewPos ) - Vec3( in0.viewPos ))).GetNormalized();
 			// calculate intensity based on angle of incidence
 			const auto d = diffuse * std::max( 0.0f,-n * dir );
 			// add diffuse+ambient, filter by material color, saturate and scale
@@ -145,6 +169,7 @@ public:
 		{
 			ambient = { c.x,c.y,c.z };
 		}
+		// direction of the light rays in view space
 		void SetLightDirection( const Vec3& dl )
 		{
 			assert( dl.LenSq() >= 0.001f );
@@ -154,9 +179,17 @@ public:
 		{
 			color = Vec3( c );
 		}
+		// model space face normals, one per triangle, and the world view they are
+		// moved with (the one of the vs, only rotation and translation, the normals
+		// aren't renormalized), set by the pipeline for the draw (nullptr after it)
+		void BindFaceNormals( const std::vector<Vec3>* pNormals,const Mat4x3& worldView_in )
+		{
+			pFaceNormals = pNormals;
+			worldView = worldView_in;
+		}
 	private:
-		Mat3 rotation;
-		Vec3 translation;
+		const std::vector<Vec3>* pFaceNormals = nullptr;
+		Mat4x3 worldView = Mat4x3::Identity();
 		Vec3 dir = { 0.0f,0.0f,1.0f };
 		// this is the intensity if direct light from source
 		// color light so need values per color component
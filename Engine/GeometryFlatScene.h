@@ -5,21 +5,23 @@
 #include "Mat.h"
 #include "Pipeline.h"
 #include "GeometryFlatEffect.h"
+#include "Codex.h"
 
 class GeometryFlatScene : public Scene
 {
 public:
-	typedef Pipeline<GeometryFlatEffect> Pipeline;
+	typedef ::Pipeline<GeometryFlatEffect> Pipeline;
 	typedef Pipeline::Vertex Vertex;
 public:
-	GeometryFlatScene( Graphics& gfx,IndexedTriangleList<Vertex> tl )
+	// mesh is a position only .obj, shared through the codex (recentered at load)
+	GeometryFlatScene( Graphics& gfx,const std::wstring& mesh )
 		:
-		itlist( std::move( tl ) ),
+		pMesh( Codex<IndexedTriangleList<Vertex>,CenteredMeshLoader<AssetLoader<IndexedTriangleList<Vertex>>>>::Retrieve( mesh ) ),
 		pipeline( gfx ),
 		Scene( "flat geometry scene free mesh" )
 	{
-		itlist.AdjustToTrueCenter();
-		offset_z = itlist.GetRadius() * 1.6f;
+		radius = pMesh->GetRadius();
+		offset_z = radius * 1.6f;
 	}
 	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) override
 	{
@@ -83,27 +85,30 @@ public:
 	virtual void Draw() override
 	{
 		pipeline.BeginFrame();
-		// generate rotation matrix from euler angles
-		// translation from offset
-		const Mat3 rot =
-			Mat3::RotationX( theta_x ) *
-			Mat3::RotationY( theta_y ) *
-			Mat3::RotationZ( theta_z );
+		// world view from euler angles and the offset (camera at the origin),
+		// the far plane far enough for the mesh at any offset_z it is visible at
+		const auto proj = Mat4::ProjectionHFOV( hfov,aspect_ratio,0.1f,offset_z + radius * 2.0f );
+		pipeline.effect.vs.BindWorldView(
+			Mat4x3::RotationX( theta_x ) *
+			Mat4x3::RotationY( theta_y ) *
+			Mat4x3::RotationZ( theta_z ) *
+			Mat4x3::Translation( 0.0f,0.0f,offset_z )
+		);
+		pipeline.effect.vs.BindProjection( proj );
 		const Mat3 rot_phi =
 			Mat3::RotationX( phi_x ) *
 			Mat3::RotationY( phi_y ) *
 			Mat3::RotationZ( phi_z );
-		const Vec3 trans = { 0.0f,0.0f,offset_z };
-		// set pipeline transform
-		pipeline.effect.vs.BindRotation( rot );
-		pipeline.effect.vs.BindTranslation( trans );
 		pipeline.effect.gs.SetLightDirection( light_dir * rot_phi );
-		// render triangles
-		pipeline.Draw( itlist );
+		// render triangles, the mesh only gets rotated so the cached normals hold
+		pipeline.DrawWithFaceNormals( *pMesh );
 	}
 private:
-	IndexedTriangleList<Vertex> itlist;
+	std::shared_ptr<const IndexedTriangleList<Vertex>> pMesh;
+	float radius;
 	Pipeline pipeline;
+	static constexpr float aspect_ratio = 1.33333f;
+	static constexpr float hfov = 85.0f;
 	static constexpr float dTheta = PI;
 	float offset_z = 2.0f;
 	float theta_x = 0.0f;
@@ -26,6 +26,7 @@
 #include <string>
 #include <array>
 #include <functional>
+#include <algorithm>
 
 // Ignore the intellisense error "cannot open source file" for .shh files.
 // They will be created during the build sequence before the preprocessor runs.
@@ -40,8 +41,6 @@ namespace FramebufferShaders
 using Microsoft::WRL::ComPtr;
 
 Graphics::Graphics( HWNDKey& key )
-	:
-	sysBuffer( ScreenWidth,ScreenHeight )
 {
 	assert( key.hWnd != nullptr );
 
@@ -124,8 +123,8 @@ Graphics::Graphics( HWNDKey& key )
 	pImmediateContext->RSSetViewports( 1,&vp );
 
 
-	///////////////////////////////////////
-	// create texture for cpu render target
+	////////////////////////////////////////
+	// create textures for cpu render targets
 	D3D11_TEXTURE2D_DESC sysTexDesc;
 	sysTexDesc.Width = Graphics::ScreenWidth;
 	sysTexDesc.Height = Graphics::ScreenHeight;
@@ -138,21 +137,27 @@ Graphics::Graphics( HWNDKey& key )
 	sysTexDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	sysTexDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	sysTexDesc.MiscFlags = 0;
-	// create the texture
-	if( FAILED( hr = pDevice->CreateTexture2D( &sysTexDesc,nullptr,&pSysBufferTexture ) ) )
-	{
-		throw CHILI_GFX_EXCEPTION( hr,L"Creating sysbuffer texture" );
-	}
-
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = sysTexDesc.Format;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MipLevels = 1;
-	// create the resource view on the texture
-	if( FAILED( hr = pDevice->CreateShaderResourceView( pSysBufferTexture.Get(),
-		&srvDesc,&pSysBufferTextureView ) ) )
+	frameTextures.resize( nFrameBuffers );
+	for( auto& frame : GetFrameBuffers() )
 	{
-		throw CHILI_GFX_EXCEPTION( hr,L"Creating view on sysBuffer texture" );
+		FrameTexture& tex = frameTextures[frame.slot];
+		// create the texture
+		if( FAILED( hr = pDevice->CreateTexture2D( &sysTexDesc,nullptr,&tex.pTexture ) ) )
+		{
+			throw CHILI_GFX_EXCEPTION( hr,L"Creating sysbuffer texture" );
+		}
+		// create the resource view on the texture
+		if( FAILED( hr = pDevice->CreateShaderResourceView( tex.pTexture.Get(),
+			&srvDesc,&tex.pTextureView ) ) )
+		{
+			throw CHILI_GFX_EXCEPTION( hr,L"Creating view on sysBuffer texture" );
+		}
+		// free frames stay mapped so BeginFrame can hand them out right away
+		MapFrameBuffer( frame );
 	}
 
 
@@ -238,29 +243,87 @@ Graphics::Graphics( HWNDKey& key )
 	{
 		throw CHILI_GFX_EXCEPTION( hr,L"Creating sampler state" );
 	}
+
+	// keep dxgi from queueing more frames than we do
+	SetMaxFrameLatency( GetMaxFrameLatency() );
+
+	// from here on the device context belongs to the present thread
+	StartPresenting();
 }
 
 Graphics::~Graphics()
 {
+	// let the present thread finish the frames already ended
+	StopPresenting();
+	for( auto& tex : frameTextures )
+	{
+		if( tex.mapped.pData )
+		{
+			pImmediateContext->Unmap( tex.pTexture.Get(),0u );
+		}
+	}
 	// clear the state of the device context before destruction
 	if( pImmediateContext ) pImmediateContext->ClearState();
 }
 
-void Graphics::EndFrame()
+void Graphics::SetMaxFrameLatency( unsigned int latency )
+{
+	latency = std::min( std::max( latency,1u ),nFrameBuffers - 1u );
+	ComPtr<IDXGIDevice1> pDxgiDevice;
+	HRESULT hr;
+	if( FAILED( hr = pDevice.As( &pDxgiDevice ) ) )
+	{
+		throw CHILI_GFX_EXCEPTION( hr,L"Getting dxgi device" );
+	}
+	if( FAILED( hr = pDxgiDevice->SetMaximumFrameLatency( latency ) ) )
+	{
+		throw CHILI_GFX_EXCEPTION( hr,L"Setting maximum frame latency" );
+	}
+	GraphicsCore::SetMaxFrameLatency( latency );
+}
+
+void Graphics::MapFrameBuffer( FrameBuffer& frame )
 {
 	HRESULT hr;
+	FrameTexture& tex = frameTextures[frame.slot];
 
-	// lock and map the adapter memory for copying over the sysbuffer
-	if( FAILED( hr = pImmediateContext->Map( pSysBufferTexture.Get(),0u,
-		D3D11_MAP_WRITE_DISCARD,0u,&mappedSysBufferTexture ) ) )
+	// lock and map the adapter memory (discard hands out fresh memory, no waiting
+	// for the gpu to be done with the last frame drawn from this texture)
+	if( FAILED( hr = pImmediateContext->Map( tex.pTexture.Get(),0u,
+		D3D11_MAP_WRITE_DISCARD,0u,&tex.mapped ) ) )
 	{
+		tex.mapped = {};
 		throw CHILI_GFX_EXCEPTION( hr,L"Mapping sysbuffer" );
 	}
-	// perform the copy line-by-line
-	sysBuffer.Present( mappedSysBufferTexture.RowPitch,
-		reinterpret_cast<BYTE*>(mappedSysBufferTexture.pData) );
+	// draw in place when the rows line up with whole pixels, otherwise
+	// fall back to system memory and a copy
+	const bool inPlace = zeroCopyPresent.load() && tex.mapped.RowPitch % sizeof( Color ) == 0u;
+	if( inPlace )
+	{
+		frame.surface = Surface::Borrow( ScreenWidth,ScreenHeight,
+			tex.mapped.RowPitch / sizeof( Color ),reinterpret_cast<Color*>(tex.mapped.pData) );
+	}
+	else if( tex.inPlace )
+	{
+		frame.surface = Surface( ScreenWidth,ScreenHeight );
+	}
+	tex.inPlace = inPlace;
+}
+
+void Graphics::Present( FrameBuffer& frame )
+{
+	HRESULT hr;
+	FrameTexture& tex = frameTextures[frame.slot];
+
+	// perform the copy line-by-line (unless the frame was drawn in place)
+	if( !tex.inPlace )
+	{
+		frame.surface.Present( tex.mapped.RowPitch,
+			reinterpret_cast<BYTE*>(tex.mapped.pData) );
+	}
 	// release the adapter memory
-	pImmediateContext->Unmap( pSysBufferTexture.Get(),0u );
+	pImmediateContext->Unmap( tex.pTexture.Get(),0u );
+	tex.mapped = {};
 
 	// render offscreen scene texture to back buffer
 	pImmediateContext->IASetInputLayout( pInputLayout.Get() );
@@ -270,7 +333,7 @@ void Graphics::EndFrame()
 	const UINT stride = sizeof( FSQVertex );
 	const UINT offset = 0u;
 	pImmediateContext->IASetVertexBuffers( 0u,1u,pVertexBuffer.GetAddressOf(),&stride,&offset );
-	pImmediateContext->PSSetShaderResources( 0u,1u,pSysBufferTextureView.GetAddressOf() );
+	pImmediateContext->PSSetShaderResources( 0u,1u,tex.pTextureView.GetAddressOf() );
 	pImmediateContext->PSSetSamplers( 0u,1u,pSamplerState.GetAddressOf() );
 	pImmediateContext->Draw( 6u,0u );
 
@@ -279,14 +342,13 @@ void Graphics::EndFrame()
 	{
 		throw CHILI_GFX_EXCEPTION( hr,L"Presenting back buffer" );
 	}
-}
 
-void Graphics::BeginFrame()
-{
-	sysBuffer.Clear( Colors::Red );
+	// ready to be drawn to again
+	MapFrameBuffer( frame );
 }
 
 
+
 //////////////////////////////////////////////////
 //           Graphics Exception
 Graphics::Exception::Exception( HRESULT hr,const std::wstring& note,const wchar_t* file,unsigned int line )
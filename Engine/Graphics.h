@@ -19,18 +19,25 @@
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
 #pragma once
+#ifdef CHILI_HEADLESS
+// no window or gpu, frames stay in memory (linux builds, benchmarks, tests)
+#include "HeadlessGraphics.h"
+#else
 #include <d3d11.h>
 #include <wrl.h>
+#include "GraphicsCore.h"
 #include "GDIPlusManager.h"
 #include "ChiliException.h"
-#include "Surface.h"
-#include "Colors.h"
 #include "Vec2.h"
 #include "ZBuffer.h"
+#include <atomic>
+#include <vector>
 
 #define CHILI_GFX_EXCEPTION( hr,note ) Graphics::Exception( hr,note,_CRT_WIDE(__FILE__),__LINE__ )
 
-class Graphics
+// presents the frames drawn by the core (GraphicsCore) with d3d11, each frame
+// buffer has its own texture and is drawn straight into it while mapped
+class Graphics : public GraphicsCore
 {
 public:
 	class Exception : public ChiliException
@@ -51,91 +58,50 @@ private:
 		float x,y,z;		// position
 		float u,v;			// texcoords
 	};
+	// texture of a frame buffer (same slot), it stays mapped while the frame
+	// is drawn so the frame can be drawn in place
+	struct FrameTexture
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>				pTexture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	pTextureView;
+		D3D11_MAPPED_SUBRESOURCE							mapped = {};
+		// the surface of the frame is a view of the mapped texture, otherwise it
+		// is system memory that gets copied over when presenting
+		bool												inPlace = false;
+	};
 public:
 	Graphics( class HWNDKey& key );
-	Graphics( const Graphics& ) = delete;
-	Graphics& operator=( const Graphics& ) = delete;
-	void EndFrame();
-	void BeginFrame();
-	void PutPixel( int x,int y,int r,int g,int b )
-	{
-		PutPixel( x,y,{ unsigned char( r ),unsigned char( g ),unsigned char( b ) } );
-	}
-	void PutPixel( int x,int y,Color c )
-	{
-		sysBuffer.PutPixel( x,y,c );
-	}
 	~Graphics();
-	void DrawLineDepth( ZBuffer& zb,Vec3& v0,Vec3& v1,Color c )
+	// also keeps dxgi from queueing more frames than that
+	void SetMaxFrameLatency( unsigned int latency );
+	// draw straight into the mapped texture memory when its layout fits a Surface
+	// instead of copying the frame over at present time (on by default, takes
+	// effect as the frame buffers come back from the present thread)
+	// the mapped memory is write-combined, fine for the rasterizer which only
+	// writes, slow for anything that reads the frame back while drawing
+	void SetZeroCopyPresent( bool enable )
 	{
-		float dx = v1.x - v0.x;
-		float dy = v1.y - v0.y;
-
-		if( dy == 0.0f && dx == 0.0f )
-		{}
-		else if( abs( dy ) > abs( dx ) )
-		{
-			if( dy < 0.0f )
-			{
-				std::swap( v0,v1 );
-				dy = -dy;
-			}
-
-			const auto dv = (v1 - v0) / dy;
-			for( auto v = v0; v.y < v1.y; v += dv )
-			{
-				const auto x = int( v.x );
-				const auto y = int( v.y );
-				if( x < 0 || x >= Graphics::ScreenWidth || y < 0 || y >= Graphics::ScreenHeight )
-				{
-					continue;
-				}
-				if( zb.TestAndSet( x,y,v.z ) )
-				{
-					PutPixel( x,y,c );
-				}
-			}
-		}
-		else
-		{
-			if( dx < 0.0f )
-			{
-				std::swap( v0,v1 );
-				dx = -dx;
-			}
-
-			const auto dv = (v1 - v0) / dx;
-			for( auto v = v0; v.x < v1.x; v += dv )
-			{
-				const auto x = int( v.x );
-				const auto y = int( v.y );
-				if( x < 0 || x >= Graphics::ScreenWidth || y < 0 || y >= Graphics::ScreenHeight )
-				{
-					continue;
-				}
-				if( zb.TestAndSet( x,y,v.z ) )
-				{
-					PutPixel( x,y,c );
-				}
-			}
-		}
+		zeroCopyPresent.store( enable );
 	}
+private:
+	// maps the texture of a frame buffer and points its surface at it if possible
+	// (construction and present thread only)
+	void MapFrameBuffer( FrameBuffer& frame );
+	// unmaps the texture of a frame (copying the frame over if it wasn't drawn in
+	// place), presents it and maps it again for the next time it is drawn
+	virtual void Present( FrameBuffer& frame ) override;
 private:
 	GDIPlusManager										gdipMan;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>				pSwapChain;
 	Microsoft::WRL::ComPtr<ID3D11Device>				pDevice;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext>			pImmediateContext;
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView>		pRenderTargetView;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D>				pSysBufferTexture;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	pSysBufferTextureView;
 	Microsoft::WRL::ComPtr<ID3D11PixelShader>			pPixelShader;
 	Microsoft::WRL::ComPtr<ID3D11VertexShader>			pVertexShader;
 	Microsoft::WRL::ComPtr<ID3D11Buffer>				pVertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout>			pInputLayout;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState>			pSamplerState;
-	D3D11_MAPPED_SUBRESOURCE							mappedSysBufferTexture;
-	Surface												sysBuffer;
-public:
-	static constexpr unsigned int ScreenWidth = 640u;
-	static constexpr unsigned int ScreenHeight = 480u;
-};
\ No newline at end of file
+	std::vector<FrameTexture>							frameTextures;
+	std::atomic<bool>									zeroCopyPresent{ true };
+};
+#endif
\ No newline at end of file
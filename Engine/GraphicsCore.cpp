@@ -0,0 +1,152 @@
+#include "GraphicsCore.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cassert>
+
+GraphicsCore::GraphicsCore()
+{
+	frameBuffers.reserve( nFrameBuffers );
+	for( unsigned int i = 0; i < nFrameBuffers; i++ )
+	{
+		frameBuffers.emplace_back( ScreenWidth,ScreenHeight,i );
+		freeBuffers.push_back( &frameBuffers.back() );
+	}
+}
+
+GraphicsCore::~GraphicsCore()
+{
+	// the backend has to have stopped it, Present() is gone by now
+	assert( !presentThread.joinable() );
+}
+
+void GraphicsCore::StartPresenting()
+{
+	presentThread = std::thread( &GraphicsCore::PresentLoop,this );
+}
+
+void GraphicsCore::StopPresenting()
+{
+	{
+		std::lock_guard<std::mutex> lock( presentMtx );
+		stopping = true;
+	}
+	cvPresent.notify_all();
+	if( presentThread.joinable() )
+	{
+		presentThread.join();
+	}
+}
+
+void GraphicsCore::SetMaxFrameLatency( unsigned int latency )
+{
+	{
+		std::lock_guard<std::mutex> lock( presentMtx );
+		maxFrameLatency = std::min( std::max( latency,1u ),nFrameBuffers - 1u );
+	}
+	cvBufferFree.notify_all();
+}
+
+unsigned int GraphicsCore::GetMaxFrameLatency()
+{
+	std::lock_guard<std::mutex> lock( presentMtx );
+	return maxFrameLatency;
+}
+
+void GraphicsCore::EndFrame()
+{
+	CHILI_TRACE( "Graphics::EndFrame" );
+	{
+		std::lock_guard<std::mutex> lock( presentMtx );
+		RethrowPresentError();
+		pRenderBuffer->index = frameCount++;
+		presentQueue.push_back( pRenderBuffer );
+		nFramesInFlight++;
+	}
+	cvPresent.notify_one();
+}
+
+void GraphicsCore::BeginFrame()
+{
+	CHILI_TRACE( "Graphics::BeginFrame" );
+	{
+		std::unique_lock<std::mutex> lock( presentMtx );
+		cvBufferFree.wait( lock,[this]
+		{
+			return presentError || (!freeBuffers.empty() && nFramesInFlight < maxFrameLatency);
+		} );
+		RethrowPresentError();
+		pRenderBuffer = freeBuffers.back();
+		freeBuffers.pop_back();
+	}
+	pRenderBuffer->clearColor = Colors::Red;
+	pRenderBuffer->clearEpochs.Invalidate();
+	pRenderBuffer->debugView = debugView.load();
+	if( pRenderBuffer->debugView != DebugView::None )
+	{
+		pRenderBuffer->overdraw.Clear( ScreenWidth,ScreenHeight );
+	}
+}
+
+void GraphicsCore::Flush()
+{
+	std::unique_lock<std::mutex> lock( presentMtx );
+	cvBufferFree.wait( lock,[this]
+	{
+		return presentError || nFramesInFlight == 0u;
+	} );
+	RethrowPresentError();
+}
+
+void GraphicsCore::RethrowPresentError()
+{
+	if( presentError )
+	{
+		std::rethrow_exception( presentError );
+	}
+}
+
+void GraphicsCore::PresentLoop()
+{
+	Trace::SetThreadName( "present" );
+	std::unique_lock<std::mutex> lock( presentMtx );
+	while( true )
+	{
+		cvPresent.wait( lock,[this]
+		{
+			return stopping || !presentQueue.empty();
+		} );
+		if( presentQueue.empty() )
+		{
+			return;
+		}
+		FrameBuffer* const pFrame = presentQueue.front();
+		presentQueue.pop_front();
+		lock.unlock();
+		std::exception_ptr error;
+		try
+		{
+			CHILI_TRACE( "Graphics::Present","present" );
+			// fill whatever wasn't drawn to with the clear color
+			pFrame->ResolveClear();
+			if( pFrame->debugView != DebugView::None )
+			{
+				pFrame->overdraw.Resolve( pFrame->surface,pFrame->debugView );
+			}
+			Present( *pFrame );
+		}
+		catch( ... )
+		{
+			error = std::current_exception();
+		}
+		lock.lock();
+		freeBuffers.push_back( pFrame );
+		nFramesInFlight--;
+		cvBufferFree.notify_all();
+		// the render thread picks this up in BeginFrame / EndFrame / Flush
+		if( error )
+		{
+			presentError = error;
+			return;
+		}
+	}
+}
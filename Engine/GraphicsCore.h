@@ -0,0 +1,202 @@
+#pragma once
+#include "Surface.h"
+#include "Colors.h"
+#include "Vec3.h"
+#include "FastClear.h"
+#include "Overdraw.h"
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the part of Graphics that doesn't depend on the platform: the frame buffers
+// the scenes draw to (with lazy tile clears), the frame latency limit, the debug
+// views and the present thread
+// the backends (Graphics.h picks one) derive from it, create their device and
+// put finished frames wherever they go in Present(), on the present thread
+class GraphicsCore
+{
+protected:
+	// one frame in flight, drawn to while the others wait for the present thread
+	struct FrameBuffer
+	{
+		FrameBuffer( unsigned int width,unsigned int height,unsigned int slot )
+			:
+			surface( width,height ),
+			clearEpochs( int( width ),int( height ) ),
+			slot( slot )
+		{}
+		// fills the tiles that haven't been drawn to since BeginFrame
+		void ResolveClear()
+		{
+			clearEpochs.ResolveAll( [this]( const RectI& tile )
+			{
+				surface.Fill( tile,clearColor );
+			} );
+		}
+		// drawn to, system memory unless the backend points it elsewhere
+		// (only while the frame is free or being presented)
+		Surface				surface;
+		// tiles are cleared lazily, on the first PutPixel or at present time
+		TileEpochs			clearEpochs;
+		Color				clearColor;
+		// position in the frame buffers, for whatever the backend keeps per frame
+		unsigned int		slot;
+		// frames ended before this one
+		unsigned int		index = 0u;
+		// debug view the frame was drawn with, shown instead of the frame at present time
+		DebugView			debugView = DebugView::None;
+		OverdrawCounters	overdraw;
+	};
+public:
+	GraphicsCore();
+	GraphicsCore( const GraphicsCore& ) = delete;
+	GraphicsCore& operator=( const GraphicsCore& ) = delete;
+	virtual ~GraphicsCore();
+	// hands the finished frame to the present thread (only blocks if that thread failed)
+	void EndFrame();
+	// picks a frame buffer that isn't waiting to be presented and clears it (lazily,
+	// tiles get filled when first drawn to or at present), waits while the maximum
+	// number of frames are in flight
+	// (draw only between BeginFrame and EndFrame)
+	void BeginFrame();
+	// frames that may be queued for presentation before BeginFrame waits
+	// (1 .. nFrameBuffers - 1, lower means less input lag, higher smoother frame pacing)
+	void SetMaxFrameLatency( unsigned int latency );
+	// waits until every frame ended so far has been presented
+	void Flush();
+	// frames ended so far
+	unsigned int GetFrameCount() const
+	{
+		return frameCount;
+	}
+	// shows the overdraw / shading cost heatmap picked instead of the shaded frame
+	// (see Overdraw.h), takes effect with the next BeginFrame
+	void SetDebugView( DebugView view )
+	{
+		debugView.store( view );
+	}
+	DebugView GetDebugView() const
+	{
+		return debugView.load();
+	}
+	// counters of the frame being drawn if it is drawn for a debug view (the
+	// pipelines count into them instead of shading), null otherwise
+	OverdrawCounters* GetOverdrawCounters()
+	{
+		return pRenderBuffer->debugView != DebugView::None ? &pRenderBuffer->overdraw : nullptr;
+	}
+	void PutPixel( int x,int y,int r,int g,int b )
+	{
+		PutPixel( x,y,{ (unsigned char)r,(unsigned char)g,(unsigned char)b } );
+	}
+	void PutPixel( int x,int y,Color c )
+	{
+		FrameBuffer& frame = *pRenderBuffer;
+		if( frame.clearEpochs.Claim( x,y ) )
+		{
+			frame.surface.Fill( frame.clearEpochs.GetTileRect( x,y ),frame.clearColor );
+		}
+		frame.surface.PutPixel( x,y,c );
+	}
+	template<class Depth>
+	void DrawLineDepth( Depth& zb,Vec3& v0,Vec3& v1,Color c )
+	{
+		float dx = v1.x - v0.x;
+		float dy = v1.y - v0.y;
+
+		if( dy == 0.0f && dx == 0.0f )
+		{}
+		else if( std::abs( dy ) > std::abs( dx ) )
+		{
+			if( dy < 0.0f )
+			{
+				std::swap( v0,v1 );
+				dy = -dy;
+			}
+
+			const auto dv = (v1 - v0) / dy;
+			for( auto v = v0; v.y < v1.y; v += dv )
+			{
+				const auto x = int( v.x );
+				const auto y = int( v.y );
+				if( x < 0 || x >= int( ScreenWidth ) || y < 0 || y >= int( ScreenHeight ) )
+				{
+					continue;
+				}
+				if( zb.TestAndSet( x,y,v.z ) )
+				{
+					PutPixel( x,y,c );
+				}
+			}
+		}
+		else
+		{
+			if( dx < 0.0f )
+			{
+				std::swap( v0,v1 );
+				dx = -dx;
+			}
+
+			const auto dv = (v1 - v0) / dx;
+			for( auto v = v0; v.x < v1.x; v += dv )
+			{
+				const auto x = int( v.x );
+				const auto y = int( v.y );
+				if( x < 0 || x >= int( ScreenWidth ) || y < 0 || y >= int( ScreenHeight ) )
+				{
+					continue;
+				}
+				if( zb.TestAndSet( x,y,v.z ) )
+				{
+					PutPixel( x,y,c );
+				}
+			}
+		}
+	}
+protected:
+	// the backend starts the present thread once its device is ready and stops it
+	// first thing in its destructor (Present() runs on it), frames ended before
+	// that still get presented
+	void StartPresenting();
+	void StopPresenting();
+	// puts a finished frame on the screen / wherever frames go (present thread
+	// only), the clear and the debug view have been resolved into its surface
+	virtual void Present( FrameBuffer& frame ) = 0;
+	// the backend may point the surfaces of free frames at its own memory
+	// (construction and present thread only)
+	std::vector<FrameBuffer>& GetFrameBuffers()
+	{
+		return frameBuffers;
+	}
+	unsigned int GetMaxFrameLatency();
+private:
+	void PresentLoop();
+	// throws what the present thread threw (presentMtx must be held)
+	void RethrowPresentError();
+public:
+	static constexpr unsigned int nFrameBuffers = 3u;
+	static constexpr unsigned int ScreenWidth = 640u;
+	static constexpr unsigned int ScreenHeight = 480u;
+private:
+	// frame buffers, one is drawn to while finished ones wait for the present thread
+	std::vector<FrameBuffer>	frameBuffers;
+	FrameBuffer*				pRenderBuffer = nullptr;
+	std::vector<FrameBuffer*>	freeBuffers;
+	std::deque<FrameBuffer*>	presentQueue;
+	unsigned int				frameCount = 0u;
+	// frames queued or being presented
+	unsigned int				nFramesInFlight = 0u;
+	unsigned int				maxFrameLatency = 2u;
+	std::mutex					presentMtx;
+	std::condition_variable		cvPresent;
+	std::condition_variable		cvBufferFree;
+	std::exception_ptr			presentError;
+	bool						stopping = false;
+	std::atomic<DebugView>		debugView{ DebugView::None };
+	std::thread					presentThread;
+};
@@ -0,0 +1,75 @@
+#include "Graphics.h"
+
+#ifdef CHILI_HEADLESS
+#include "MappedFile.h"
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+Graphics::Graphics()
+{
+	StartPresenting();
+}
+
+Graphics::~Graphics()
+{
+	// frames already ended still get output, unlike a window nobody looks at
+	StopPresenting();
+}
+
+void Graphics::SetFrameOutput( FrameOutput output_in )
+{
+	std::lock_guard<std::mutex> lock( outputMtx );
+	output = std::move( output_in );
+}
+
+Graphics::FrameOutput Graphics::ImageSequence( std::wstring prefix,std::wstring extension )
+{
+	return [prefix,extension]( const Surface& frame,unsigned int index )
+	{
+		std::wstringstream ss;
+		ss << prefix << std::setw( 5 ) << std::setfill( L'0' ) << index << extension;
+		frame.Save( ss.str() );
+	};
+}
+
+Graphics::FrameOutput Graphics::RawStream( const std::wstring& filename )
+{
+	auto pFile = std::make_shared<std::ofstream>( ToNarrowPath( filename ),std::ios::binary );
+	if( !*pFile )
+	{
+		std::wstringstream ss;
+		ss << L"Opening raw frame stream [" << filename << L"]: failed to open file.";
+		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+	return [pFile,filename]( const Surface& frame,unsigned int )
+	{
+		const std::streamsize rowBytes = std::streamsize( frame.GetWidth() * sizeof( Color ) );
+		for( unsigned int y = 0; y < frame.GetHeight(); y++ )
+		{
+			pFile->write( reinterpret_cast<const char*>( frame.GetBufferPtrConst() + frame.GetPitch() * y ),rowBytes );
+		}
+		if( !pFile->flush() )
+		{
+			std::wstringstream ss;
+			ss << L"Writing raw frame stream [" << filename << L"]: write failed.";
+			throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+		}
+	};
+}
+
+void Graphics::Present( FrameBuffer& frame )
+{
+	// a copy, the output may be swapped out while this one is running
+	FrameOutput frameOutput;
+	{
+		std::lock_guard<std::mutex> lock( outputMtx );
+		frameOutput = output;
+	}
+	if( frameOutput )
+	{
+		frameOutput( frame.surface,frame.index );
+	}
+}
+#endif
\ No newline at end of file
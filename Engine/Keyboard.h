@@ -25,6 +25,7 @@
 class Keyboard
 {
 	friend class MainWindow;
+	friend class InputScript;
 public:
 	class Event
 	{
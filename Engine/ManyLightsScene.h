@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Scene.h"
+#include "Mat.h"
+#include "Pipeline.h"
+#include "SpecularPhongPointEffect.h"
+#include "SolidEffect.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Codex.h"
+#include "TiledLightList.h"
+#include "TransformHierarchy.h"
+
+// short range lights, so each one only touches a part of the screen
+struct ManyLightsDiffuseParams
+{
+	static constexpr float linear_attenuation = 0.0f;
+	static constexpr float quadradic_attenuation = 300.0f;
+	static constexpr float constant_attenuation = 0.2f;
+};
+
+// swarm of small colored point lights circling over a floor, shaded through a tiled light list
+class ManyLightsScene : public Scene
+{
+	using SpecularPhongPointEffect = ::SpecularPhongPointEffect<ManyLightsDiffuseParams,DefaultSpecularParams>;
+public:
+	// short depth range, 16 bits are plenty (and the floor is mostly plane tiles)
+	typedef DepthBuffer<DepthUnorm16> Depth;
+	typedef ::Pipeline<SpecularPhongPointEffect,Depth> Pipeline;
+	typedef ::Pipeline<SolidEffect,Depth> LightIndicatorPipeline;
+	typedef Pipeline::Vertex Vertex;
+public:
+	ManyLightsScene( Graphics& gfx )
+		:
+		pZb( std::make_shared<Depth>( gfx.ScreenWidth,gfx.ScreenHeight ) ),
+		pipeline( gfx,pZb ),
+		liPipeline( gfx,pZb ),
+		Scene( "many point lights tiled light list" )
+	{
+		for( auto& v : lightIndicator.vertices )
+		{
+			v.color = Colors::White;
+		}
+		// the camera doesn't move, after the first frame only suzanne is recomputed
+		viewNode = transforms.AddNode( Mat4x3::Translation( -cam_pos ) * Mat4x3::RotationX( cam_pitch ) );
+		floorNode = transforms.AddNode( Mat4x3::RotationX( PI / 2.0f ) * Mat4x3::Translation( center ),viewNode );
+		suzanneNode = transforms.AddNode( GetSuzanneLocal(),viewNode );
+	}
+	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) override
+	{
+		prev_t = t;
+		t += dt;
+	}
+	virtual void Interpolate( float alpha ) override
+	{
+		draw_t = Blend( prev_t,t,alpha );
+		theta_y = wrap_angle( draw_t * rotspeed );
+		transforms.SetLocal( suzanneNode,GetSuzanneLocal() );
+	}
+	// Draw only goes by draw_t and the transforms
+	virtual bool CanUpdateWhileDrawing() const override
+	{
+		return true;
+	}
+	virtual void Draw() override
+	{
+		pipeline.BeginFrame();
+
+		const auto proj = Mat4::ProjectionHFOV( hfov,aspect_ratio,0.2f,6.0f );
+		transforms.Update();
+		const auto& view = transforms.GetWorld( viewNode );
+
+		// place the lights on rings around the center of the floor, alternating direction
+		lightList.Clear();
+		for( int i = 0; i < nLights; i++ )
+		{
+			const int ring = i % nRings;
+			const float radius = 0.25f + 1.5f * float( ring ) / float( nRings - 1 );
+			const float dir = ring % 2 == 0 ? 1.0f : -1.0f;
+			const float angle = wrap_angle( 2.0f * PI * float( i / nRings ) / float( nLights / nRings ) + dir * draw_t * orbitspeed / radius );
+			const auto pos = center + Vec3{ radius * std::cos( angle ),l_height,radius * std::sin( angle ) };
+			const float hue = 2.0f * PI * float( i ) / float( nLights );
+			const Vec3 color = Vec3{
+				0.5f + 0.5f * std::cos( hue ),
+				0.5f + 0.5f * std::cos( hue - 2.0f * PI / 3.0f ),
+				0.5f + 0.5f * std::cos( hue + 2.0f * PI / 3.0f )
+			} * l_brightness;
+			lightList.AddLight( { Vec4( pos ) * view,color } );
+		}
+		lightList.Build( proj );
+		pipeline.effect.ps.SetLightList( &lightList );
+		pipeline.effect.ps.SetAmbientLight( l_ambient );
+		pipeline.effect.vs.BindProjection( proj );
+
+		// render floor
+		pipeline.effect.vs.BindWorldView( transforms.GetWorld( floorNode ) );
+		pipeline.Draw( floorPlane );
+
+		// render suzanne
+		pipeline.effect.vs.BindWorldView( transforms.GetWorld( suzanneNode ) );
+		pipeline.Draw( *pSuzanne );
+
+		// light indicators
+		liPipeline.effect.vs.BindProjection( proj );
+		for( const auto& l : lightList.GetLights() )
+		{
+			liPipeline.effect.vs.BindWorldView( Mat4x3::Translation( l.pos ) );
+			liPipeline.Draw( lightIndicator );
+		}
+	}
+private:
+	Mat4x3 GetSuzanneLocal() const
+	{
+		return Mat4x3::RotationY( theta_y ) *
+			Mat4x3::Scaling( scale ) *
+			Mat4x3::Translation( center + Vec3{ 0.0f,0.4f,0.0f } );
+	}
+private:
+	// t of the last two updates, and the one drawn between them
+	float t = 0.0f;
+	float prev_t = 0.0f;
+	float draw_t = 0.0f;
+	std::shared_ptr<Depth> pZb;
+	Pipeline pipeline;
+	LightIndicatorPipeline liPipeline;
+	// view
+	static constexpr float aspect_ratio = 1.33333f;
+	static constexpr float hfov = 85.0f;
+	// the view rotates the world, so a negative pitch tilts the camera down
+	// (the camera sits above the floor and looks down at the lights)
+	static constexpr float cam_pitch = -0.45f;
+	Vec3 cam_pos = { 0.0f,0.4f,-0.6f };
+	// models
+	Vec3 center = { 0.0f,-0.6f,1.6f };
+	IndexedTriangleList<Vertex> floorPlane = Plane::GetNormals<Vertex>( 40,40,4.0f,4.0f );
+	std::shared_ptr<const IndexedTriangleList<Vertex>> pSuzanne = Codex<IndexedTriangleList<Vertex>,CenteredMeshLoader<NormalsMeshLoader<Vertex>>>::Retrieve( L"models\\suzanne.obj" );
+	float theta_y = 0.0f;
+	float rotspeed = PI / 4.0f;
+	float scale = 0.4f;
+	// lights
+	static constexpr int nLights = 192;
+	static constexpr int nRings = 8;
+	static constexpr float l_height = 0.08f;
+	static constexpr float l_brightness = 0.6f;
+	static constexpr float orbitspeed = 0.3f;
+	Vec3 l_ambient = { 0.08f,0.08f,0.08f };
+	TiledLightList<ManyLightsDiffuseParams> lightList = TiledLightList<ManyLightsDiffuseParams>( 1.0f / 256.0f );
+	IndexedTriangleList<SolidEffect::Vertex> lightIndicator = Sphere::GetPlain<SolidEffect::Vertex>( 0.015f,4,8 );
+	// transforms
+	TransformHierarchy transforms;
+	TransformHierarchy::Node viewNode;
+	TransformHierarchy::Node floorNode;
+	TransformHierarchy::Node suzanneNode;
+};
\ No newline at end of file
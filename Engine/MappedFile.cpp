@@ -0,0 +1,147 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define FULL_WINTARD
+#include "ChiliWin.h"
+
+MappedFile::MappedFile( const std::wstring& path )
+{
+	hFile = CreateFileW( path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,
+		OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,nullptr );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		hFile = nullptr;
+		throw std::runtime_error( "MappedFile: failed to open file" );
+	}
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx( hFile,&fileSize ) )
+	{
+		CloseHandle( hFile );
+		throw std::runtime_error( "MappedFile: failed to get file size" );
+	}
+	size = size_t( fileSize.QuadPart );
+	// zero-length files cannot be mapped, leave them as an empty view
+	if( size == 0u )
+	{
+		return;
+	}
+	hMapping = CreateFileMappingW( hFile,nullptr,PAGE_WRITECOPY,0u,0u,nullptr );
+	if( hMapping == nullptr )
+	{
+		CloseHandle( hFile );
+		throw std::runtime_error( "MappedFile: failed to create file mapping" );
+	}
+	pData = static_cast<unsigned char*>(MapViewOfFile( hMapping,FILE_MAP_COPY,0u,0u,0u ));
+	if( pData == nullptr )
+	{
+		CloseHandle( hMapping );
+		CloseHandle( hFile );
+		throw std::runtime_error( "MappedFile: failed to map view of file" );
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if( pData )
+	{
+		UnmapViewOfFile( pData );
+	}
+	if( hMapping )
+	{
+		CloseHandle( hMapping );
+	}
+	if( hFile )
+	{
+		CloseHandle( hFile );
+	}
+}
+
+std::string ToNarrowPath( const std::wstring& path )
+{
+	const int len = WideCharToMultiByte( CP_ACP,0u,path.c_str(),int( path.size() ),nullptr,0,nullptr,nullptr );
+	std::string narrow( size_t( len ),'\0' );
+	WideCharToMultiByte( CP_ACP,0u,path.c_str(),int( path.size() ),&narrow[0],len,nullptr,nullptr );
+	return narrow;
+}
+
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile( const std::wstring& path )
+{
+	const int fd = open( ToNarrowPath( path ).c_str(),O_RDONLY );
+	if( fd < 0 )
+	{
+		throw std::runtime_error( "MappedFile: failed to open file" );
+	}
+	struct stat st;
+	if( fstat( fd,&st ) != 0 )
+	{
+		close( fd );
+		throw std::runtime_error( "MappedFile: failed to get file size" );
+	}
+	size = size_t( st.st_size );
+	// zero-length files cannot be mapped, leave them as an empty view
+	if( size != 0u )
+	{
+		void* const p = mmap( nullptr,size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0 );
+		if( p == MAP_FAILED )
+		{
+			close( fd );
+			throw std::runtime_error( "MappedFile: failed to map file" );
+		}
+		pData = static_cast<unsigned char*>(p);
+	}
+	// the mapping keeps its own reference to the file
+	close( fd );
+}
+
+MappedFile::~MappedFile()
+{
+	if( pData )
+	{
+		munmap( pData,size );
+	}
+}
+
+std::string ToNarrowPath( const std::wstring& path )
+{
+	std::string narrow;
+	narrow.reserve( path.size() );
+	for( const wchar_t wc : path )
+	{
+		const unsigned long c = (unsigned long)wc;
+		if( c == L'\\' )
+		{
+			narrow.push_back( '/' );
+		}
+		else if( c < 0x80u )
+		{
+			narrow.push_back( char( c ) );
+		}
+		else if( c < 0x800u )
+		{
+			narrow.push_back( char( 0xC0u | (c >> 6u) ) );
+			narrow.push_back( char( 0x80u | (c & 0x3Fu) ) );
+		}
+		else if( c < 0x10000u )
+		{
+			narrow.push_back( char( 0xE0u | (c >> 12u) ) );
+			narrow.push_back( char( 0x80u | ((c >> 6u) & 0x3Fu) ) );
+			narrow.push_back( char( 0x80u | (c & 0x3Fu) ) );
+		}
+		else
+		{
+			narrow.push_back( char( 0xF0u | (c >> 18u) ) );
+			narrow.push_back( char( 0x80u | ((c >> 12u) & 0x3Fu) ) );
+			narrow.push_back( char( 0x80u | ((c >> 6u) & 0x3Fu) ) );
+			narrow.push_back( char( 0x80u | (c & 0x3Fu) ) );
+		}
+	}
+	return narrow;
+}
+#endif
\ No newline at end of file
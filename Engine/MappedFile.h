@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+// read-only view of a whole file mapped into memory
+// the mapping is private (copy-on-write) so callers may scribble over the
+// pixels of a mapped image without the changes ever reaching the file
+class MappedFile
+{
+public:
+	// throws std::runtime_error if the file cannot be opened or mapped
+	MappedFile( const std::wstring& path );
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+	~MappedFile();
+	unsigned char* GetData() const
+	{
+		return pData;
+	}
+	size_t GetSize() const
+	{
+		return size;
+	}
+private:
+	unsigned char* pData = nullptr;
+	size_t size = 0u;
+#ifdef _WIN32
+	void* hFile = nullptr;
+	void* hMapping = nullptr;
+#endif
+};
+
+// converts a wide path to what the narrow file apis of the platform expect
+// (utf-8 with forward slashes on non-windows platforms)
+std::string ToNarrowPath( const std::wstring& path );
\ No newline at end of file
@@ -22,6 +22,8 @@
 
 #include "Vec3.h"
 #include "Vec4.h"
+#include <cstring>
+#include <xmmintrin.h>
 
 template <typename T,size_t S>
 class _Mat
@@ -102,7 +104,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
 	constexpr static _Mat Scaling( T factor )
@@ -126,7 +128,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 
 	}
@@ -153,7 +155,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
 	static _Mat RotationY( T theta )
@@ -179,7 +181,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
 	static _Mat RotationX( T theta )
@@ -205,7 +207,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
 	template<class V>
@@ -226,7 +228,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
 	constexpr static _Mat Projection( T w,T h,T n,T f )
@@ -242,7 +244,7 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
 	constexpr static _Mat ProjectionHFOV( T fov,T ar,T n,T f )
@@ -261,9 +263,15 @@ public:
 		}
 		else
 		{
-			static_assert(false,"Bad dimensionality");
+			static_assert(sizeof( T ) == 0,"Bad dimensionality");
 		}
 	}
+	// near and far swapped, depth goes from 1 at the near plane to 0 at the far
+	// plane (for the reversed depth formats in DepthFormats.h)
+	constexpr static _Mat ProjectionHFOVReversed( T fov,T ar,T n,T f )
+	{
+		return ProjectionHFOV( fov,ar,f,n );
+	}
 public:
 	// [ row ][ col ]
 	T elements[S][S];
@@ -302,6 +310,59 @@ _Vec4<T> operator*( const _Vec4<T>& lhs,const _Mat<T,4>& rhs )
 	};
 }
 
+// sse versions of the float matrix products, every row of the result is built
+// as the sum of the rows of rhs scaled by the elements of the row of lhs, adding
+// up in the order of the templates so the results are bit identical
+// (define CHILI_SCALAR_MATH to get the templates, see Bench/MathBench.cpp)
+// Mat3 * Mat3 stays with the template, loading and storing rows of 3 floats
+// costs more than the sse math saves
+#ifndef CHILI_SCALAR_MATH
+template<>
+inline _Mat<float,4> _Mat<float,4>::operator*( const _Mat<float,4>& rhs ) const
+{
+	const __m128 r0 = _mm_loadu_ps( rhs.elements[0] );
+	const __m128 r1 = _mm_loadu_ps( rhs.elements[1] );
+	const __m128 r2 = _mm_loadu_ps( rhs.elements[2] );
+	const __m128 r3 = _mm_loadu_ps( rhs.elements[3] );
+	_Mat<float,4> result;
+	for( size_t j = 0; j < 4; j++ )
+	{
+		const float* const row = elements[j];
+		// the template starts its sums at 0 (which turns -0 into 0)
+		__m128 sum = _mm_add_ps( _mm_setzero_ps(),_mm_mul_ps( _mm_set1_ps( row[0] ),r0 ) );
+		sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( row[1] ),r1 ) );
+		sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( row[2] ),r2 ) );
+		sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( row[3] ),r3 ) );
+		_mm_storeu_ps( result.elements[j],sum );
+	}
+	return result;
+}
+
+template<>
+inline _Vec3<float> operator*( const _Vec3<float>& lhs,const _Mat<float,3>& rhs )
+{
+	__m128 sum = _mm_mul_ps( _mm_set1_ps( lhs.x ),LoadFloat3( rhs.elements[0] ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.y ),LoadFloat3( rhs.elements[1] ) ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.z ),LoadFloat3( rhs.elements[2] ) ) );
+	_Vec3<float> result;
+	StoreVec3( result,sum );
+	return result;
+}
+
+template<>
+inline _Vec4<float> operator*( const _Vec4<float>& lhs,const _Mat<float,4>& rhs )
+{
+	static_assert( sizeof( _Vec4<float> ) == 4u * sizeof( float ),"x,y,z,w are stored as one array" );
+	__m128 sum = _mm_mul_ps( _mm_set1_ps( lhs.x ),_mm_loadu_ps( rhs.elements[0] ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.y ),_mm_loadu_ps( rhs.elements[1] ) ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.z ),_mm_loadu_ps( rhs.elements[2] ) ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.w ),_mm_loadu_ps( rhs.elements[3] ) ) );
+	_Vec4<float> result;
+	_mm_storeu_ps( &result.x,sum );
+	return result;
+}
+#endif
+
 typedef _Mat<float,3> Mat3;
 typedef _Mat<double,3> Mad3;
 typedef _Mat<float,4> Mat4;
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "Mat.h"
+#include <cmath>
+
+// affine transform (rotation, scaling, translation) for world and view matrices,
+// the 4x4 matrix with the last column left out (always 0,0,0,1), so composing
+// two of them and transforming points / directions skips the work on that column
+// row vector convention like _Mat (v * world * view), translation in row 3
+template <typename T>
+class _Mat4x3
+{
+public:
+	_Mat4x3& operator*=( const _Mat4x3& rhs )
+	{
+		return *this = *this * rhs;
+	}
+	// sums add up in the order of _Mat<T,4>::operator* (minus the terms with the
+	// last column, which are all +-0), so the results match composing the 4x4 versions
+	_Mat4x3 operator*( const _Mat4x3& rhs ) const
+	{
+		_Mat4x3 result;
+		for( size_t j = 0; j < 4; j++ )
+		{
+			for( size_t k = 0; k < 3; k++ )
+			{
+				T sum = (T)0.0;
+				for( size_t i = 0; i < 3; i++ )
+				{
+					sum += elements[j][i] * rhs.elements[i][k];
+				}
+				if( j == 3 )
+				{
+					sum += rhs.elements[3][k];
+				}
+				result.elements[j][k] = sum;
+			}
+		}
+		return result;
+	}
+	// applying a projection (world view * proj), the result isn't affine anymore
+	_Mat<T,4> operator*( const _Mat<T,4>& rhs ) const
+	{
+		_Mat<T,4> result;
+		for( size_t j = 0; j < 4; j++ )
+		{
+			for( size_t k = 0; k < 4; k++ )
+			{
+				T sum = (T)0.0;
+				for( size_t i = 0; i < 3; i++ )
+				{
+					sum += elements[j][i] * rhs.elements[i][k];
+				}
+				if( j == 3 )
+				{
+					sum += rhs.elements[3][k];
+				}
+				result.elements[j][k] = sum;
+			}
+		}
+		return result;
+	}
+	// transpose of the rotation / scaling part, the translation is dropped
+	// (the inverse of a pure rotation)
+	_Mat4x3 operator!() const
+	{
+		_Mat4x3 xp;
+		for( size_t j = 0; j < 3; j++ )
+		{
+			for( size_t k = 0; k < 3; k++ )
+			{
+				xp.elements[j][k] = elements[k][j];
+			}
+			xp.elements[3][j] = (T)0.0;
+		}
+		return xp;
+	}
+	explicit operator _Mat<T,4>() const
+	{
+		_Mat<T,4> m;
+		for( size_t j = 0; j < 4; j++ )
+		{
+			for( size_t k = 0; k < 3; k++ )
+			{
+				m.elements[j][k] = elements[j][k];
+			}
+			m.elements[j][3] = j == 3 ? (T)1.0 : (T)0.0;
+		}
+		return m;
+	}
+	// p * transform with w = 1
+	_Vec3<T> TransformPoint( const _Vec3<T>& p ) const
+	{
+		return{
+			p.x * elements[0][0] + p.y * elements[1][0] + p.z * elements[2][0] + elements[3][0],
+			p.x * elements[0][1] + p.y * elements[1][1] + p.z * elements[2][1] + elements[3][1],
+			p.x * elements[0][2] + p.y * elements[1][2] + p.z * elements[2][2] + elements[3][2]
+		};
+	}
+	// d * transform with w = 0 (no translation)
+	_Vec3<T> TransformVector( const _Vec3<T>& d ) const
+	{
+		return{
+			d.x * elements[0][0] + d.y * elements[1][0] + d.z * elements[2][0],
+			d.x * elements[0][1] + d.y * elements[1][1] + d.z * elements[2][1],
+			d.x * elements[0][2] + d.y * elements[1][2] + d.z * elements[2][2]
+		};
+	}
+	constexpr static _Mat4x3 Identity()
+	{
+		return Scaling( (T)1.0 );
+	}
+	constexpr static _Mat4x3 Scaling( T factor )
+	{
+		return{
+			factor,(T)0.0,(T)0.0,
+			(T)0.0,factor,(T)0.0,
+			(T)0.0,(T)0.0,factor,
+			(T)0.0,(T)0.0,(T)0.0,
+		};
+	}
+	static _Mat4x3 RotationZ( T theta )
+	{
+		const T sinTheta = sin( theta );
+		const T cosTheta = cos( theta );
+		return{
+			 cosTheta, sinTheta, (T)0.0,
+			-sinTheta, cosTheta, (T)0.0,
+			(T)0.0,    (T)0.0,   (T)1.0,
+			(T)0.0,    (T)0.0,   (T)0.0,
+		};
+	}
+	static _Mat4x3 RotationY( T theta )
+	{
+		const T sinTheta = sin( theta );
+		const T cosTheta = cos( theta );
+		return{
+			cosTheta, (T)0.0,-sinTheta,
+			(T)0.0,   (T)1.0, (T)0.0,
+			sinTheta, (T)0.0, cosTheta,
+			(T)0.0,   (T)0.0, (T)0.0,
+		};
+	}
+	static _Mat4x3 RotationX( T theta )
+	{
+		const T sinTheta = sin( theta );
+		const T cosTheta = cos( theta );
+		return{
+			(T)1.0, (T)0.0,   (T)0.0,
+			(T)0.0, cosTheta, sinTheta,
+			(T)0.0,-sinTheta, cosTheta,
+			(T)0.0, (T)0.0,   (T)0.0,
+		};
+	}
+	template<class V>
+	constexpr static _Mat4x3 Translation( const V& tl )
+	{
+		return Translation( tl.x,tl.y,tl.z );
+	}
+	constexpr static _Mat4x3 Translation( T x,T y,T z )
+	{
+		return{
+			(T)1.0,(T)0.0,(T)0.0,
+			(T)0.0,(T)1.0,(T)0.0,
+			(T)0.0,(T)0.0,(T)1.0,
+			x,     y,     z,
+		};
+	}
+public:
+	// [ row ][ col ]
+	T elements[4][3];
+};
+
+// the implicit last column keeps w as it is, so points (w = 1) get translated
+// and directions (w = 0) don't, like with the 4x4 version
+template<typename T>
+_Vec4<T> operator*( const _Vec4<T>& lhs,const _Mat4x3<T>& rhs )
+{
+	return{
+		lhs.x * rhs.elements[0][0] + lhs.y * rhs.elements[1][0] + lhs.z * rhs.elements[2][0] + lhs.w * rhs.elements[3][0],
+		lhs.x * rhs.elements[0][1] + lhs.y * rhs.elements[1][1] + lhs.z * rhs.elements[2][1] + lhs.w * rhs.elements[3][1],
+		lhs.x * rhs.elements[0][2] + lhs.y * rhs.elements[1][2] + lhs.z * rhs.elements[2][2] + lhs.w * rhs.elements[3][2],
+		lhs.w
+	};
+}
+
+template<typename T>
+_Vec4<T>& operator*=( _Vec4<T>& lhs,const _Mat4x3<T>& rhs )
+{
+	return lhs = lhs * rhs;
+}
+
+// sse version of the per vertex product for float, like the ones in Mat.h (same
+// order of operations, bit identical results), rows are read 4 wide, the lane past
+// a row being the start of the next one (the matrix products are once per draw
+// and weren't any faster with sse, they stay the templates)
+#ifndef CHILI_SCALAR_MATH
+// the translation row with whatever in the last lane (without reading past the matrix)
+inline __m128 LoadTranslation( const _Mat4x3<float>& m )
+{
+	const __m128 v = _mm_loadu_ps( &m.elements[2][2] );
+	return _mm_shuffle_ps( v,v,_MM_SHUFFLE( 0,3,2,1 ) );
+}
+
+template<>
+inline _Vec4<float> operator*( const _Vec4<float>& lhs,const _Mat4x3<float>& rhs )
+{
+	__m128 sum = _mm_mul_ps( _mm_set1_ps( lhs.x ),_mm_loadu_ps( rhs.elements[0] ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.y ),_mm_loadu_ps( rhs.elements[1] ) ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.z ),_mm_loadu_ps( rhs.elements[2] ) ) );
+	sum = _mm_add_ps( sum,_mm_mul_ps( _mm_set1_ps( lhs.w ),LoadTranslation( rhs ) ) );
+	_Vec4<float> result;
+	_mm_storeu_ps( &result.x,sum );
+	result.w = lhs.w;
+	return result;
+}
+#endif
+
+typedef _Mat4x3<float> Mat4x3;
+typedef _Mat4x3<double> Mad4x3;
\ No newline at end of file
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "ChiliWin.h"
 #include "Graphics.h"
 #include "Triangle.h"
 #include "IndexedTriangleList.h"
@@ -206,7 +205,7 @@ private:
 	}
 	// vertex post-processing function
 	// perform perspective and viewport transformations
-	void PostProcessTriangleVertices( Triangle<GSOut>& triangle )
+	void PostProcessTriangleVertices( Triangle<GSOut> triangle )
 	{
 		// perspective divide and screen transform for all 3 vertices
 		pst.Transform( triangle.v0 );
@@ -0,0 +1,96 @@
+#pragma once
+#include "Surface.h"
+#include "Colors.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// debug views of the frame, instead of shading the pipelines count what happens
+// at every pixel and the frame shows the counts as a heatmap
+enum class DebugView
+{
+	None,
+	// fragments rasterized (hidden ones included), the overdraw
+	DepthTests,
+	// fragments that passed the depth test, every one of them runs the pixel
+	// shader (early z), so this is the shading cost too
+	DepthPasses
+};
+
+inline const char* GetDebugViewName( DebugView view )
+{
+	switch( view )
+	{
+	case DebugView::DepthTests:
+		return "depth tests";
+	case DebugView::DepthPasses:
+		return "depth passes";
+	default:
+		return "none";
+	}
+}
+
+// per pixel counters of one frame (saturating at 65535)
+class OverdrawCounters
+{
+public:
+	// zeroes the counters, allocated on first use so frames that never show a
+	// debug view don't pay for them
+	void Clear( unsigned int width_in,unsigned int height_in )
+	{
+		width = width_in;
+		const size_t size = size_t( width_in ) * height_in;
+		for( auto* pCounts : { &tests,&passes } )
+		{
+			pCounts->assign( size,0u );
+		}
+	}
+	void CountTest( int x,int y )
+	{
+		Increment( tests,x,y );
+	}
+	void CountPass( int x,int y )
+	{
+		Increment( passes,x,y );
+	}
+	// replaces the frame with the heatmap of the counters picked by view
+	void Resolve( Surface& frame,DebugView view ) const
+	{
+		const std::vector<uint16_t>& counts = view == DebugView::DepthTests ? tests : passes;
+		for( unsigned int y = 0u; y < frame.GetHeight(); y++ )
+		{
+			for( unsigned int x = 0u; x < frame.GetWidth(); x++ )
+			{
+				frame.PutPixel( x,y,HeatColor( counts[size_t( y ) * width + x] ) );
+			}
+		}
+	}
+	// black for 0, then blue, cyan, green, yellow, orange, red, magenta and
+	// white for 8 or more
+	static Color HeatColor( unsigned int count )
+	{
+		static constexpr Color ramp[] = {
+			{ 0u,0u,0u },
+			{ 0u,0u,192u },
+			{ 0u,160u,255u },
+			{ 0u,200u,0u },
+			{ 255u,255u,0u },
+			{ 255u,140u,0u },
+			{ 255u,0u,0u },
+			{ 255u,0u,255u },
+			{ 255u,255u,255u }
+		};
+		return ramp[std::min( count,unsigned( std::size( ramp ) - 1u ) )];
+	}
+private:
+	void Increment( std::vector<uint16_t>& counts,int x,int y )
+	{
+		uint16_t& count = counts[size_t( y ) * width + size_t( x )];
+		count += count != UINT16_MAX;
+	}
+private:
+	unsigned int width = 0u;
+	std::vector<uint16_t> tests;
+	std::vector<uint16_t> passes;
+};
\ No newline at end of file
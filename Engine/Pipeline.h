@@ -1,18 +1,24 @@
 #pragma once
 
-#include "ChiliWin.h"
 #include "Graphics.h"
 #include "Triangle.h"
 #include "IndexedTriangleList.h"
 #include "NDCScreenTransformer.h"
 #include "Mat.h"
+#include "Mat4x3.h"
 #include "ZBuffer.h"
+#include "JobSystem.h"
+#include "PipelineStats.h"
+#include "Trace.h"
 #include <algorithm>
+#include <chrono>
 #include <memory>
 
 // triangle drawing pipeline with programable
 // pixel shading stage
-template<class Effect>
+// Depth is the depth buffer, DepthBuffer<Format> with one of the formats in
+// DepthFormats.h (pipelines sharing a depth buffer have to agree on it)
+template<class Effect,class Depth = ZBuffer>
 class Pipeline
 {
 public:
@@ -23,118 +29,223 @@ public:
 public:
 	Pipeline( Graphics& gfx )
 		:
-		Pipeline( gfx,std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight ) )
+		Pipeline( gfx,std::make_shared<Depth>( gfx.ScreenWidth,gfx.ScreenHeight ) )
 	{}
-	Pipeline( Graphics& gfx,std::shared_ptr<ZBuffer> pZb_in )
+	Pipeline( Graphics& gfx,std::shared_ptr<Depth> pZb_in )
 		:
 		gfx( gfx ),
-		pZb( std::move( pZb_in ) )
+		pZb( std::move( pZb_in ) ),
+		tilesX( (pZb->GetWidth() + Depth::tileSize - 1) >> Depth::tileShift ),
+		tileTests( size_t( tilesX * ((pZb->GetHeight() + Depth::tileSize - 1) >> Depth::tileShift) ) )
 	{
 		assert( pZb->GetHeight() == gfx.ScreenHeight && pZb->GetWidth() == gfx.ScreenWidth );
 	}
 	void Draw( const IndexedTriangleList<Vertex>& triList )
 	{
-		ProcessVertices( triList.vertices,triList.indices );
+		CHILI_TRACE( "Pipeline::Draw","pipeline" );
+		pOverdraw = gfx.GetOverdrawCounters();
+		if constexpr( pipelineStatsEnabled )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			drawCounters = {};
+			drawCounters.draws = 1u;
+			drawCounters.vertices = triList.vertices.size();
+			drawCounters.triangles = triList.indices.size() / 3u;
+			ProcessVertices( triList.vertices,triList.indices );
+			drawCounters.time = std::chrono::steady_clock::now() - start;
+			frameStatistics += drawCounters.stages;
+			PipelineStats::Get().Add( typeid( Effect ),drawCounters );
+		}
+		else
+		{
+			ProcessVertices( triList.vertices,triList.indices );
+		}
+	}
+	// draws with the cached model space face normals of the mesh handed to the gs
+	// (BindFaceNormals, along with the world view of the vs they get moved with),
+	// only for meshes the vs moves rigidly and whose positions haven't been edited
+	// since the normals were cached (see IndexedTriangleList::GetFaceNormals)
+	// the gs lets go of the normals when the draw is done
+	void DrawWithFaceNormals( const IndexedTriangleList<Vertex>& triList )
+	{
+		effect.gs.BindFaceNormals( &triList.GetFaceNormals(),effect.vs.GetWorldView() );
+		try
+		{
+			Draw( triList );
+		}
+		catch( ... )
+		{
+			effect.gs.BindFaceNormals( nullptr,Mat4x3::Identity() );
+			throw;
+		}
+		effect.gs.BindFaceNormals( nullptr,Mat4x3::Identity() );
 	}
 	// needed to reset the z-buffer after each frame
 	void BeginFrame()
 	{
 		pZb->Clear();
+		frameStatistics = {};
+	}
+	// what the stages did in the last draw / since BeginFrame
+	// (all zero unless built with CHILI_PIPELINE_STATS, see PipelineStats.h)
+	const PipelineStatistics& GetDrawStatistics() const
+	{
+		return drawCounters.stages;
+	}
+	const PipelineStatistics& GetFrameStatistics() const
+	{
+		return frameStatistics;
 	}
 private:
 	// vertex processing function
 	// transforms vertices using vs and then passes vtx & idx lists to triangle assembler
 	void ProcessVertices( const std::vector<Vertex>& vertices,const std::vector<size_t>& indices )
 	{
-		// create vertex vector for vs output
-		std::vector<VSOut> verticesOut( vertices.size() );
+		// vs output goes to storage kept from the last draws (only grows)
+		vertexStream.resize( vertices.size() );
+		PipelineStatistics::Count( drawCounters.stages.verticesShaded,vertices.size() );
 
-		// transform vertices with vs
-		std::transform( vertices.begin(),vertices.end(),
-						verticesOut.begin(),
-						effect.vs );
+		// transform vertices with vs, chunks spread over the job system workers
+		JobSystem::Get().ParallelFor( vertices.size(),vertexChunkSize,[&]( size_t begin,size_t end )
+		{
+			CHILI_TRACE( "Pipeline::VertexShader","pipeline" );
+			std::transform( vertices.begin() + begin,vertices.begin() + end,
+							vertexStream.begin() + begin,
+							effect.vs );
+		} );
 
 		// assemble triangles from stream of indices and vertices
-		AssembleTriangles( verticesOut,indices );
+		AssembleTriangles( vertexStream,indices );
 	}
 	// triangle assembly function
-	// assembles indexed vertex stream into triangles and passes them to post process
-	// culls (does not send) back facing triangles
+	// assembles indexed vertex stream into triangles, runs the gs on them and
+	// passes the survivors to the clipper
+	// culls (does not send) back facing triangles and triangles outside the frustum
+	// chunks of triangles are assembled in parallel into one stream per chunk,
+	// the streams are then clipped / rasterized in order so the result is the same
+	// as with a single thread
 	void AssembleTriangles( const std::vector<VSOut>& vertices,const std::vector<size_t>& indices )
 	{
 		const auto eyepos = Vec4{ 0.0f,0.0f,0.0f,1.0f } * effect.vs.GetProj();
+		const size_t nTriangles = indices.size() / 3;
+		const size_t nChunks = (nTriangles + triangleChunkSize - 1) / triangleChunkSize;
+		if( triangleStreams.size() < nChunks )
+		{
+			triangleStreams.resize( nChunks );
+			chunkBackFaceCulled.resize( nChunks );
+		}
 		// assemble triangles in the stream and process
-		for( size_t i = 0,end = indices.size() / 3;
-			 i < end; i++ )
+		JobSystem::Get().ParallelFor( nTriangles,triangleChunkSize,[&]( size_t begin,size_t end )
 		{
-			// determine triangle vertices via indexing
-			const auto& v0 = vertices[indices[i * 3]];
-			const auto& v1 = vertices[indices[i * 3 + 1]];
-			const auto& v2 = vertices[indices[i * 3 + 2]];
-			// cull backfacing triangles with cross product (%) shenanigans
-			if( (v1.pos - v0.pos) % (v2.pos - v0.pos) * Vec3(v0.pos - eyepos) <= 0.0f )
+			CHILI_TRACE( "Pipeline::Assemble","pipeline" );
+			auto& stream = triangleStreams[begin / triangleChunkSize];
+			stream.clear();
+			size_t backFaceCulled = 0u;
+			for( size_t i = begin; i < end; i++ )
 			{
-				// process 3 vertices into a triangle
-				ProcessTriangle( v0,v1,v2,i );
+				// determine triangle vertices via indexing
+				const auto& v0 = vertices[indices[i * 3]];
+				const auto& v1 = vertices[indices[i * 3 + 1]];
+				const auto& v2 = vertices[indices[i * 3 + 2]];
+				// cull backfacing triangles with cross product (%) shenanigans
+				// (a reversed projection mirrors z, which flips the winding)
+				const float facing = (v1.pos - v0.pos) % (v2.pos - v0.pos) * Vec3(v0.pos - eyepos);
+				if( Depth::Format::reversed ? facing >= 0.0f : facing <= 0.0f )
+				{
+					// generate triangle from 3 vertices using gs
+					auto t = effect.gs( v0,v1,v2,i );
+					if( !IsOutsideFrustum( t ) )
+					{
+						stream.push_back( std::move( t ) );
+					}
+				}
+				else if constexpr( pipelineStatsEnabled )
+				{
+					backFaceCulled++;
+				}
+			}
+			chunkBackFaceCulled[begin / triangleChunkSize] = backFaceCulled;
+		} );
+		// send the triangles to the clipper in submission order
+		CHILI_TRACE( "Pipeline::ClipRaster","pipeline" );
+		PipelineStatistics& stats = drawCounters.stages;
+		PipelineStatistics::Count( stats.trianglesAssembled,nTriangles );
+		for( size_t c = 0; c < nChunks; c++ )
+		{
+			// whatever wasn't culled for facing away and didn't make it into the stream was outside the frustum
+			PipelineStatistics::Count( stats.backFaceCulled,chunkBackFaceCulled[c] );
+			PipelineStatistics::Count( stats.frustumCulled,std::min( nTriangles - c * triangleChunkSize,triangleChunkSize )
+				- chunkBackFaceCulled[c] - triangleStreams[c].size() );
+			for( auto& t : triangleStreams[c] )
+			{
+				ClipTriangle( t );
 			}
 		}
 	}
-	// triangle processing function
-	// passes 3 vertices to gs to generate triangle
-	// sends generated triangle to post-processing
-	void ProcessTriangle( const VSOut& v0,const VSOut& v1,const VSOut& v2,size_t triangle_index )
-	{
-		// generate triangle from 3 vertices using gs
-		// and send to clipper
-		ClipCullTriangle( effect.gs( v0,v1,v2,triangle_index ) );
-	}
-
-	void ClipCullTriangle( Triangle<GSOut>& t )
+	// trivial reject against the clip volume
+	static bool IsOutsideFrustum( const Triangle<GSOut>& t )
 	{
 		// cull tests
 		if( t.v0.pos.x > t.v0.pos.w &&
 			t.v1.pos.x > t.v1.pos.w &&
 			t.v2.pos.x > t.v2.pos.w )
 		{
-			return;
+			return true;
 		}
 		if( t.v0.pos.x < -t.v0.pos.w &&
 			t.v1.pos.x < -t.v1.pos.w &&
 			t.v2.pos.x < -t.v2.pos.w )
 		{
-			return;
+			return true;
 		}
 		if( t.v0.pos.y > t.v0.pos.w &&
 			t.v1.pos.y > t.v1.pos.w &&
 			t.v2.pos.y > t.v2.pos.w )
 		{
-			return;
+			return true;
 		}
 		if( t.v0.pos.y < -t.v0.pos.w &&
 			t.v1.pos.y < -t.v1.pos.w &&
 			t.v2.pos.y < -t.v2.pos.w )
 		{
-			return;
+			return true;
 		}
 		if( t.v0.pos.z > t.v0.pos.w &&
 			t.v1.pos.z > t.v1.pos.w &&
 			t.v2.pos.z > t.v2.pos.w )
 		{
-			return;
+			return true;
 		}
 		if( t.v0.pos.z < 0.0f &&
 			t.v1.pos.z < 0.0f &&
 			t.v2.pos.z < 0.0f )
 		{
-			return;
+			return true;
 		}
-
+		return false;
+	}
+	// signed distance to the near plane in clip space, negative in front of it
+	// (the near plane is z = 0, or z = w for reversed depth)
+	static float NearDistance( const GSOut& v )
+	{
+		if constexpr( Depth::Format::reversed )
+		{
+			return v.pos.w - v.pos.z;
+		}
+		else
+		{
+			return v.pos.z;
+		}
+	}
+	// clips triangles crossing the near plane
+	void ClipTriangle( Triangle<GSOut>& t )
+	{
 		// clipping routines
 		const auto Clip1 = [this]( GSOut& v0,GSOut& v1,GSOut& v2 )
 		{
 			// calculate alpha values for getting adjusted vertices
-			const float alphaA = (-v0.pos.z) / (v1.pos.z - v0.pos.z);
-			const float alphaB = (-v0.pos.z) / (v2.pos.z - v0.pos.z);
+			const float alphaA = NearDistance( v0 ) / (NearDistance( v0 ) - NearDistance( v1 ));
+			const float alphaB = NearDistance( v0 ) / (NearDistance( v0 ) - NearDistance( v2 ));
 			// interpolate to get v0a and v0b
 			const auto v0a = interpolate( v0,v1,alphaA );
 			const auto v0b = interpolate( v0,v2,alphaB );
@@ -145,8 +256,8 @@ private:
 		const auto Clip2 = [this]( GSOut& v0,GSOut& v1,GSOut& v2 )
 		{
 			// calculate alpha values for getting adjusted vertices
-			const float alpha0 = (-v0.pos.z) / (v2.pos.z - v0.pos.z);
-			const float alpha1 = (-v1.pos.z) / (v2.pos.z - v1.pos.z);
+			const float alpha0 = NearDistance( v0 ) / (NearDistance( v0 ) - NearDistance( v2 ));
+			const float alpha1 = NearDistance( v1 ) / (NearDistance( v1 ) - NearDistance( v2 ));
 			// interpolate to get v0a and v0b
 			v0 = interpolate( v0,v2,alpha0 );
 			v1 = interpolate( v1,v2,alpha1 );
@@ -155,34 +266,40 @@ private:
 		};
 
 		// near clipping tests
-		if( t.v0.pos.z < 0.0f )
+		if( NearDistance( t.v0 ) < 0.0f )
 		{
-			if( t.v1.pos.z < 0.0f )
+			if( NearDistance( t.v1 ) < 0.0f )
 			{
+				PipelineStatistics::Count( drawCounters.stages.nearClipped2 );
 				Clip2( t.v0,t.v1,t.v2 );
 			}
-			else if( t.v2.pos.z < 0.0f )
+			else if( NearDistance( t.v2 ) < 0.0f )
 			{
+				PipelineStatistics::Count( drawCounters.stages.nearClipped2 );
 				Clip2( t.v0,t.v2,t.v1 );
 			}
 			else
 			{
+				PipelineStatistics::Count( drawCounters.stages.nearClipped1 );
 				Clip1( t.v0,t.v1,t.v2 );
 			}
 		}
-		else if( t.v1.pos.z < 0.0f )
+		else if( NearDistance( t.v1 ) < 0.0f )
 		{
-			if( t.v2.pos.z < 0.0f )
+			if( NearDistance( t.v2 ) < 0.0f )
 			{
+				PipelineStatistics::Count( drawCounters.stages.nearClipped2 );
 				Clip2( t.v1,t.v2,t.v0 );
 			}
 			else
 			{
+				PipelineStatistics::Count( drawCounters.stages.nearClipped1 );
 				Clip1( t.v1,t.v0,t.v2 );
 			}
 		}
-		else if( t.v2.pos.z < 0.0f )
+		else if( NearDistance( t.v2 ) < 0.0f )
 		{
+			PipelineStatistics::Count( drawCounters.stages.nearClipped1 );
 			Clip1( t.v2,t.v0,t.v1 );
 		}
 		else // no near clipping necessary
@@ -192,7 +309,7 @@ private:
 	}
 	// vertex post-processing function
 	// perform perspective and viewport transformations
-	void PostProcessTriangleVertices( Triangle<GSOut>& triangle )
+	void PostProcessTriangleVertices( Triangle<GSOut> triangle )
 	{
 		// perspective divide and screen transform for all 3 vertices
 		pst.Transform( triangle.v0 );
@@ -210,6 +327,11 @@ private:
 	// sorts vertices, determines case, splits to flat tris, dispatches to flat tri funcs
 	void DrawTriangle( const Triangle<GSOut>& triangle )
 	{
+		PipelineStatistics::Count( drawCounters.stages.trianglesRasterized );
+
+		// settle the depth test of fully covered tiles up front
+		TestCoveredTiles( triangle );
+
 		// using pointers so we can swap (for sorting purposes)
 		const GSOut* pv0 = &triangle.v0;
 		const GSOut* pv1 = &triangle.v1;
@@ -254,6 +376,69 @@ private:
 			}
 		}
 	}
+	// big triangles get the depth test of the tiles they cover completely done
+	// per tile (see DepthBuffer::TestTile), the scanlines look up the outcome
+	void TestCoveredTiles( const Triangle<GSOut>& triangle )
+	{
+		useTileTests = false;
+		const Vec3 p0 = Vec3( triangle.v0.pos );
+		const Vec3 p1 = Vec3( triangle.v1.pos );
+		const Vec3 p2 = Vec3( triangle.v2.pos );
+		const float xMin = std::min( std::min( p0.x,p1.x ),p2.x );
+		const float xMax = std::max( std::max( p0.x,p1.x ),p2.x );
+		const float yMin = std::min( std::min( p0.y,p1.y ),p2.y );
+		const float yMax = std::max( std::max( p0.y,p1.y ),p2.y );
+		// can't cover a whole tile
+		if( xMax - xMin < float( Depth::tileSize ) || yMax - yMin < float( Depth::tileSize ) )
+		{
+			return;
+		}
+		const Vec3 e1 = p1 - p0;
+		const Vec3 e2 = p2 - p0;
+		const float area = e1.x * e2.y - e2.x * e1.y;
+		if( area == 0.0f )
+		{
+			return;
+		}
+		// depth plane, z is affine in screen space after the perspective divide
+		DepthPlane plane;
+		plane.b = (e1.z * e2.y - e2.z * e1.y) / area;
+		plane.c = (e2.z * e1.x - e1.z * e2.x) / area;
+		plane.a = p0.z + plane.b * (0.5f - p0.x) + plane.c * (0.5f - p0.y);
+		// pixel centers must be inside all edges by a margin, so the scanlines are
+		// sure to draw every pixel of a tile marked visible
+		const float sign = area > 0.0f ? 1.0f : -1.0f;
+		const auto Inside = [sign]( const Vec3& a,const Vec3& b,float x,float y )
+		{
+			const float dx = b.x - a.x;
+			const float dy = b.y - a.y;
+			return sign * (dx * (y - a.y) - dy * (x - a.x)) > 0.125f * (std::abs( dx ) + std::abs( dy ));
+		};
+		// the last row and column of the screen are never drawn (see DrawFlatTriangle)
+		const int txStart = std::max( int( xMin ) >> Depth::tileShift,0 );
+		const int txEnd = std::min( int( xMax ) >> Depth::tileShift,tilesX - 1 );
+		const int tyStart = std::max( int( yMin ) >> Depth::tileShift,0 );
+		const int tyEnd = std::min( int( yMax ) >> Depth::tileShift,int( tileTests.size() ) / tilesX - 1 );
+		for( int ty = tyStart; ty <= tyEnd; ty++ )
+		{
+			for( int tx = txStart; tx <= txEnd; tx++ )
+			{
+				const float left = float( tx << Depth::tileShift ) + 0.5f;
+				const float top = float( ty << Depth::tileShift ) + 0.5f;
+				const float right = left + float( Depth::tileSize - 1 );
+				const float bottom = top + float( Depth::tileSize - 1 );
+				bool covered = right < float( Graphics::ScreenWidth - 1 ) && bottom < float( Graphics::ScreenHeight - 1 );
+				for( int i = 0; i < 4 && covered; i++ )
+				{
+					const float x = i & 1 ? right : left;
+					const float y = i & 2 ? bottom : top;
+					covered = Inside( p0,p1,x,y ) && Inside( p1,p2,x,y ) && Inside( p2,p0,x,y );
+				}
+				tileTests[size_t( ty * tilesX + tx )] = covered ? pZb->TestTile( tx,ty,plane ) : Depth::TileTest::Partial;
+			}
+		}
+		useTileTests = true;
+	}
 	// does flat *TOP* tri-specific calculations and calls DrawFlatTriangle
 	void DrawFlatTopTriangle( const GSOut& it0,
 							  const GSOut& it1,
@@ -327,20 +512,47 @@ private:
 			// prestep scanline interpolant
 			iLine += diLine * (float( xStart ) + 0.5f - itEdge0.pos.x);
 
+			PipelineStatistics::Count( drawCounters.fragments,size_t( std::max( xEnd - xStart,0 ) ) );
+			PipelineStatistics::Count( drawCounters.stages.fragmentsTested,size_t( std::max( xEnd - xStart,0 ) ) );
+
+			// outcome of the depth test of whole tiles on this row (if any)
+			const auto* const pRowTests = useTileTests ? &tileTests[size_t( (y >> Depth::tileShift) * tilesX )] : nullptr;
+
 			for( int x = xStart; x < xEnd; x++,iLine += diLine )
 			{
+				const auto tileTest = pRowTests ? pRowTests[x >> Depth::tileShift] : Depth::TileTest::Partial;
+				if( pOverdraw )
+				{
+					pOverdraw->CountTest( x,y );
+				}
+				if( tileTest == Depth::TileTest::Hidden )
+				{
+					continue;
+				}
 				// do z rejection / update of z buffer
 				// skip shading step if z rejected (early z)
-				if( pZb->TestAndSet( x,y,iLine.pos.z ) )
+				if( tileTest == Depth::TileTest::Visible || pZb->TestAndSet( x,y,iLine.pos.z ) )
 				{
+					PipelineStatistics::Count( drawCounters.stages.fragmentsPassed );
+					// debug views count the shading instead of doing it
+					if( pOverdraw )
+					{
+						pOverdraw->CountPass( x,y );
+						continue;
+					}
 					// recover interpolated z from interpolated 1/z
 					const float w = 1.0f / iLine.pos.w;
 					// recover interpolated attributes
 					// (wasted effort in multiplying pos (x,y,z) here, but
 					//  not a huge deal, not worth the code complication to fix)
-					const auto attr = iLine * w;
+					auto attr = iLine * w;
+					// pos x,y hold the screen position of the pixel (for shaders
+					// that look up per tile data, like a tiled light list)
+					attr.pos.x = float( x );
+					attr.pos.y = float( y );
 					// invoke pixel shader with interpolated vertex attributes
 					// and use result to set the pixel color on the screen
+					PipelineStatistics::Count( drawCounters.stages.psInvocations );
 					gfx.PutPixel( x,y,effect.ps( attr ) );
 				}
 			}
@@ -349,7 +561,25 @@ private:
 public:
 	Effect effect;
 private:
+	// chunk sizes for the parallel stages (a chunk of vs output stays well inside L1)
+	static constexpr size_t vertexChunkSize = 16384 / sizeof( VSOut );
+	static constexpr size_t triangleChunkSize = 1024;
 	Graphics& gfx;
 	NDCScreenTransformer pst;
-	std::shared_ptr<ZBuffer> pZb;
+	std::shared_ptr<Depth> pZb;
+	// depth test outcome of the tiles covered by the triangle being drawn
+	int tilesX;
+	std::vector<typename Depth::TileTest> tileTests;
+	bool useTileTests = false;
+	// per pixel counters of the frame when it is drawn for a debug view (see Graphics::SetDebugView)
+	OverdrawCounters* pOverdraw = nullptr;
+	// vs output of the draw (kept around so the storage is reused)
+	std::vector<VSOut> vertexStream;
+	// assembled triangles of each chunk (kept around so the storage is reused)
+	std::vector<std::vector<Triangle<GSOut>>> triangleStreams;
+	// backface culled triangles of each chunk (pipeline statistics only)
+	std::vector<size_t> chunkBackFaceCulled;
+	// work of the draw in progress (see PipelineStats)
+	DrawCounters drawCounters;
+	PipelineStatistics frameStatistics;
 };
\ No newline at end of file
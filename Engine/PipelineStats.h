@@ -0,0 +1,156 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+// define CHILI_PIPELINE_STATS to have the pipelines count what every draw and
+// every stage does (DrawCounters, PipelineStatistics) and report the draws to
+// PipelineStats, without it all of that compiles out and the counters stay 0
+#ifdef CHILI_PIPELINE_STATS
+constexpr bool pipelineStatsEnabled = true;
+#else
+constexpr bool pipelineStatsEnabled = false;
+#endif
+
+// gpu style pipeline statistics, the triangles assembled are either culled
+// (back face or frustum) or go on to the clipper, which hands the rasterizer
+// one triangle per unclipped one, two per clip1 case (one vertex behind the
+// near plane) and one per clip2 case (two behind it)
+struct PipelineStatistics
+{
+	// adds n to counter if the statistics are enabled
+	static void Count( unsigned long long& counter,size_t n = 1u )
+	{
+		if constexpr( pipelineStatsEnabled )
+		{
+			counter += n;
+		}
+	}
+	PipelineStatistics& operator+=( const PipelineStatistics& rhs )
+	{
+		verticesShaded += rhs.verticesShaded;
+		trianglesAssembled += rhs.trianglesAssembled;
+		backFaceCulled += rhs.backFaceCulled;
+		frustumCulled += rhs.frustumCulled;
+		nearClipped1 += rhs.nearClipped1;
+		nearClipped2 += rhs.nearClipped2;
+		trianglesRasterized += rhs.trianglesRasterized;
+		fragmentsTested += rhs.fragmentsTested;
+		fragmentsPassed += rhs.fragmentsPassed;
+		psInvocations += rhs.psInvocations;
+		return *this;
+	}
+	unsigned long long verticesShaded = 0u;
+	unsigned long long trianglesAssembled = 0u;
+	unsigned long long backFaceCulled = 0u;
+	unsigned long long frustumCulled = 0u;
+	unsigned long long nearClipped1 = 0u;
+	unsigned long long nearClipped2 = 0u;
+	unsigned long long trianglesRasterized = 0u;
+	// pixels put through the depth test (per pixel or settled per tile)
+	unsigned long long fragmentsTested = 0u;
+	unsigned long long fragmentsPassed = 0u;
+	unsigned long long psInvocations = 0u;
+};
+
+// work done by Pipeline::Draw calls (all zero unless CHILI_PIPELINE_STATS is defined)
+struct DrawCounters
+{
+	DrawCounters& operator+=( const DrawCounters& rhs )
+	{
+		draws += rhs.draws;
+		vertices += rhs.vertices;
+		triangles += rhs.triangles;
+		fragments += rhs.fragments;
+		time += rhs.time;
+		stages += rhs.stages;
+		return *this;
+	}
+	unsigned long long draws = 0u;
+	// vertices shaded
+	unsigned long long vertices = 0u;
+	// triangles submitted (before culling and clipping)
+	unsigned long long triangles = 0u;
+	// pixels covered by the rasterized triangles (before the depth test)
+	unsigned long long fragments = 0u;
+	// wall clock time spent in Draw
+	std::chrono::steady_clock::duration time = std::chrono::steady_clock::duration::zero();
+	PipelineStatistics stages;
+};
+
+// the counters of every Pipeline::Draw summed up per effect, for benchmarks
+// (one short lock per draw, only with CHILI_PIPELINE_STATS, empty otherwise)
+class PipelineStats
+{
+public:
+	struct Entry
+	{
+		std::string effect;
+		DrawCounters counters;
+	};
+public:
+	static PipelineStats& Get()
+	{
+		static PipelineStats stats;
+		return stats;
+	}
+	void Add( const std::type_info& effect,const DrawCounters& counters )
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		perEffect[std::type_index( effect )] += counters;
+	}
+	// counters per effect since the last reset, sorted by effect name
+	std::vector<Entry> Collect() const
+	{
+		std::vector<Entry> entries;
+		{
+			std::lock_guard<std::mutex> lock( mtx );
+			for( const auto& e : perEffect )
+			{
+				entries.push_back( { GetName( e.first ),e.second } );
+			}
+		}
+		std::sort( entries.begin(),entries.end(),[]( const Entry& a,const Entry& b )
+		{
+			return a.effect < b.effect;
+		} );
+		return entries;
+	}
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock( mtx );
+		perEffect.clear();
+	}
+private:
+	// readable type name (gcc and clang hand out mangled ones)
+	static std::string GetName( std::type_index type )
+	{
+	#ifdef __GNUC__
+		int status = 0;
+		char* const pName = abi::__cxa_demangle( type.name(),nullptr,nullptr,&status );
+		if( pName )
+		{
+			const std::string name( pName );
+			std::free( pName );
+			return name;
+		}
+		return type.name();
+	#else
+		// msvc prefixes "class "
+		const std::string name = type.name();
+		return name.compare( 0,6,"class " ) == 0 ? name.substr( 6 ) : name;
+	#endif
+	}
+private:
+	mutable std::mutex mtx;
+	std::map<std::type_index,DrawCounters> perEffect;
+};
\ No newline at end of file
@@ -4,9 +4,10 @@
 #include "BaseVertexShader.h"
 #include "DefaultGeometryShader.h"
 #include "BasePhongShader.h"
+#include "TextureSampler.h"
 
 // flat shading with vertex normals
-template<class Diffuse,class Specular>
+template<class Diffuse,class Specular,class Sampler = PointSampler<WrapAddressing>>
 class RippleVertexSpecularPhongEffect
 {
 public:
@@ -118,7 +119,7 @@ public:
 		{
 			t = time;
 		}
-		typename BaseVertexShader::Output operator()( const Vertex& v ) const
+		typename BaseVertexShader<VSOutput>::Output operator()( const Vertex& v ) const
 		{
 			// calculate some triggy bois
 			const auto angle = wrap_angle( v.pos.x * freq + t * wavelength );
@@ -136,7 +137,7 @@ public:
 			};
 			n.Normalize();
 
-			return { pos * worldViewProj,n * worldView,pos * worldView,v.t };
+			return { pos * this->worldViewProj,n * this->worldView,pos * this->worldView,v.t };
 		}
 	private:
 		static constexpr float wavelength = PI;
@@ -156,22 +157,17 @@ public:
 		template<class Input>
 		Color operator()( const Input& in ) const
 		{
-			const auto material_color = Vec3( pTex->GetPixel(
-				unsigned int( in.t.x * tex_width + 0.5f ) % tex_width,
-				unsigned int( in.t.y * tex_height + 0.5f ) % tex_width
-			) ) / 255.0f;
-			return Shade( in,material_color );
+			const auto material_color = Vec3( sampler( in.t ) ) / 255.0f;
+			return this->Shade( in,material_color );
 		}
-		void BindTexture( const Surface& tex )
+		// tex is a Surface or a CompressedSurface, whichever the sampler reads
+		template<class Texture>
+		void BindTexture( const Texture& tex )
 		{
-			pTex = &tex;
-			tex_width = pTex->GetWidth();
-			tex_height = pTex->GetHeight();
+			sampler.Bind( tex );
 		}
 	private:
-		const Surface* pTex = nullptr;
-		unsigned int tex_width;
-		unsigned int tex_height;
+		Sampler sampler;
 	};
 public:
 	VertexShader vs;
@@ -2,6 +2,7 @@
 #include "Keyboard.h"
 #include "Mouse.h"
 #include "Graphics.h"
+#include "ChiliMath.h"
 #include <string>
 
 class Scene
@@ -11,13 +12,33 @@ public:
 		:
 		name( name )
 	{}
+	// one simulation step (a fixed dt in the game loop)
 	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) = 0;
+	// called after the updates of a frame, alpha goes from the state of the update
+	// before the last (0) to the last one (1), the frame draws what lies in between
+	// (scenes that don't keep their previous state just draw the last one)
+	virtual void Interpolate( float alpha )
+	{}
+	// true when Draw only reads what Interpolate set and never what Update writes,
+	// then the game loop runs the next updates while the frame is drawn
+	virtual bool CanUpdateWhileDrawing() const
+	{
+		return false;
+	}
 	virtual void Draw() = 0;
 	virtual ~Scene() = default;
 	const std::string& GetName() const
 	{
 		return name;
 	}
+protected:
+	// interpolate that gives back cur exactly at alpha 1 (the runs with one
+	// update per frame draw the same as before there was any interpolation)
+	template<typename T>
+	static T Blend( const T& prev,const T& cur,float alpha )
+	{
+		return alpha >= 1.0f ? cur : interpolate( prev,cur,alpha );
+	}
 private:
 	std::string name;
 };
\ No newline at end of file
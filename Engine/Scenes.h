@@ -0,0 +1,30 @@
+#pragma once
+#include "Scene.h"
+#include "Graphics.h"
+//#include "CubeSkinScene.h"
+//#include "CubeVertexColorScene.h"
+//#include "CubeSolidScene.h"
+//#include "DoubleCubeScene.h"
+//#include "VertexWaveScene.h"
+//#include "CubeVertexPositionColorScene.h"
+//#include "CubeSolidGeometryScene.h"
+//#include "CubeFlatIndependentScene.h"
+#include "GeometryFlatScene.h"
+//#include "GouraudScene.h"
+//#include "GouraudPointScene.h"
+//#include "PhongPointScene.h"
+#include "SpecularPhongPointScene.h"
+#include "ManyLightsScene.h"
+#include <memory>
+#include <vector>
+
+// the scenes of the application, in the order tab cycles through them
+// (shared with the headless runner, the benchmarks and the tests)
+inline std::vector<std::unique_ptr<Scene>> MakeScenes( Graphics& gfx )
+{
+	std::vector<std::unique_ptr<Scene>> scenes;
+	scenes.push_back( std::make_unique<SpecularPhongPointScene>( gfx ) );
+	scenes.push_back( std::make_unique<ManyLightsScene>( gfx ) );
+	scenes.push_back( std::make_unique<GeometryFlatScene>( gfx,L"models\\bunny.obj" ) );
+	return scenes;
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <xmmintrin.h>
+
+// math precision policies for shaders
+// each provides RSqrt (1/sqrt(x)), Rcp (1/x) and Pow (x^y for x >= 0)
+//
+// worst case relative errors (Pow measured over x in (0,1], integer y in [1,64]):
+//            RSqrt     Rcp       Pow
+//   Precise  crt       crt       crt
+//   Fast     2.6e-7    2.0e-7    7.4e-4 (3.5e-4 at y = 30)
+//   Fastest  3.7e-4    3.7e-4    3.7e-2 (1.7e-2 at y = 30)
+// (Fastest RSqrt / Rcp are the bare sse estimates, 3.7e-4 is their documented bound)
+// lit colors end up as 8-bit channels, so Fast is indistinguishable from Precise
+
+struct PreciseMath
+{
+	static float RSqrt( float x )
+	{
+		return 1.0f / std::sqrt( x );
+	}
+	static float Rcp( float x )
+	{
+		return 1.0f / x;
+	}
+	static float Pow( float x,float y )
+	{
+		return std::pow( x,y );
+	}
+};
+
+namespace shader_math_detail
+{
+	// x = m * 2^e with m in [1,2), returns e and sets m
+	inline int SplitExponent( float x,float& m )
+	{
+		unsigned int bits;
+		memcpy( &bits,&x,sizeof( bits ) );
+		const int e = int( (bits >> 23u) & 0xFFu ) - 127;
+		bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+		memcpy( &m,&bits,sizeof( m ) );
+		return e;
+	}
+	// 2^i for integer i in the normal range
+	inline float MakeExponent( int i )
+	{
+		const unsigned int bits = (unsigned int)(i + 127) << 23u;
+		float f;
+		memcpy( &f,&bits,sizeof( f ) );
+		return f;
+	}
+	// floor for the exponent range (avoids a crt call without sse4.1)
+	inline int FloorExponent( float x )
+	{
+		const int i = int( x );
+		return i - int( x < float( i ) );
+	}
+	inline float RSqrtEstimate( float x )
+	{
+		return _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( x ) ) );
+	}
+	inline float RcpEstimate( float x )
+	{
+		return _mm_cvtss_f32( _mm_rcp_ss( _mm_set_ss( x ) ) );
+	}
+	// log2 / exp2 from the exponent bits plus a chebyshev fitted polynomial of
+	// the given degree for the mantissa / fraction (coefficients fit on [1,2) / [0,1))
+	template<int Degree>
+	float Log2( float x );
+	template<int Degree>
+	float Exp2( float x );
+
+	template<>
+	inline float Log2<3>( float x )
+	{
+		float m;
+		const int e = SplitExponent( x,m );
+		const float t = m - 1.0f;
+		return float( e ) + (0.000825462823f + t * (1.41565319f + t * (-0.568704053f + t * 0.152700285f)));
+	}
+	template<>
+	inline float Log2<5>( float x )
+	{
+		float m;
+		const int e = SplitExponent( x,m );
+		const float t = m - 1.0f;
+		return float( e ) + (1.65146709e-05f + t * (1.44149241f + t * (-0.706486449f + t * (0.409470299f +
+			t * (-0.187488605f + t * 0.0430049578f)))));
+	}
+	template<>
+	inline float Exp2<3>( float x )
+	{
+		// results below the smallest normal float flush to zero
+		if( x < -126.0f )
+		{
+			return 0.0f;
+		}
+		const int i = FloorExponent( x );
+		const float f = x - float( i );
+		return MakeExponent( i ) * (0.999900288f + f * (0.696324771f + f * (0.224693156f + f * 0.078967257f)));
+	}
+	template<>
+	inline float Exp2<4>( float x )
+	{
+		if( x < -126.0f )
+		{
+			return 0.0f;
+		}
+		const int i = FloorExponent( x );
+		const float f = x - float( i );
+		return MakeExponent( i ) * (1.00000349f + f * (0.692972922f + f * (0.241604357f +
+			f * (0.0517449978f + f * 0.0136703095f))));
+	}
+}
+
+// sse estimates refined with one newton-raphson step, polynomial pow
+struct FastMath
+{
+	static float RSqrt( float x )
+	{
+		const float e = shader_math_detail::RSqrtEstimate( x );
+		return e * (1.5f - 0.5f * x * e * e);
+	}
+	static float Rcp( float x )
+	{
+		const float e = shader_math_detail::RcpEstimate( x );
+		return e * (2.0f - x * e);
+	}
+	static float Pow( float x,float y )
+	{
+		if( x <= 0.0f )
+		{
+			return 0.0f;
+		}
+		return shader_math_detail::Exp2<4>( y * shader_math_detail::Log2<5>( x ) );
+	}
+};
+
+// raw sse estimates, low order polynomial pow
+struct FastestMath
+{
+	static float RSqrt( float x )
+	{
+		return shader_math_detail::RSqrtEstimate( x );
+	}
+	static float Rcp( float x )
+	{
+		return shader_math_detail::RcpEstimate( x );
+	}
+	static float Pow( float x,float y )
+	{
+		if( x <= 0.0f )
+		{
+			return 0.0f;
+		}
+		return shader_math_detail::Exp2<3>( y * shader_math_detail::Log2<3>( x ) );
+	}
+};
+
+// x^N by repeated squaring, unrolled at compile time
+template<int N>
+inline float IntPow( float x )
+{
+	static_assert( N >= 0,"IntPow needs a non-negative exponent" );
+	if constexpr( N == 0 )
+	{
+		return 1.0f;
+	}
+	else if constexpr( N == 1 )
+	{
+		return x;
+	}
+	else if constexpr( N % 2 == 0 )
+	{
+		const float h = IntPow<N / 2>( x );
+		return h * h;
+	}
+	else
+	{
+		return x * IntPow<N - 1>( x );
+	}
+}
+
+// x^P for an exponent known at compile time
+// whole exponents up to 64 become a chain of multiplies (1.2e-6 relative error
+// at 30, from rounding alone),
+// anything else goes through the pow of the math policy
+template<class Math,class Exponent>
+inline float ConstPow( float x )
+{
+	constexpr float p = Exponent::value;
+	constexpr int n = int( p );
+	if constexpr( n >= 0 && n <= 64 && float( n ) == p )
+	{
+		return IntPow<n>( x );
+	}
+	else
+	{
+		return Math::Pow( x,p );
+	}
+}
+
+// params structs select the precision of the term they control with a
+// typedef named Math (e.g. typedef FastestMath Math;), FastMath if they don't
+template<class Params,class = void>
+struct ShaderMathOf
+{
+	typedef FastMath Type;
+};
+
+template<class Params>
+struct ShaderMathOf<Params,std::void_t<typename Params::Math>>
+{
+	typedef typename Params::Math Type;
+};
\ No newline at end of file
@@ -12,6 +12,8 @@
 #include "RippleVertexSpecularPhongEffect.h"
 #include "Plane.h"
 #include "NormiePipe.h"
+#include "Codex.h"
+#include "TransformHierarchy.h"
 
 struct PointDiffuseParams
 {
@@ -28,15 +30,15 @@ struct SpecularParams
 
 class SpecularPhongPointScene : public Scene
 {
-	using SpecularPhongPointEffect = SpecularPhongPointEffect<PointDiffuseParams,SpecularParams>;
-	using VertexLightTexturedEffect = VertexLightTexturedEffect<PointDiffuseParams>;
-	using RippleVertexSpecularPhongEffect = RippleVertexSpecularPhongEffect<PointDiffuseParams,SpecularParams>;
+	using SpecularPhongPointEffect = ::SpecularPhongPointEffect<PointDiffuseParams,SpecularParams>;
+	using VertexLightTexturedEffect = ::VertexLightTexturedEffect<PointDiffuseParams,BilinearSampler<WrapAddressing,BlockTexels>>;
+	using RippleVertexSpecularPhongEffect = ::RippleVertexSpecularPhongEffect<PointDiffuseParams,SpecularParams,PointSampler<WrapAddressing,BlockTexels>>;
 public:
 	struct Wall
 	{
-		const Surface* pTex;
+		const CompressedSurface* pTex;
 		IndexedTriangleList<VertexLightTexturedEffect::Vertex> model;
-		Mat4 world;
+		TransformHierarchy::Node node;
 	};
 public:
 	typedef ::Pipeline<SpecularPhongPointEffect> Pipeline;
@@ -54,35 +56,41 @@ public:
 		rPipeline( gfx,pZb ),
 		Scene( "phong point shader scene free mesh" )
 	{
-		// adjust suzanne model
-		itlist.AdjustToTrueCenter();
 		// set light sphere colors
 		for( auto& v : lightIndicator.vertices )
 		{
 			v.color = Colors::White;
 		}
+		// everything hangs off the camera, so the cached worlds are world view matrices
+		// and the static walls only get recomputed when the camera moves
+		viewNode = transforms.AddNode( GetView( cam_pos ) );
+		suzanneNode = transforms.AddNode( GetSuzanneLocal(),viewNode );
+		lightNode = transforms.AddNode( Mat4x3::Translation( l_pos ),viewNode );
+		sauronNode = transforms.AddNode( Mat4x3::RotationX( PI / 2.0f ) * Mat4x3::Translation( 0.3f,-0.8,0.0f ),viewNode );
 		// load ceiling/walls/floor
 		walls.push_back( {
-			&tCeiling,
+			pCeiling.get(),
 			Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,width,tScaleCeiling ),
-			Mat4::RotationX( -PI / 2.0f ) * Mat4::Translation( 0.0f,height / 2.0f,0.0f )
+			transforms.AddNode( Mat4x3::RotationX( -PI / 2.0f ) * Mat4x3::Translation( 0.0f,height / 2.0f,0.0f ),viewNode )
 		} );
 		for( int i = 0; i < 4; i++ )
 		{
 			walls.push_back( {
-				&tWall,
+				pWall.get(),
 				Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,height,tScaleWall ),
-				Mat4::Translation( 0.0f,0.0f,width / 2.0f ) * Mat4::RotationY( float( i ) * PI / 2.0f )
+				transforms.AddNode( Mat4x3::Translation( 0.0f,0.0f,width / 2.0f ) * Mat4x3::RotationY( float( i ) * PI / 2.0f ),viewNode )
 			} );
 		}
 		walls.push_back( {
-			&tFloor,
+			pFloor.get(),
 			Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,width,tScaleFloor ),
-			Mat4::RotationX( PI / 2.0 ) * Mat4::Translation( 0.0f,-height / 2.0f,0.0f )
+			transforms.AddNode( Mat4x3::RotationX( PI / 2.0 ) * Mat4x3::Translation( 0.0f,-height / 2.0f,0.0f ),viewNode )
 		} );
 	}
 	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) override
 	{
+		prev_t = t;
+		prev_cam_pos = cam_pos;
 		t += dt;
 
 		if( kbd.KeyIsPressed( 'W' ) )
@@ -111,11 +119,13 @@ public:
 		}
 		if( kbd.KeyIsPressed( 'Q' ) )
 		{
-			cam_rot_inv = cam_rot_inv * Mat4::RotationZ( cam_roll_speed * dt );
+			cam_rot_inv = cam_rot_inv * Mat4x3::RotationZ( cam_roll_speed * dt );
+			cam_rotated = true;
 		}
 		if( kbd.KeyIsPressed( 'E' ) )
 		{
-			cam_rot_inv = cam_rot_inv * Mat4::RotationZ( -cam_roll_speed * dt );
+			cam_rot_inv = cam_rot_inv * Mat4x3::RotationZ( -cam_roll_speed * dt );
+			cam_rotated = true;
 		}
 
 		while( !mouse.IsEmpty() )
@@ -134,44 +144,60 @@ public:
 				{
 					const auto delta = mt.Move( e.GetPos() );
 					cam_rot_inv = cam_rot_inv
-						* Mat4::RotationY( (float)-delta.x * htrack )
-						* Mat4::RotationX( (float)-delta.y * vtrack );
+						* Mat4x3::RotationY( (float)-delta.x * htrack )
+						* Mat4x3::RotationX( (float)-delta.y * vtrack );
+					cam_rotated = true;
 				}
 				break;
 			}
 		}
 
-		theta_y = wrap_angle( t * rotspeed );
-		l_pos.y = l_height_amplitude * sin( wrap_angle( (PI / (2.0f * l_height_amplitude)) * t ) );
+	}
+	// the animation only depends on t, the camera position is blended and the
+	// rotation (mouse look, applied per input event) taken from the last update
+	virtual void Interpolate( float alpha ) override
+	{
+		const float draw_t = Blend( prev_t,t,alpha );
+		theta_y = wrap_angle( draw_t * rotspeed );
+		l_pos.y = l_height_amplitude * sin( wrap_angle( (PI / (2.0f * l_height_amplitude)) * draw_t ) );
 
-		rPipeline.effect.vs.SetTime( t );
+		rPipeline.effect.vs.SetTime( draw_t );
+
+		// only what moved gets marked dirty
+		const Vec3 draw_cam_pos = Blend( prev_cam_pos,cam_pos,alpha );
+		if( cam_rotated || draw_cam_pos != view_cam_pos )
+		{
+			transforms.SetLocal( viewNode,GetView( draw_cam_pos ) );
+			view_cam_pos = draw_cam_pos;
+			cam_rotated = false;
+		}
+		transforms.SetLocal( suzanneNode,GetSuzanneLocal() );
+		transforms.SetLocal( lightNode,Mat4x3::Translation( l_pos ) );
+	}
+	virtual bool CanUpdateWhileDrawing() const override
+	{
+		return true;
 	}
 	virtual void Draw() override
 	{
 		pipeline.BeginFrame();
 
 		const auto proj = Mat4::ProjectionHFOV( hfov,aspect_ratio,0.2f,6.0f );
-		const auto view = Mat4::Translation( -cam_pos ) * cam_rot_inv;
+		transforms.Update();
+		const auto& view = transforms.GetWorld( viewNode );
 
 		// render suzanne
-		pipeline.effect.vs.BindWorldView(
-			Mat4::RotationX( theta_x ) *
-			Mat4::RotationY( theta_y ) *
-			Mat4::RotationZ( theta_z ) *
-			Mat4::Scaling( scale ) *
-			Mat4::Translation( mod_pos ) *
-			view
-		);
+		pipeline.effect.vs.BindWorldView( transforms.GetWorld( suzanneNode ) );
 		pipeline.effect.vs.BindProjection( proj );
 		pipeline.effect.ps.SetLightPosition( l_pos * view );
 		pipeline.effect.ps.SetAmbientLight( l_ambient );
 		pipeline.effect.ps.SetDiffuseLight( l );
-		pipeline.Draw( itlist );
+		pipeline.Draw( *pSuzanne );
 
 		// draw light indicator with different pipeline
 		// don't call beginframe on this pipeline b/c wanna keep zbuffer contents
 		// (don't like this assymetry but we'll live with it for now)
-		liPipeline.effect.vs.BindWorldView( Mat4::Translation( l_pos ) * view );
+		liPipeline.effect.vs.BindWorldView( transforms.GetWorld( lightNode ) );
 		liPipeline.effect.vs.BindProjection( proj );
 		liPipeline.Draw( lightIndicator );
 
@@ -182,22 +208,37 @@ public:
 		wPipeline.effect.vs.SetDiffuseLight( l );
 		for( const auto& w : walls )
 		{
-			wPipeline.effect.vs.BindWorldView( w.world * view );
+			wPipeline.effect.vs.BindWorldView( transforms.GetWorld( w.node ) );
 			wPipeline.effect.ps.BindTexture( *w.pTex );
 			wPipeline.Draw( w.model );
 		}
 
 		// draw ripple plane
-		rPipeline.effect.ps.BindTexture( tSauron );
+		rPipeline.effect.ps.BindTexture( *pSauron );
 		rPipeline.effect.ps.SetLightPosition( l_pos * view );
-		rPipeline.effect.vs.BindWorldView( sauronWorld * view );
+		rPipeline.effect.vs.BindWorldView( transforms.GetWorld( sauronNode ) );
 		rPipeline.effect.vs.BindProjection( proj );
 		rPipeline.effect.ps.SetAmbientLight( l_ambient );
 		rPipeline.effect.ps.SetDiffuseLight( l );
 		rPipeline.Draw( sauron );
 	}
 private:
+	Mat4x3 GetView( const Vec3& pos ) const
+	{
+		return Mat4x3::Translation( -pos ) * cam_rot_inv;
+	}
+	Mat4x3 GetSuzanneLocal() const
+	{
+		return Mat4x3::RotationX( theta_x ) *
+			Mat4x3::RotationY( theta_y ) *
+			Mat4x3::RotationZ( theta_z ) *
+			Mat4x3::Scaling( scale ) *
+			Mat4x3::Translation( mod_pos );
+	}
+private:
+	// simulation state (Update), t and the camera position of the update before too
 	float t = 0.0f;
+	float prev_t = 0.0f;
 	// scene params
 	static constexpr float width = 4.0f;
 	static constexpr float height = 1.75f;
@@ -218,9 +259,13 @@ private:
 	static constexpr float cam_speed = 1.0f;
 	static constexpr float cam_roll_speed = PI;
 	Vec3 cam_pos = { 0.0f,0.0f,0.0f };
-	Mat4 cam_rot_inv = Mat4::Identity();
-	// suzanne model stuff
-	IndexedTriangleList<Vertex> itlist = IndexedTriangleList<SpecularPhongPointScene::Vertex>::LoadNormals( "models\\suzanne.obj" );
+	Mat4x3 cam_rot_inv = Mat4x3::Identity();
+	Vec3 prev_cam_pos = { 0.0f,0.0f,0.0f };
+	// camera of the view node (Interpolate)
+	Vec3 view_cam_pos = { 0.0f,0.0f,0.0f };
+	bool cam_rotated = false;
+	// suzanne model stuff (recentered when the codex loads it)
+	std::shared_ptr<const IndexedTriangleList<Vertex>> pSuzanne = Codex<IndexedTriangleList<Vertex>,CenteredMeshLoader<NormalsMeshLoader<Vertex>>>::Retrieve( L"models\\suzanne.obj" );
 	Vec3 mod_pos = { 1.2f,-0.4f,1.2f };
 	float theta_x = 0.0f;
 	float theta_y = 0.0f;
@@ -238,13 +283,18 @@ private:
 	static constexpr float tScaleCeiling = 0.5f;
 	static constexpr float tScaleWall = 0.65f;
 	static constexpr float tScaleFloor = 0.65f;
-	Surface tCeiling = Surface::FromFile( L"Images\\ceiling.png" );
-	Surface tWall = Surface::FromFile( L"Images\\stonewall.png" );
-	Surface tFloor = Surface::FromFile( L"Images\\floor.png" );
+	std::shared_ptr<const CompressedSurface> pCeiling = Codex<CompressedSurface>::Retrieve( L"Images\\ceiling.png" );
+	std::shared_ptr<const CompressedSurface> pWall = Codex<CompressedSurface>::Retrieve( L"Images\\stonewall.png" );
+	std::shared_ptr<const CompressedSurface> pFloor = Codex<CompressedSurface>::Retrieve( L"Images\\floor.png" );
 	std::vector<Wall> walls;
+	// transforms
+	TransformHierarchy transforms;
+	TransformHierarchy::Node viewNode;
+	TransformHierarchy::Node suzanneNode;
+	TransformHierarchy::Node lightNode;
+	TransformHierarchy::Node sauronNode;
 	// ripple stuff
 	static constexpr float sauronSize = 0.6f;
-	Mat4 sauronWorld = Mat4::RotationX( PI / 2.0f ) * Mat4::Translation( 0.3f,-0.8,0.0f );
-	Surface tSauron = Surface::FromFile( L"Images\\sauron-bhole-100x100.png" );
+	std::shared_ptr<const CompressedSurface> pSauron = Codex<CompressedSurface>::Retrieve( L"Images\\sauron-bhole-100x100.png" );
 	IndexedTriangleList<RippleVertexSpecularPhongEffect::Vertex> sauron = Plane::GetSkinned<RippleVertexSpecularPhongEffect::Vertex>( 50,10,sauronSize,sauronSize,0.6f );
-};
+};
\ No newline at end of file
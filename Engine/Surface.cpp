@@ -18,19 +18,29 @@
 *	You should have received a copy of the GNU General Public License					  *
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
-#define FULL_WINTARD
-#include "ChiliWin.h"
 #include "Surface.h"
 #include "ChiliException.h"
+#include "ImageDecoder.h"
+#include "ImageEncoder.h"
+#include "MappedFile.h"
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cwctype>
+#include <vector>
+
+#ifdef _WIN32
+#define FULL_WINTARD
+#include "ChiliWin.h"
 namespace Gdiplus
 {
 	using std::min;
 	using std::max;
 }
 #include <gdiplus.h>
-#include <sstream>
 
 #pragma comment( lib,"gdiplus.lib" )
+#endif
 
 void Surface::PutPixelAlpha( unsigned int x,unsigned int y,Color c )
 {
@@ -50,88 +60,185 @@ void Surface::PutPixelAlpha( unsigned int x,unsigned int y,Color c )
 	PutPixel( x,y,{ rsltRed,rsltGreen,rsltBlue } );
 }
 
-Surface Surface::FromFile( const std::wstring & name )
+namespace
 {
-	unsigned int width = 0;
-	unsigned int height = 0;
-	unsigned int pitch = 0;
-	std::unique_ptr<Color[]> pBuffer = nullptr;
-
+	std::wstring Widen( const char* msg )
+	{
+		const std::string narrow( msg );
+		return std::wstring( narrow.begin(),narrow.end() );
+	}
+	std::ofstream OpenForWrite( const std::wstring& filename )
+	{
+	#ifdef _WIN32
+		return std::ofstream( filename,std::ios::binary );
+	#else
+		return std::ofstream( ToNarrowPath( filename ),std::ios::binary );
+	#endif
+	}
+	void WriteLE( std::ofstream& file,unsigned int value,int nBytes )
 	{
-		Gdiplus::Bitmap bitmap( name.c_str() );
-		if( bitmap.GetLastStatus() != Gdiplus::Status::Ok )
+		for( int i = 0; i < nBytes; i++ )
 		{
-			std::wstringstream ss;
-			ss << L"Loading image [" << name << L"]: failed to load.";
-			throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+			file.put( char( (value >> (i * 8)) & 0xFFu ) );
 		}
+	}
+}
 
-		pitch = width = bitmap.GetWidth();
-		height = bitmap.GetHeight();
-		pBuffer = std::make_unique<Color[]>( width * height );
+Surface Surface::FromFile( const std::wstring & name )
+{
+	// map the file so the decoders read straight out of the page cache
+	std::shared_ptr<MappedFile> pFile;
+	try
+	{
+		pFile = std::make_shared<MappedFile>( name );
+	}
+	catch( const std::runtime_error& e )
+	{
+		std::wstringstream ss;
+		ss << L"Loading image [" << name << L"]: " << Widen( e.what() ) << L".";
+		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
 
-		for( unsigned int y = 0; y < height; y++ )
-		{
-			for( unsigned int x = 0; x < width; x++ )
-			{
-				Gdiplus::Color c;
-				bitmap.GetPixel( x,y,&c );
-				pBuffer[y * pitch + x] = c.GetValue();
-			}
-		}
+	// raw images are used in place, the mapping lives as long as the buffer does
+	ImageDecoder::RawHeader header;
+	if( Color* const pPixels = ImageDecoder::GetRawPixels( pFile->GetData(),pFile->GetSize(),header ) )
+	{
+		return Surface( header.width,header.height,header.pitch,Buffer( pPixels,BufferDeleter( std::move( pFile ) ) ) );
+	}
+
+	ImageDecoder::Image image;
+	bool decoded = false;
+	try
+	{
+		decoded = ImageDecoder::Decode( pFile->GetData(),pFile->GetSize(),image );
+	}
+	catch( const std::runtime_error& e )
+	{
+		std::wstringstream ss;
+		ss << L"Loading image [" << name << L"]: " << Widen( e.what() ) << L".";
+		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+	if( decoded )
+	{
+		return Surface( image.width,image.height,image.width,Buffer( image.pPixels.release() ) );
 	}
+	pFile.reset();
 
-	return Surface( width,height,pitch,std::move( pBuffer ) );
+#ifdef _WIN32
+	// formats the portable decoders do not cover (cmyk / arithmetic coded jpeg, gif, tiff...)
+	// gdi+ converts the whole image in one go straight into our buffer
+	Gdiplus::Bitmap bitmap( name.c_str() );
+	if( bitmap.GetLastStatus() != Gdiplus::Status::Ok )
+	{
+		std::wstringstream ss;
+		ss << L"Loading image [" << name << L"]: failed to load.";
+		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+
+	const unsigned int width = bitmap.GetWidth();
+	const unsigned int height = bitmap.GetHeight();
+	Buffer pBuffer( new Color[width * height] );
+
+	const Gdiplus::Rect rect( 0,0,INT( width ),INT( height ) );
+	Gdiplus::BitmapData data;
+	data.Width = width;
+	data.Height = height;
+	data.Stride = INT( width * sizeof( Color ) );
+	data.PixelFormat = PixelFormat32bppARGB;
+	data.Scan0 = pBuffer.get();
+	data.Reserved = 0;
+	if( bitmap.LockBits( &rect,Gdiplus::ImageLockModeRead | Gdiplus::ImageLockModeUserInputBuf,
+		PixelFormat32bppARGB,&data ) != Gdiplus::Status::Ok )
+	{
+		std::wstringstream ss;
+		ss << L"Loading image [" << name << L"]: failed to read pixels.";
+		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+	bitmap.UnlockBits( &data );
+
+	return Surface( width,height,width,std::move( pBuffer ) );
+#else
+	std::wstringstream ss;
+	ss << L"Loading image [" << name << L"]: unsupported image format.";
+	throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+#endif
 }
 
 void Surface::Save( const std::wstring & filename ) const
 {
-	auto GetEncoderClsid = [&filename]( const WCHAR* format,CLSID* pClsid ) -> void
+	std::ofstream file = OpenForWrite( filename );
+	if( !file )
 	{
-		UINT  num = 0;          // number of image encoders
-		UINT  size = 0;         // size of the image encoder array in bytes
-
-		Gdiplus::ImageCodecInfo* pImageCodecInfo = nullptr;
-
-		Gdiplus::GetImageEncodersSize( &num,&size );
-		if( size == 0 )
-		{
-			std::wstringstream ss;
-			ss << L"Saving surface to [" << filename << L"]: failed to get encoder; size == 0.";
-			throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
-		}
+		std::wstringstream ss;
+		ss << L"Saving surface to [" << filename << L"]: failed to open file.";
+		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
 
-		pImageCodecInfo = (Gdiplus::ImageCodecInfo*)(malloc( size ));
-		if( pImageCodecInfo == nullptr )
+	std::wstring extension = filename.substr( std::min( filename.size(),filename.find_last_of( L'.' ) ) );
+	std::transform( extension.begin(),extension.end(),extension.begin(),[]( wchar_t c ) { return wchar_t( std::towlower( c ) ); } );
+	const std::streamsize rowBytes = std::streamsize( width * sizeof( Color ) );
+	if( extension == L".bgra" )
+	{
+		// raw header followed by the rows, packed
+		file.write( "BGRA",4 );
+		WriteLE( file,width,4 );
+		WriteLE( file,height,4 );
+		WriteLE( file,width,4 );
+		for( unsigned int y = 0; y < height; y++ )
 		{
-			std::wstringstream ss;
-			ss << L"Saving surface to [" << filename << L"]: failed to get encoder; failed to allocate memory.";
-			throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
+			file.write( reinterpret_cast<const char*>( &pBuffer[pitch * y] ),rowBytes );
 		}
-
-		GetImageEncoders( num,size,pImageCodecInfo );
-
-		for( UINT j = 0; j < num; ++j )
+	}
+	else if( extension == L".ppm" )
+	{
+		// binary 24-bit rgb
+		std::ostringstream header;
+		header << "P6\n" << width << " " << height << "\n255\n";
+		file << header.str();
+		std::vector<char> row( width * 3u );
+		for( unsigned int y = 0; y < height; y++ )
 		{
-			if( wcscmp( pImageCodecInfo[j].MimeType,format ) == 0 )
+			for( unsigned int x = 0; x < width; x++ )
 			{
-				*pClsid = pImageCodecInfo[j].Clsid;
-				free( pImageCodecInfo );
-				return;
+				const Color c = pBuffer[pitch * y + x];
+				row[x * 3u] = char( c.GetR() );
+				row[x * 3u + 1u] = char( c.GetG() );
+				row[x * 3u + 2u] = char( c.GetB() );
 			}
+			file.write( row.data(),std::streamsize( row.size() ) );
 		}
+	}
+	else if( extension == L".png" )
+	{
+		const auto png = ImageEncoder::EncodePng( pBuffer.get(),width,height,pitch );
+		file.write( reinterpret_cast<const char*>( png.data() ),std::streamsize( png.size() ) );
+	}
+	else
+	{
+		// 32-bit BI_RGB bitmap, bottom-up (rows need no padding at 4 bytes per pixel)
+		const unsigned int dataSize = height * width * unsigned( sizeof( Color ) );
+		file.write( "BM",2 );
+		WriteLE( file,14u + 40u + dataSize,4 );
+		WriteLE( file,0u,4 );
+		WriteLE( file,14u + 40u,4 );
+		WriteLE( file,40u,4 );
+		WriteLE( file,width,4 );
+		WriteLE( file,height,4 );
+		WriteLE( file,1u,2 );
+		WriteLE( file,32u,2 );
+		WriteLE( file,0u,4 );
+		WriteLE( file,dataSize,4 );
+		WriteLE( file,2835u,4 );
+		WriteLE( file,2835u,4 );
+		WriteLE( file,0u,4 );
+		WriteLE( file,0u,4 );
+		for( unsigned int y = height; y-- > 0; )
+		{
+			file.write( reinterpret_cast<const char*>( &pBuffer[pitch * y] ),rowBytes );
+		}
+	}
 
-		free( pImageCodecInfo );
-		std::wstringstream ss;
-		ss << L"Saving surface to [" << filename << 
-			L"]: failed to get encoder; failed to find matching encoder.";
-		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
-	};
-
-	CLSID bmpID;
-	GetEncoderClsid( L"image/bmp",&bmpID );
-	Gdiplus::Bitmap bitmap( width,height,pitch * sizeof( Color ),PixelFormat32bppARGB,(BYTE*)pBuffer.get() );
-	if( bitmap.Save( filename.c_str(),&bmpID,nullptr ) != Gdiplus::Status::Ok )
+	if( !file )
 	{
 		std::wstringstream ss;
 		ss << L"Saving surface to [" << filename << L"]: failed to save.";
@@ -154,4 +261,4 @@ void Surface::Copy( const Surface & src )
 			memcpy( &pBuffer[pitch * y],&src.pBuffer[pitch * y],sizeof( Color )* width );
 		}
 	}
-}
+}
\ No newline at end of file
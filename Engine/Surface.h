@@ -19,13 +19,16 @@
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
 #pragma once
-#include "ChiliWin.h"
 #include "Colors.h"
 #include "Rect.h"
+#include "FastClear.h"
 #include "ChiliException.h"
 #include <string>
 #include <assert.h>
 #include <memory>
+#include <cstring>
+
+class MappedFile;
 
 
 class Surface
@@ -38,10 +41,42 @@ public:
 		virtual std::wstring GetFullMessage() const override { return GetNote() + L"\nAt: " + GetLocation(); }
 		virtual std::wstring GetExceptionType() const override { return L"Surface Exception"; }
 	};
+private:
+	// frees the pixel buffer, unless the pixels live inside a mapped file
+	// in which case the mapping is released along with the deleter
+	// (or the pixels are borrowed, then they are left alone)
+	class BufferDeleter
+	{
+	public:
+		BufferDeleter()
+			:
+			owned( true )
+		{}
+		BufferDeleter( std::shared_ptr<MappedFile> pMapping )
+			:
+			pMapping( std::move( pMapping ) ),
+			owned( false )
+		{}
+		static BufferDeleter Borrowed()
+		{
+			return BufferDeleter( std::shared_ptr<MappedFile>() );
+		}
+		void operator()( Color* p ) const
+		{
+			if( owned )
+			{
+				delete[] p;
+			}
+		}
+	private:
+		std::shared_ptr<MappedFile> pMapping;
+		bool owned;
+	};
+	typedef std::unique_ptr<Color[],BufferDeleter> Buffer;
 public:
 	Surface( unsigned int width,unsigned int height,unsigned int pitch )
 		:
-		pBuffer( std::make_unique<Color[]>( pitch * height ) ),
+		pBuffer( new Color[pitch * height] ),
 		width( width ),
 		height( height ),
 		pitch( pitch )
@@ -72,10 +107,31 @@ public:
 	{}
 	void Clear( Color fillValue  )
 	{
-		memset( pBuffer.get(),fillValue.dword,pitch * height * sizeof( Color ) );
+		Fill32( pBuffer.get(),size_t( pitch ) * height,fillValue );
 	}
-	void Present( unsigned int dstPitch,BYTE* const pDst ) const
+	// fills the pixels in [left,right) x [top,bottom)
+	void Fill( const RectI& rect,Color fillValue )
 	{
+		assert( rect.left >= 0 && rect.top >= 0 );
+		assert( rect.right <= int( width ) && rect.bottom <= int( height ) );
+		for( int y = rect.top; y < rect.bottom; y++ )
+		{
+			Fill32( &pBuffer[y * pitch + rect.left],size_t( rect.GetWidth() ),fillValue );
+		}
+	}
+	void Present( unsigned int dstPitch,unsigned char* const pDst ) const
+	{
+		// drawn in place, nothing to copy
+		if( reinterpret_cast<const unsigned char*>( pBuffer.get() ) == pDst )
+		{
+			assert( dstPitch == pitch * sizeof( Color ) );
+			return;
+		}
+		if( dstPitch == pitch * sizeof( Color ) )
+		{
+			memcpy( pDst,pBuffer.get(),dstPitch * (height - 1u) + sizeof( Color ) * width );
+			return;
+		}
 		for( unsigned int y = 0; y < height; y++ )
 		{
 			memcpy( &pDst[dstPitch * y],&pBuffer[pitch * y],sizeof(Color) * width );
@@ -118,7 +174,18 @@ public:
 	{
 		return pBuffer.get();
 	}
+	// png, jpg, bmp and tga are decoded directly into the surface buffer,
+	// raw .bgra images (see ImageDecoder::RawHeader) are mapped and used in place
+	// on windows anything else is handed to gdi+
 	static Surface FromFile( const std::wstring& name );
+	// surface on top of memory owned by somebody else (mapped texture, encoder
+	// input...), the memory has to outlive the surface and pitch is in pixels
+	static Surface Borrow( unsigned int width,unsigned int height,unsigned int pitch,Color* pPixels )
+	{
+		return Surface( width,height,pitch,Buffer( pPixels,BufferDeleter::Borrowed() ) );
+	}
+	// saves as 32-bit bmp, or by the extension of the filename as raw bgra (.bgra),
+	// binary ppm (.ppm) or deflated png (.png)
 	void Save( const std::wstring& filename ) const;
 	void Copy( const Surface& src );
 private:
@@ -129,7 +196,7 @@ private:
 		const unsigned int pixelAlignment = byteAlignment / sizeof( Color );
 		return width + ( pixelAlignment - width % pixelAlignment ) % pixelAlignment;
 	}
-	Surface( unsigned int width,unsigned int height,unsigned int pitch,std::unique_ptr<Color[]> pBufferParam )
+	Surface( unsigned int width,unsigned int height,unsigned int pitch,Buffer pBufferParam )
 		:
 		width( width ),
 		height( height ),
@@ -137,7 +204,7 @@ private:
 		pitch( pitch )
 	{}
 private:
-	std::unique_ptr<Color[]> pBuffer;
+	Buffer pBuffer;
 	unsigned int width;
 	unsigned int height;
 	unsigned int pitch; // pitch is in PIXELS, not bytes!
@@ -3,8 +3,11 @@
 #include "Pipeline.h"
 #include "DefaultVertexShader.h"
 #include "DefaultGeometryShader.h"
+#include "Codex.h"
+#include "TextureSampler.h"
 
 // basic texture effect
+template<class Sampler = PointSampler<ClampAddressing>>
 class TextureEffect
 {
 public:
@@ -75,7 +78,7 @@ public:
 	// does not touch attributes
 	typedef DefaultVertexShader<Vertex> VertexShader;
 	// default gs passes vertices through and outputs triangle
-	typedef DefaultGeometryShader<VertexShader::Output> GeometryShader;
+	typedef DefaultGeometryShader<typename VertexShader::Output> GeometryShader;
 	// invoked for each pixel of a triangle
 	// takes an input of attributes that are the
 	// result of interpolating vertex attributes
@@ -86,25 +89,16 @@ public:
 		template<class Input>
 		Color operator()( const Input& in ) const
 		{
-			return pTex->GetPixel(
-				(unsigned int)std::min( in.t.x * tex_width + 0.5f,tex_xclamp ),
-				(unsigned int)std::min( in.t.y * tex_height + 0.5f,tex_yclamp )
-			);
+			return sampler( in.t );
 		}
 		void BindTexture( const std::wstring& filename )
 		{
-			pTex = std::make_unique<Surface>( Surface::FromFile( filename ) );
-			tex_width = float( pTex->GetWidth() );
-			tex_height = float( pTex->GetHeight() );
-			tex_xclamp = tex_width - 1.0f;
-			tex_yclamp = tex_height - 1.0f;
+			pTex = Codex<Surface>::Retrieve( filename );
+			sampler.Bind( *pTex );
 		}
 	private:
-		std::unique_ptr<Surface> pTex;
-		float tex_width;
-		float tex_height;
-		float tex_xclamp;
-		float tex_yclamp;
+		std::shared_ptr<const Surface> pTex;
+		Sampler sampler;
 	};
 public:
 	VertexShader vs;
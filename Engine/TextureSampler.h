@@ -0,0 +1,252 @@
+#pragma once
+
+#include "Surface.h"
+#include "CompressedSurface.h"
+#include "Vec2.h"
+#include <algorithm>
+#include <emmintrin.h>
+
+// floor for floats that fit in an int, without going through the crt
+inline int FloorToInt( float x )
+{
+	const int i = int( x );
+	return i - int( x < float( i ) );
+}
+
+// per-axis texture dimensions, precalculated at bind time
+class TexelAxis
+{
+public:
+	TexelAxis() = default;
+	TexelAxis( unsigned int size_in )
+		:
+		size( int( size_in ) ),
+		fsize( float( size_in ) ),
+		mask( int( size_in ) - 1 ),
+		isPow2( size_in != 0u && (size_in & (size_in - 1u)) == 0u )
+	{}
+public:
+	int size = 1;
+	float fsize = 1.0f;
+	int mask = 0;
+	bool isPow2 = true;
+};
+
+// texture addressing policies
+//   Normalize() folds a texture coordinate into [0,1]
+//   Fix() folds a texel index in [-1,size] into [0,size)
+//   Point() maps a texture coordinate directly to a texel index
+// power of two textures are folded with a bitmask instead, which lets
+// Point() skip the normalization entirely (no divides, no floor in the loop)
+struct WrapAddressing
+{
+	static float Normalize( float t )
+	{
+		return t - float( FloorToInt( t ) );
+	}
+	static int Fix( int i,const TexelAxis& a )
+	{
+		if( a.isPow2 )
+		{
+			return i & a.mask;
+		}
+		return i < 0 ? i + a.size : (i >= a.size ? i - a.size : i);
+	}
+	static int Point( float t,const TexelAxis& a )
+	{
+		if( a.isPow2 )
+		{
+			return FloorToInt( t * a.fsize + 0.5f ) & a.mask;
+		}
+		return Fix( FloorToInt( Normalize( t ) * a.fsize + 0.5f ),a );
+	}
+};
+
+struct ClampAddressing
+{
+	static float Normalize( float t )
+	{
+		return t;
+	}
+	static int Fix( int i,const TexelAxis& a )
+	{
+		// (mask is always size - 1)
+		return std::min( std::max( i,0 ),a.mask );
+	}
+	static int Point( float t,const TexelAxis& a )
+	{
+		return Fix( FloorToInt( t * a.fsize + 0.5f ),a );
+	}
+};
+
+struct MirrorAddressing
+{
+	static float Normalize( float t )
+	{
+		// triangle wave with period 2
+		const float m = t - 2.0f * float( FloorToInt( t * 0.5f ) );
+		return m < 1.0f ? m : 2.0f - m;
+	}
+	static int Fix( int i,const TexelAxis& a )
+	{
+		if( a.isPow2 )
+		{
+			const int j = i & (2 * a.size - 1);
+			return j < a.size ? j : 2 * a.size - 1 - j;
+		}
+		return i < 0 ? -1 - i : (i >= a.size ? 2 * a.size - 1 - i : i);
+	}
+	static int Point( float t,const TexelAxis& a )
+	{
+		if( a.isPow2 )
+		{
+			return Fix( FloorToInt( t * a.fsize + 0.5f ),a );
+		}
+		return Fix( FloorToInt( Normalize( t ) * a.fsize + 0.5f ),a );
+	}
+};
+
+// texel storage policies
+//   Bind() takes the texture the storage reads from
+//   Fetch() returns the texel at (already addressed) integer coordinates
+
+// plain 32-bit surface
+class SurfaceTexels
+{
+public:
+	void Bind( const Surface& tex )
+	{
+		pBuffer = tex.GetBufferPtrConst();
+		pitch = int( tex.GetPitch() );
+	}
+	Color Fetch( int x,int y ) const
+	{
+		return pBuffer[y * pitch + x];
+	}
+private:
+	const Color* pBuffer = nullptr;
+	int pitch = 0;
+};
+
+// block compressed surface, decoded on demand into a small direct mapped
+// cache of blocks (slots are picked from the low bits of the block coordinates,
+// so a cache covers a 32x16 texel window and neighboring blocks never collide)
+// the cache makes Fetch() logically const only: it writes tags / cache, so
+// calling Fetch() on the same instance from more than one thread is a data
+// race (each thread that samples needs its own copy of the sampler)
+class BlockTexels
+{
+public:
+	static constexpr int slotsX = 8;
+	static constexpr int slotsY = 4;
+public:
+	void Bind( const CompressedSurface& tex )
+	{
+		pTex = &tex;
+		blocksX = int( tex.GetBlocksX() );
+		std::fill( std::begin( tags ),std::end( tags ),-1 );
+	}
+	Color Fetch( int x,int y ) const
+	{
+		const int bx = x >> 2;
+		const int by = y >> 2;
+		const int slot = (bx & (slotsX - 1)) + (by & (slotsY - 1)) * slotsX;
+		const int tag = by * blocksX + bx;
+		if( tags[slot] != tag )
+		{
+			pTex->DecodeBlock( (unsigned int)bx,(unsigned int)by,cache[slot] );
+			tags[slot] = tag;
+		}
+		return cache[slot][(y & 3) * 4 + (x & 3)];
+	}
+private:
+	const CompressedSurface* pTex = nullptr;
+	int blocksX = 0;
+	mutable int tags[slotsX * slotsY];
+	mutable Color cache[slotsX * slotsY][16];
+};
+
+// nearest texel sampler (texel chosen by rounding, same as the old
+// inline lookups in the effects)
+template<class Addressing,class Texels = SurfaceTexels>
+class PointSampler
+{
+public:
+	Color operator()( const Vec2& t ) const
+	{
+		return texels.Fetch( Addressing::Point( t.x,xAxis ),Addressing::Point( t.y,yAxis ) );
+	}
+	template<class Texture>
+	void Bind( const Texture& tex )
+	{
+		texels.Bind( tex );
+		xAxis = TexelAxis( tex.GetWidth() );
+		yAxis = TexelAxis( tex.GetHeight() );
+	}
+private:
+	Texels texels;
+	TexelAxis xAxis;
+	TexelAxis yAxis;
+};
+
+// bilinear filtering sampler
+// the four texels are filtered with 8.8 fixed point weights in sse2 16-bit lanes,
+// all four channels of a pair of texels per register, so filtering costs only
+// a handful of instructions more than a point sample
+template<class Addressing,class Texels = SurfaceTexels>
+class BilinearSampler
+{
+public:
+	Color operator()( const Vec2& t ) const
+	{
+		// texel space coordinate relative to texel centers
+		const float x = Addressing::Normalize( t.x ) * xAxis.fsize - 0.5f;
+		const float y = Addressing::Normalize( t.y ) * yAxis.fsize - 0.5f;
+		const int x0 = FloorToInt( x );
+		const int y0 = FloorToInt( y );
+		// fractional parts as 8-bit weights
+		const int fx = int( (x - float( x0 )) * 256.0f );
+		const int fy = int( (y - float( y0 )) * 256.0f );
+		// resolve neighbor texel addresses
+		const int xa = Addressing::Fix( x0,xAxis );
+		const int xb = Addressing::Fix( x0 + 1,xAxis );
+		const int ya = Addressing::Fix( y0,yAxis );
+		const int yb = Addressing::Fix( y0 + 1,yAxis );
+
+		const __m128i zero = _mm_setzero_si128();
+		// expand texel pairs (left|right) of each row to 16 bits per channel
+		const __m128i rowA = _mm_unpacklo_epi8(
+			_mm_unpacklo_epi32( _mm_cvtsi32_si128( int( texels.Fetch( xa,ya ).dword ) ),_mm_cvtsi32_si128( int( texels.Fetch( xb,ya ).dword ) ) ),
+			zero
+		);
+		const __m128i rowB = _mm_unpacklo_epi8(
+			_mm_unpacklo_epi32( _mm_cvtsi32_si128( int( texels.Fetch( xa,yb ).dword ) ),_mm_cvtsi32_si128( int( texels.Fetch( xb,yb ).dword ) ) ),
+			zero
+		);
+		// vertical blend of both columns at once, rounded
+		// (max 255 * 256 + 128 per lane so this never overflows 16 bits)
+		const __m128i half = _mm_set1_epi16( 128 );
+		const __m128i col = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16(
+			_mm_mullo_epi16( rowA,_mm_set1_epi16( short( 256 - fy ) ) ),
+			_mm_mullo_epi16( rowB,_mm_set1_epi16( short( fy ) ) )
+		),half ),8 );
+		// horizontal blend: weight left/right halves, then fold high half onto low half
+		const __m128i weighted = _mm_mullo_epi16( col,_mm_set_epi16(
+			short( fx ),short( fx ),short( fx ),short( fx ),
+			short( 256 - fx ),short( 256 - fx ),short( 256 - fx ),short( 256 - fx )
+		) );
+		const __m128i sum = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( weighted,_mm_srli_si128( weighted,8 ) ),half ),8 );
+		return Color( (unsigned int)_mm_cvtsi128_si32( _mm_packus_epi16( sum,zero ) ) );
+	}
+	template<class Texture>
+	void Bind( const Texture& tex )
+	{
+		texels.Bind( tex );
+		xAxis = TexelAxis( tex.GetWidth() );
+		yAxis = TexelAxis( tex.GetHeight() );
+	}
+private:
+	Texels texels;
+	TexelAxis xAxis;
+	TexelAxis yAxis;
+};
\ No newline at end of file
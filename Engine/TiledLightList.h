@@ -0,0 +1,217 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Vec4.h"
+#include "Mat.h"
+#include "Graphics.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// point light (position in view space, color in 0..1 units)
+struct PointLight
+{
+	Vec3 pos;
+	Vec3 color;
+};
+
+// list of point lights binned into screen tiles
+// each light is given a radius from the PointDiffuse attenuation constants (the
+// distance where its attenuated color drops below the cutoff), the projected
+// bounds of that sphere decide which tiles it is added to
+// so a pixel only has to visit the lights that can reach its tile
+template<class PointDiffuse>
+class TiledLightList
+{
+public:
+	static constexpr int tileSize = 16;
+	static constexpr int tilesX = int( (Graphics::ScreenWidth + tileSize - 1) / tileSize );
+	static constexpr int tilesY = int( (Graphics::ScreenHeight + tileSize - 1) / tileSize );
+	// light as stored in a tile (copied per tile so the shading loop reads contiguous memory)
+	struct Entry
+	{
+		Vec3 pos;
+		float radiusSq;
+		Vec3 color;
+	};
+	class Span
+	{
+	public:
+		const Entry* begin() const
+		{
+			return pBegin;
+		}
+		const Entry* end() const
+		{
+			return pEnd;
+		}
+	public:
+		const Entry* pBegin;
+		const Entry* pEnd;
+	};
+public:
+	// cutoff is the largest contribution (per channel, before specular) that may be dropped
+	TiledLightList( float cutoff = 1.0f / 512.0f )
+		:
+		cutoff( cutoff ),
+		offsets( tilesX * tilesY + 1 )
+	{}
+	void Clear()
+	{
+		lights.clear();
+	}
+	void AddLight( const PointLight& light )
+	{
+		lights.push_back( light );
+	}
+	const std::vector<PointLight>& GetLights() const
+	{
+		return lights;
+	}
+	// distance at which a light of the given peak channel value fades below the cutoff
+	// (solves c + l*d + q*d^2 = peak / cutoff, negative if it never gets that bright)
+	float GetRadius( float peak ) const
+	{
+		constexpr float c = PointDiffuse::constant_attenuation;
+		constexpr float l = PointDiffuse::linear_attenuation;
+		constexpr float q = PointDiffuse::quadradic_attenuation;
+		const float k = peak / cutoff - c;
+		if( k <= 0.0f )
+		{
+			return -1.0f;
+		}
+		if constexpr( q > 0.0f )
+		{
+			return (std::sqrt( l * l + 4.0f * q * k ) - l) / (2.0f * q);
+		}
+		else if constexpr( l > 0.0f )
+		{
+			return k / l;
+		}
+		else
+		{
+			return std::numeric_limits<float>::infinity();
+		}
+	}
+	// bins the lights added since the last Clear() (proj is the projection the
+	// view space light positions will be rendered with)
+	void Build( const Mat4& proj )
+	{
+		rects.resize( lights.size() );
+		std::fill( offsets.begin(),offsets.end(),0u );
+		// pass 1: tile rect of each light, count lights per tile
+		for( size_t i = 0; i < lights.size(); i++ )
+		{
+			rects[i] = GetTileRect( lights[i],proj );
+			const auto& r = rects[i];
+			for( int ty = r.top; ty < r.bottom; ty++ )
+			{
+				for( int tx = r.left; tx < r.right; tx++ )
+				{
+					offsets[ty * tilesX + tx + 1]++;
+				}
+			}
+		}
+		// counts -> offsets (tile i spans [offsets[i],offsets[i + 1]))
+		for( size_t i = 1; i < offsets.size(); i++ )
+		{
+			offsets[i] += offsets[i - 1];
+		}
+		// pass 2: scatter the lights into their tiles
+		entries.resize( offsets.back() );
+		cursors.assign( offsets.begin(),offsets.end() - 1 );
+		for( size_t i = 0; i < lights.size(); i++ )
+		{
+			const auto& r = rects[i];
+			const Entry e = { lights[i].pos,sq( r.radius ),lights[i].color };
+			for( int ty = r.top; ty < r.bottom; ty++ )
+			{
+				for( int tx = r.left; tx < r.right; tx++ )
+				{
+					entries[cursors[ty * tilesX + tx]++] = e;
+				}
+			}
+		}
+	}
+	// lights that can reach the pixel at x,y (screen coordinates)
+	Span GetTileLights( int x,int y ) const
+	{
+		const int tile = (y / tileSize) * tilesX + x / tileSize;
+		return { entries.data() + offsets[tile],entries.data() + offsets[tile + 1] };
+	}
+	// total number of light entries over all tiles (lights * tiles they touch)
+	size_t GetEntryCount() const
+	{
+		return entries.size();
+	}
+private:
+	// half open range of tiles
+	struct TileRect
+	{
+		int left;
+		int top;
+		int right;
+		int bottom;
+		float radius;
+	};
+	TileRect GetTileRect( const PointLight& light,const Mat4& proj ) const
+	{
+		const float peak = std::max( std::max( light.color.x,light.color.y ),light.color.z );
+		const float radius = GetRadius( peak );
+		TileRect r = { 0,0,0,0,radius };
+		// can't reach anything in front of the camera
+		if( radius < 0.0f || light.pos.z + radius <= 0.0f )
+		{
+			return r;
+		}
+		// the sphere straddles the eye plane, its projection is unbounded
+		if( light.pos.z - radius <= 0.0f )
+		{
+			r.right = tilesX;
+			r.bottom = tilesY;
+			return r;
+		}
+		// screen bounds of the projected corners of the bounding box of the sphere
+		float xMin = std::numeric_limits<float>::max();
+		float yMin = std::numeric_limits<float>::max();
+		float xMax = std::numeric_limits<float>::lowest();
+		float yMax = std::numeric_limits<float>::lowest();
+		for( int i = 0; i < 8; i++ )
+		{
+			const Vec3 corner = light.pos + Vec3{
+				(i & 1) ? radius : -radius,
+				(i & 2) ? radius : -radius,
+				(i & 4) ? radius : -radius
+			};
+			const auto clip = Vec4( corner ) * proj;
+			const float wInv = 1.0f / clip.w;
+			const float sx = (clip.x * wInv + 1.0f) * (float( Graphics::ScreenWidth ) / 2.0f);
+			const float sy = (-clip.y * wInv + 1.0f) * (float( Graphics::ScreenHeight ) / 2.0f);
+			xMin = std::min( xMin,sx );
+			xMax = std::max( xMax,sx );
+			yMin = std::min( yMin,sy );
+			yMax = std::max( yMax,sy );
+		}
+		// entirely off screen
+		if( xMax < 0.0f || yMax < 0.0f ||
+			xMin >= float( Graphics::ScreenWidth ) || yMin >= float( Graphics::ScreenHeight ) )
+		{
+			return r;
+		}
+		// (clamped as floats, corners close to the eye plane project very far out)
+		r.left = int( std::max( xMin,0.0f ) ) / tileSize;
+		r.top = int( std::max( yMin,0.0f ) ) / tileSize;
+		r.right = int( std::min( xMax,float( Graphics::ScreenWidth - 1u ) ) ) / tileSize + 1;
+		r.bottom = int( std::min( yMax,float( Graphics::ScreenHeight - 1u ) ) ) / tileSize + 1;
+		return r;
+	}
+private:
+	float cutoff;
+	std::vector<PointLight> lights;
+	// per frame scratch and results
+	std::vector<TileRect> rects;
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> cursors;
+	std::vector<Entry> entries;
+};
\ No newline at end of file
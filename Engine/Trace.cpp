@@ -0,0 +1,158 @@
+#include "Trace.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// single producer ring, the owning thread bumps head after writing an event,
+// readers copy and then check the events they copied weren't overwritten meanwhile
+struct Trace::ThreadBuffer
+{
+	static constexpr size_t capacity = size_t( 1u ) << 16;
+	std::unique_ptr<Event[]> events = std::make_unique<Event[]>( capacity );
+	std::atomic<size_t> head{ 0u };
+	// events before this one were dropped by Start
+	std::atomic<size_t> first{ 0u };
+	std::string name;
+	unsigned int id = 0u;
+};
+
+// buffers of every thread that ever traced, kept until exit so the events of
+// threads that are gone can still be dumped
+struct Trace::Registry
+{
+	std::mutex mtx;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+std::atomic<bool> Trace::recording{ false };
+
+namespace
+{
+	std::string Escape( const std::string& s )
+	{
+		std::string escaped;
+		for( const char c : s )
+		{
+			if( c == '"' || c == '\\' )
+			{
+				escaped.push_back( '\\' );
+			}
+			escaped.push_back( c );
+		}
+		return escaped;
+	}
+}
+
+Trace::Registry& Trace::GetRegistry()
+{
+	// never destroyed, threads (job workers) may still trace during static destruction
+	static Registry* const pRegistry = new Registry;
+	return *pRegistry;
+}
+
+Trace::ThreadBuffer& Trace::GetThreadBuffer()
+{
+	thread_local ThreadBuffer* pBuffer = nullptr;
+	if( !pBuffer )
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock( registry.mtx );
+		registry.buffers.push_back( std::make_unique<ThreadBuffer>() );
+		pBuffer = registry.buffers.back().get();
+		pBuffer->id = unsigned( registry.buffers.size() );
+		pBuffer->name = "thread " + std::to_string( pBuffer->id );
+	}
+	return *pBuffer;
+}
+
+void Trace::Record( const char* name,const char* category,long long begin,long long end )
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	const size_t head = buffer.head.load( std::memory_order_relaxed );
+	buffer.events[head % ThreadBuffer::capacity] = { name,category,begin,end };
+	buffer.head.store( head + 1u,std::memory_order_release );
+}
+
+void Trace::Start()
+{
+	auto& registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> lock( registry.mtx );
+		for( auto& pBuffer : registry.buffers )
+		{
+			pBuffer->first.store( pBuffer->head.load( std::memory_order_acquire ) );
+		}
+	}
+	recording.store( true );
+}
+
+void Trace::Resume()
+{
+	recording.store( true );
+}
+
+void Trace::Stop()
+{
+	recording.store( false );
+}
+
+void Trace::SetThreadName( const std::string& name )
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock( GetRegistry().mtx );
+	buffer.name = name;
+}
+
+void Trace::Dump( const std::wstring& filename )
+{
+#ifdef _WIN32
+	std::ofstream file( filename );
+#else
+	std::ofstream file( ToNarrowPath( filename ) );
+#endif
+	if( !file )
+	{
+		throw std::runtime_error( "Trace: cannot open " + ToNarrowPath( filename ) );
+	}
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool firstEvent = true;
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock( registry.mtx );
+	std::vector<Event> events;
+	for( const auto& pBuffer : registry.buffers )
+	{
+		const ThreadBuffer& buffer = *pBuffer;
+		file << (firstEvent ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id
+			<< ",\"args\":{\"name\":\"" << Escape( buffer.name ) << "\"}}";
+		firstEvent = false;
+		// copy the live part of the ring, then drop whatever the owner overwrote while we copied
+		const size_t head = buffer.head.load( std::memory_order_acquire );
+		const size_t begin = std::max( buffer.first.load(),head > ThreadBuffer::capacity ? head - ThreadBuffer::capacity : size_t( 0u ) );
+		events.clear();
+		for( size_t i = begin; i < head; i++ )
+		{
+			events.push_back( buffer.events[i % ThreadBuffer::capacity] );
+		}
+		// the slot of index headAfter is being written to, it shares its slot with headAfter - capacity
+		const size_t headAfter = buffer.head.load( std::memory_order_acquire );
+		const size_t intact = headAfter >= ThreadBuffer::capacity ? headAfter - ThreadBuffer::capacity + 1u : size_t( 0u );
+		const size_t overwritten = intact > begin ? std::min( intact - begin,events.size() ) : size_t( 0u );
+		for( size_t i = overwritten; i < events.size(); i++ )
+		{
+			const Event& e = events[i];
+			char times[64];
+			snprintf( times,sizeof( times ),"%.3f,\"dur\":%.3f",double( e.begin ) / 1000.0,double( e.end - e.begin ) / 1000.0 );
+			file << ",\n{\"name\":\"" << Escape( e.name ) << "\",\"cat\":\"" << Escape( e.category )
+				<< "\",\"ph\":\"X\",\"ts\":" << times << ",\"pid\":1,\"tid\":" << buffer.id << "}";
+		}
+	}
+	file << "\n]}\n";
+	if( !file )
+	{
+		throw std::runtime_error( "Trace: writing " + ToNarrowPath( filename ) + " failed" );
+	}
+}
\ No newline at end of file
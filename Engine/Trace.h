@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+// scoped timing markers for frame captures
+// every thread records into its own ring buffer (no locks, the oldest events
+// get overwritten), Dump writes what the buffers hold as chrome trace json for
+// chrome://tracing or ui.perfetto.dev
+// while not recording a marker costs one relaxed load
+class Trace
+{
+public:
+	// times the enclosing scope, name and category must be string literals
+	// (or otherwise outlive the capture)
+	class Scope
+	{
+	public:
+		Scope( const char* name,const char* category = "frame" )
+			:
+			name( name ),
+			category( category ),
+			begin( IsRecording() ? Now() : -1 )
+		{}
+		Scope( const Scope& ) = delete;
+		Scope& operator=( const Scope& ) = delete;
+		~Scope()
+		{
+			if( begin >= 0 )
+			{
+				Record( name,category,begin,Now() );
+			}
+		}
+	private:
+		const char* name;
+		const char* category;
+		long long begin;
+	};
+public:
+	static bool IsRecording()
+	{
+		return recording.load( std::memory_order_relaxed );
+	}
+	// drops what was recorded so far and starts recording
+	static void Start();
+	// starts recording again, keeping what was recorded before
+	static void Resume();
+	static void Stop();
+	// shows up as the name of the thread calling it in the trace
+	static void SetThreadName( const std::string& name );
+	// writes the events in the ring buffers as chrome trace json (can be called
+	// while recording, events written meanwhile may be left out)
+	static void Dump( const std::wstring& filename );
+private:
+	struct Event
+	{
+		const char* name;
+		const char* category;
+		long long begin;
+		long long end;
+	};
+	struct ThreadBuffer;
+	struct Registry;
+private:
+	// nanoseconds since the first use of the trace
+	static long long Now()
+	{
+		static const auto epoch = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - epoch ).count();
+	}
+	static void Record( const char* name,const char* category,long long begin,long long end );
+	// buffer of the calling thread, registered on first use
+	static ThreadBuffer& GetThreadBuffer();
+	static Registry& GetRegistry();
+private:
+	static std::atomic<bool> recording;
+};
+
+#define CHILI_TRACE_CAT_( a,b ) a ## b
+#define CHILI_TRACE_NAME_( line ) CHILI_TRACE_CAT_( chiliTraceScope,line )
+// times the rest of the enclosing scope: CHILI_TRACE( "name" ) or CHILI_TRACE( "name","category" )
+#define CHILI_TRACE( ... ) const Trace::Scope CHILI_TRACE_NAME_( __LINE__ )( __VA_ARGS__ )
\ No newline at end of file
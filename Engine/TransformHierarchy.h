@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Mat4x3.h"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// tree of local transforms with cached world matrices, setting a local transform
+// marks the node dirty and Update only recomputes the dirty nodes and everything
+// below them (world = local * parent world, row vectors like _Mat)
+// nodes live in flat arrays with every parent before its children, so Update is
+// one pass in index order where a parent is always done before its children read it
+// (put the view in a root node and the cached worlds are the world view matrices)
+class TransformHierarchy
+{
+public:
+	typedef size_t Node;
+	static constexpr Node none = ~Node( 0u );
+public:
+	// parent has to exist already, which keeps parents ahead of their children
+	Node AddNode( const Mat4x3& local,Node parent = none )
+	{
+		assert( parent == none || parent < locals.size() );
+		locals.push_back( local );
+		worlds.push_back( local );
+		parents.push_back( parent );
+		dirty.push_back( 1u );
+		anyDirty = true;
+		return locals.size() - 1u;
+	}
+	void SetLocal( Node node,const Mat4x3& local )
+	{
+		locals[node] = local;
+		dirty[node] = 1u;
+		anyDirty = true;
+	}
+	const Mat4x3& GetLocal( Node node ) const
+	{
+		return locals[node];
+	}
+	// as of the last Update
+	const Mat4x3& GetWorld( Node node ) const
+	{
+		return worlds[node];
+	}
+	size_t GetNodeCount() const
+	{
+		return locals.size();
+	}
+	// recomputes the worlds of the dirty nodes and their subtrees, returns how many
+	size_t Update()
+	{
+		if( !anyDirty )
+		{
+			return 0u;
+		}
+		size_t nUpdated = 0u;
+		for( Node i = 0u; i < locals.size(); i++ )
+		{
+			const Node parent = parents[i];
+			// the parent's flag is still up if it was recomputed in this pass
+			if( dirty[i] || (parent != none && dirty[parent]) )
+			{
+				worlds[i] = parent == none ? locals[i] : locals[i] * worlds[parent];
+				dirty[i] = 1u;
+				nUpdated++;
+			}
+		}
+		dirty.assign( dirty.size(),0u );
+		anyDirty = false;
+		return nUpdated;
+	}
+private:
+	std::vector<Mat4x3> locals;
+	std::vector<Mat4x3> worlds;
+	std::vector<Node> parents;
+	std::vector<uint8_t> dirty;
+	bool anyDirty = false;
+};
\ No newline at end of file
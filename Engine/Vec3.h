@@ -23,15 +23,20 @@
 #include <algorithm>
 #include "ChiliMath.h"
 #include "Vec2.h"
+#include <xmmintrin.h>
 
 template <typename T>
 class _Vec3 : public _Vec2<T>
 {
+public:
+	// members of a dependent base need naming for standard compilers
+	using _Vec2<T>::x;
+	using _Vec2<T>::y;
 public:
 	_Vec3() = default;
 	_Vec3( T x,T y,T z )
 		:
-		_Vec2( x,y ),
+		_Vec2<T>( x,y ),
 		z( z )
 	{}
 	template <typename T2>
@@ -169,6 +174,31 @@ public:
 	T z;
 };
 
+// loads and stores of float Vec3 / rows of 3 floats for the sse products in Mat.h
+// (define CHILI_SCALAR_MATH to get the templates, see Bench/MathBench.cpp)
+// the dot and cross products and normalization stay with the templates, sse
+// was slower for all three (the shuffles and the lane sum cost more than it saves)
+#ifndef CHILI_SCALAR_MATH
+static_assert( sizeof( _Vec3<float> ) == 3u * sizeof( float ),"the sse versions load x,y,z as one array" );
+
+// 3 floats in the low lanes, 0 in the last one (without reading past them)
+inline __m128 LoadFloat3( const float* p )
+{
+	return _mm_movelh_ps( _mm_loadl_pi( _mm_setzero_ps(),reinterpret_cast<const __m64*>( p ) ),_mm_load_ss( p + 2 ) );
+}
+
+inline void StoreFloat3( float* p,__m128 v )
+{
+	_mm_storel_pi( reinterpret_cast<__m64*>( p ),v );
+	_mm_store_ss( p + 2,_mm_movehl_ps( v,v ) );
+}
+
+inline void StoreVec3( _Vec3<float>& v,__m128 xyz )
+{
+	StoreFloat3( &v.x,xyz );
+}
+#endif
+
 typedef _Vec3<float> Vec3;
 typedef _Vec3<double> Ved3;
 typedef _Vec3<int> Vei3;
\ No newline at end of file
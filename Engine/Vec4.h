@@ -27,16 +27,21 @@
 template <typename T>
 class _Vec4 : public _Vec3<T>
 {
+public:
+	// members of a dependent base need naming for standard compilers
+	using _Vec3<T>::x;
+	using _Vec3<T>::y;
+	using _Vec3<T>::z;
 public:
 	_Vec4() = default;
 	_Vec4( T x,T y,T z,T w )
 		:
-		_Vec3( x,y,z ),
+		_Vec3<T>( x,y,z ),
 		w( w )
 	{}
-	_Vec4( const _Vec3& v3,float w = 1.0f  )
+	_Vec4( const _Vec3<T>& v3,float w = 1.0f  )
 		:
-		_Vec3( v3 ),
+		_Vec3<T>( v3 ),
 		w( w )
 	{}
 	template <typename T2>
@@ -2,6 +2,8 @@
 
 #include "Pipeline.h"
 #include "DefaultGeometryShader.h"
+#include "Codex.h"
+#include "TextureSampler.h"
 
 class WaveVertexTextureEffect
 {
@@ -172,7 +174,7 @@ public:
 			float l;
 		};
 	public:
-		Triangle<Output> operator()( const VertexShader::Output& in0,const VertexShader::Output& in1,const VertexShader::Output& in2,size_t triangle_index ) const
+		Triangle<Output> operator()( const VertexShader::Output& in0,const VertexShader::Output& in1,const VertexShader::Output& in2,size_t /*triangle_index*/ ) const
 		{
 			// calculate face normal
 			const auto n = ((in1.pos - in0.pos) % (in2.pos - in0.pos)).GetNormalized();
@@ -213,28 +215,19 @@ public:
 		Color operator()( const Input& in ) const
 		{
 			// lookup color in texture
-			const Vec3 color = Vec3( pTex->GetPixel(
-				(unsigned int)std::min( in.t.x * tex_width + 0.5f,tex_xclamp ),
-				(unsigned int)std::min( in.t.y * tex_height + 0.5f,tex_yclamp )
-			) );
+			const Vec3 color = Vec3( sampler( in.t ) );
 			// use texture color as material to determine ratio / magnitude
 			// of the different color components diffuse reflected from triangle at this pt.
 			return Color( color * in.l );
 		}
 		void BindTexture( const std::wstring& filename )
 		{
-			pTex = std::make_unique<Surface>( Surface::FromFile( filename ) );
-			tex_width = float( pTex->GetWidth() );
-			tex_height = float( pTex->GetHeight() );
-			tex_xclamp = tex_width - 1.0f;
-			tex_yclamp = tex_height - 1.0f;
+			pTex = Codex<Surface>::Retrieve( filename );
+			sampler.Bind( *pTex );
 		}
 	private:
-		std::unique_ptr<Surface> pTex;
-		float tex_width;
-		float tex_height;
-		float tex_xclamp;
-		float tex_yclamp;
+		std::shared_ptr<const Surface> pTex;
+		PointSampler<ClampAddressing> sampler;
 	};
 public:
 	VertexShader vs;
@@ -1,55 +1,142 @@
 #pragma once
 
+#include "DepthFormats.h"
+#include "FastClear.h"
 #include <limits>
 #include <cassert>
 #include <algorithm>
+#include <utility>
+#include <vector>
 
-class ZBuffer
+// depth of a triangle as a plane over the screen, z = a + b * x + c * y
+// with x,y the pixel indices (the pixel center offset is folded into a)
+struct DepthPlane
 {
+	float At( int x,int y ) const
+	{
+		return a + b * float( x ) + c * float( y );
+	}
+	float a;
+	float b;
+	float c;
+};
+
+// depth buffer holding Format::Stored per pixel (see DepthFormats.h)
+// tiles (16x16) are cleared lazily, and a tile entirely covered by one visible
+// triangle only keeps the depth plane of that triangle until one of its pixels
+// is tested on its own (so big flat surfaces cost no depth bandwidth)
+template<class StorageFormat>
+class DepthBuffer
+{
+public:
+	typedef StorageFormat Format;
+	typedef typename Format::Stored Stored;
+	static constexpr int tileShift = TileEpochs::tileShift;
+	static constexpr int tileSize = TileEpochs::tileSize;
+	// outcome of testing a whole tile against a triangle covering it
+	enum class TileTest
+	{
+		Partial,	// has to be tested pixel by pixel
+		Visible,	// every pixel passes, the depth of the tile has been set
+		Hidden		// every pixel fails
+	};
 public:
-	ZBuffer( int width,int height )
+	DepthBuffer( int width,int height )
 		:
 		width( width ),
 		height( height ),
-		pBuffer( new float[width*height] )
+		pBuffer( new Stored[width*height] ),
+		clearEpochs( width,height ),
+		planes( size_t( clearEpochs.GetTilesX() * clearEpochs.GetTilesY() ) )
 	{}
-	~ZBuffer()
+	~DepthBuffer()
 	{
 		delete[] pBuffer;
 		pBuffer = nullptr;
 	}
-	ZBuffer( const ZBuffer& ) = delete;
-	ZBuffer& operator=( const ZBuffer& ) = delete;
+	DepthBuffer( const DepthBuffer& ) = delete;
+	DepthBuffer& operator=( const DepthBuffer& ) = delete;
+	// only tags the tiles as stale, each tile is filled with Format::Far() when it
+	// is first touched (most of the screen is often never drawn to)
 	void Clear()
 	{
-		const int nDepths = width * height;
-		for( int i = 0; i < nDepths; i++ )
+		clearEpochs.Invalidate();
+		// the epoch wrapped around, old plane tags could pass for current ones
+		if( clearEpochs.GetEpoch() == 1u )
 		{
-			pBuffer[i] = std::numeric_limits<float>::infinity();
+			for( auto& p : planes )
+			{
+				p.epoch = 0u;
+			}
 		}
 	}
-	float& At( int x,int y )
+	Stored& At( int x,int y )
 	{
 		assert( x >= 0 );
 		assert( x < width );
 		assert( y >= 0 );
 		assert( y < height );
+		const int tile = clearEpochs.GetTileIndex( x,y );
+		if( clearEpochs.ClaimTile( tile ) )
+		{
+			ResolveTile( tile );
+		}
 		return pBuffer[y * width + x];
 	}
-	const float& At( int x,int y ) const
+	const Stored& At( int x,int y ) const
+	{
+		return const_cast<DepthBuffer*>(this)->At( x,y );
+	}
+	float GetDepth( int x,int y ) const
 	{
-		return const_cast<ZBuffer*>(this)->At( x,y );
+		return Format::Decode( At( x,y ) );
 	}
 	bool TestAndSet( int x,int y,float depth )
 	{
-		float& depthInBuffer = At( x,y );
-		if( depth < depthInBuffer )
+		const Stored encoded = Format::Encode( depth );
+		Stored& depthInBuffer = At( x,y );
+		if( Format::Closer( encoded,depthInBuffer ) )
 		{
-			depthInBuffer = depth;
+			depthInBuffer = encoded;
 			return true;
 		}
 		return false;
 	}
+	// depth test for the tile tx,ty (in tiles) against a triangle covering all of
+	// its pixels, plane is the depth of the triangle
+	// decides for the whole tile if the tile is still clear or holds a plane
+	TileTest TestTile( int tx,int ty,const DepthPlane& plane )
+	{
+		const int tile = ty * clearEpochs.GetTilesX() + tx;
+		// pixels stored one by one, they would all have to be read
+		if( clearEpochs.IsCurrent( tile ) )
+		{
+			return TileTest::Partial;
+		}
+		const RectI rect = clearEpochs.GetTileRect( tx << tileShift,ty << tileShift );
+		const auto range = GetRange( plane,rect );
+		PlaneTile& current = planes[tile];
+		Stored storedNearest = Format::Far();
+		Stored storedFarthest = Format::Far();
+		if( current.epoch == clearEpochs.GetEpoch() )
+		{
+			const auto storedRange = GetRange( current.plane,rect );
+			storedNearest = Format::Encode( storedRange.first );
+			storedFarthest = Format::Encode( storedRange.second );
+		}
+		// encoding is monotonic, so comparing the extremes settles every pixel
+		if( Format::Closer( Format::Encode( range.second ),storedNearest ) )
+		{
+			current.plane = plane;
+			current.epoch = clearEpochs.GetEpoch();
+			return TileTest::Visible;
+		}
+		if( !Format::Closer( Format::Encode( range.first ),storedFarthest ) )
+		{
+			return TileTest::Hidden;
+		}
+		return TileTest::Partial;
+	}
 	int GetWidth() const
 	{
 		return width;
@@ -58,12 +145,88 @@ public:
 	{
 		return height;
 	}
-	auto GetMinMax() const
+	// nearest and farthest depth in the buffer
+	std::pair<float,float> GetMinMax() const
 	{
-		return std::minmax_element( pBuffer,pBuffer + width * height );
+		auto& self = *const_cast<DepthBuffer*>(this);
+		self.clearEpochs.ResolveAll( [&self]( const RectI& tile )
+		{
+			self.ResolveTile( self.clearEpochs.GetTileIndex( tile.left,tile.top ) );
+		} );
+		std::pair<float,float> minMax = { std::numeric_limits<float>::infinity(),-std::numeric_limits<float>::infinity() };
+		for( int i = 0; i < width * height; i++ )
+		{
+			const float d = Format::Decode( pBuffer[i] );
+			minMax.first = std::min( minMax.first,d );
+			minMax.second = std::max( minMax.second,d );
+		}
+		return minMax;
+	}
+private:
+	struct PlaneTile
+	{
+		DepthPlane plane = {};
+		// valid while equal to the current clear epoch
+		unsigned int epoch = 0u;
+	};
+private:
+	// nearest and farthest depth of the plane over the pixel centers of the rect
+	static std::pair<float,float> GetRange( const DepthPlane& plane,const RectI& rect )
+	{
+		const float d0 = plane.At( rect.left,rect.top );
+		const float d1 = plane.At( rect.right - 1,rect.top );
+		const float d2 = plane.At( rect.left,rect.bottom - 1 );
+		const float d3 = plane.At( rect.right - 1,rect.bottom - 1 );
+		const float lo = std::min( std::min( d0,d1 ),std::min( d2,d3 ) );
+		const float hi = std::max( std::max( d0,d1 ),std::max( d2,d3 ) );
+		if constexpr( Format::reversed )
+		{
+			return { hi,lo };
+		}
+		else
+		{
+			return { lo,hi };
+		}
+	}
+	// writes out the pixels of a tile that was stale (clear value) or held a plane
+	void ResolveTile( int tile )
+	{
+		const RectI rect = clearEpochs.GetTileRect(
+			(tile % clearEpochs.GetTilesX()) << tileShift,
+			(tile / clearEpochs.GetTilesX()) << tileShift );
+		PlaneTile& planeTile = planes[tile];
+		if( planeTile.epoch == clearEpochs.GetEpoch() )
+		{
+			planeTile.epoch = 0u;
+			for( int y = rect.top; y < rect.bottom; y++ )
+			{
+				for( int x = rect.left; x < rect.right; x++ )
+				{
+					pBuffer[y * width + x] = Format::Encode( planeTile.plane.At( x,y ) );
+				}
+			}
+			return;
+		}
+		for( int y = rect.top; y < rect.bottom; y++ )
+		{
+			Stored* const pRow = &pBuffer[y * width + rect.left];
+			if constexpr( sizeof( Stored ) == 4u )
+			{
+				Fill32( pRow,size_t( rect.GetWidth() ),Format::Far() );
+			}
+			else
+			{
+				std::fill_n( pRow,rect.GetWidth(),Format::Far() );
+			}
+		}
 	}
 private:
 	int width;
 	int height;
-	float* pBuffer = nullptr;
-};
\ No newline at end of file
+	Stored* pBuffer = nullptr;
+	TileEpochs clearEpochs;
+	std::vector<PlaneTile> planes;
+};
+
+// the default depth buffer
+typedef DepthBuffer<DepthFloat32> ZBuffer;
\ No newline at end of file
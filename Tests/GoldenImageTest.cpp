@@ -0,0 +1,382 @@
+// golden image regression test: renders every scene on the headless Graphics
+// with scripted camera input and a fixed time step, compares the frames at fixed
+// times against the reference images in the golden directory, and checks the
+// fragment count of every scene against its budget, the frame time is only
+// reported since it depends on the machine and its load
+// (--update renders new references and writes the budgets from the measurements)
+// the references in Tests/golden were rendered by the renderer as it was before
+// the optimizations, with only the intended changes to the output applied (see
+// the git log of Tests/golden), --update replaces them with what this tree renders,
+// so only use it for a change that is meant to alter the frames
+#include "../Engine/Graphics.h"
+#include "../Engine/Scenes.h"
+#include "../Engine/InputScript.h"
+#include "../Engine/PipelineStats.h"
+#include "../Engine/ChiliException.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::duration<double,std::milli> Millis;
+
+	// frames compared against the references (a second apart at 60 fps), the
+	// input script spans all of them plus the timed frames
+	constexpr unsigned int captureFrames[] = { 0u,60u,120u };
+	constexpr unsigned int nCaptureRun = 121u;
+	constexpr unsigned int nTimedFrames = 60u;
+	constexpr float dt = 1.0f / 60.0f;
+	// budgets written by --update leave this much room over the measurements
+	constexpr double fragmentBudgetMargin = 1.02;
+
+	struct Options
+	{
+		std::filesystem::path golden;
+		std::filesystem::path diff;
+		std::string scene;
+		bool checkImages = true;
+		bool checkBudgets = true;
+		bool update = false;
+		// a pixel differs if any channel is off by more than this
+		int tolerance = 2;
+		// fraction of the pixels that may differ
+		double maxDiffering = 0.001;
+	};
+
+	void PrintUsage()
+	{
+		std::cout <<
+			"usage: golden_image_test --golden <dir> [options]\n"
+			"  --golden <dir>        reference images and budgets.txt\n"
+			"  --check <what>        images, budgets or all (default)\n"
+			"  --update              render new references and budgets instead of checking\n"
+			"  --scene <index|name>  only this scene\n"
+			"  --tolerance <n>       channel difference a pixel may have (2)\n"
+			"  --max-differing <f>   fraction of the pixels that may differ (0.001)\n"
+			"  --diff <dir>          where the frames that failed go (current directory)\n"
+			"  --data <dir>          directory the asset paths are relative to\n";
+	}
+
+	// scene name as a file name
+	std::string GetKey( const std::string& name )
+	{
+		std::string key;
+		for( const char c : name )
+		{
+			key.push_back( std::isalnum( (unsigned char)c ) ? c : '_' );
+		}
+		return key;
+	}
+
+	std::filesystem::path GetImagePath( const std::filesystem::path& dir,const std::string& key,unsigned int frame )
+	{
+		return dir / (key + "_" + std::to_string( frame ) + ".png");
+	}
+
+	// budgets.txt: one "<scene key> <fragments per frame>" line per scene, # comments
+	std::map<std::string,unsigned long long> LoadBudgets( const std::filesystem::path& filename )
+	{
+		std::map<std::string,unsigned long long> budgets;
+		std::ifstream file( filename );
+		std::string line;
+		while( std::getline( file,line ) )
+		{
+			if( line.empty() || line[0] == '#' )
+			{
+				continue;
+			}
+			std::istringstream ss( line );
+			std::string key;
+			unsigned long long budget;
+			if( ss >> key >> budget )
+			{
+				budgets[key] = budget;
+			}
+		}
+		return budgets;
+	}
+
+	void SaveBudgets( const std::filesystem::path& filename,const std::map<std::string,unsigned long long>& budgets )
+	{
+		std::ofstream file( filename );
+		file << "# <scene> <max fragments rasterized per frame>\n"
+			"# written by golden_image_test --update: " << fragmentBudgetMargin << "x the measured count\n";
+		for( const auto& b : budgets )
+		{
+			file << b.first << " " << b.second << "\n";
+		}
+		if( !file )
+		{
+			throw std::runtime_error( "cannot write " + filename.string() );
+		}
+	}
+
+	// runs the frames of Game::Go back to back, returns the time of each frame
+	std::vector<double> RunFrames( Graphics& gfx,Scene& scene,const InputScript& script,unsigned int firstFrame,unsigned int nFrames,Keyboard& kbd,Mouse& mouse )
+	{
+		std::vector<double> frameTimes;
+		auto last = std::chrono::steady_clock::now();
+		for( unsigned int i = 0; i < nFrames; i++ )
+		{
+			script.Apply( firstFrame + i,kbd,mouse );
+			scene.Update( kbd,mouse,dt );
+			scene.Interpolate( 1.0f );
+			gfx.BeginFrame();
+			scene.Draw();
+			gfx.EndFrame();
+			if( i + 1u == nFrames )
+			{
+				gfx.Flush();
+			}
+			const auto now = std::chrono::steady_clock::now();
+			frameTimes.push_back( Millis( now - last ).count() );
+			last = now;
+		}
+		return frameTimes;
+	}
+
+	// pixels of frame that differ from reference by more than tolerance, marked red in diff
+	size_t Compare( const Surface& frame,const Surface& reference,int tolerance,Surface& diff )
+	{
+		size_t nDiffering = 0u;
+		for( unsigned int y = 0u; y < frame.GetHeight(); y++ )
+		{
+			for( unsigned int x = 0u; x < frame.GetWidth(); x++ )
+			{
+				const Color a = frame.GetPixel( x,y );
+				const Color b = reference.GetPixel( x,y );
+				const int d = std::max( { std::abs( a.GetR() - b.GetR() ),std::abs( a.GetG() - b.GetG() ),std::abs( a.GetB() - b.GetB() ) } );
+				if( d > tolerance )
+				{
+					nDiffering++;
+					diff.PutPixel( x,y,Colors::Red );
+				}
+				else
+				{
+					// the frame dimmed, for orientation
+					diff.PutPixel( x,y,{ (unsigned char)(a.GetR() / 4),(unsigned char)(a.GetG() / 4),(unsigned char)(a.GetB() / 4) } );
+				}
+			}
+		}
+		return nDiffering;
+	}
+}
+
+int main( int argc,char** argv )
+{
+	Options opts;
+	std::string dataDir;
+	for( int i = 1; i < argc; i++ )
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		// paths are made absolute before changing to the data directory
+		if( arg == "--golden" && hasValue )
+		{
+			opts.golden = std::filesystem::absolute( argv[++i] );
+		}
+		else if( arg == "--diff" && hasValue )
+		{
+			opts.diff = std::filesystem::absolute( argv[++i] );
+		}
+		else if( arg == "--check" && hasValue )
+		{
+			const std::string what = argv[++i];
+			opts.checkImages = what == "images" || what == "all";
+			opts.checkBudgets = what == "budgets" || what == "all";
+		}
+		else if( arg == "--update" )
+		{
+			opts.update = true;
+		}
+		else if( arg == "--scene" && hasValue )
+		{
+			opts.scene = argv[++i];
+		}
+		else if( arg == "--tolerance" && hasValue )
+		{
+			opts.tolerance = std::atoi( argv[++i] );
+		}
+		else if( arg == "--max-differing" && hasValue )
+		{
+			opts.maxDiffering = std::strtod( argv[++i],nullptr );
+		}
+		else if( arg == "--data" && hasValue )
+		{
+			dataDir = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+	if( opts.golden.empty() || (!opts.checkImages && !opts.checkBudgets) )
+	{
+		PrintUsage();
+		return 1;
+	}
+	if( opts.diff.empty() )
+	{
+		opts.diff = std::filesystem::current_path();
+	}
+
+	try
+	{
+		if( !dataDir.empty() )
+		{
+			std::filesystem::current_path( dataDir );
+		}
+		const auto budgetsFile = opts.golden / "budgets.txt";
+		auto budgets = LoadBudgets( budgetsFile );
+		Graphics gfx;
+		// the frames to compare, copied off the present thread (read after Flush)
+		std::map<unsigned int,Surface> captured;
+		unsigned int firstCapture = 0u;
+		gfx.SetFrameOutput( [&]( const Surface& frame,unsigned int index )
+		{
+			const unsigned int frameInRun = index - firstCapture;
+			if( std::find( std::begin( captureFrames ),std::end( captureFrames ),frameInRun ) != std::end( captureFrames ) )
+			{
+				Surface copy( frame.GetWidth(),frame.GetHeight() );
+				copy.Copy( frame );
+				captured.emplace( frameInRun,std::move( copy ) );
+			}
+		} );
+		auto scenes = MakeScenes( gfx );
+		unsigned int nFailed = 0u;
+		bool found = false;
+		for( size_t s = 0; s < scenes.size(); s++ )
+		{
+			Scene& scene = *scenes[s];
+			if( !opts.scene.empty() && opts.scene != std::to_string( s ) && opts.scene != scene.GetName() )
+			{
+				continue;
+			}
+			found = true;
+			const std::string key = GetKey( scene.GetName() );
+			Keyboard kbd;
+			Mouse mouse;
+			const auto script = InputScript::Flythrough( nCaptureRun + nTimedFrames );
+
+			captured.clear();
+			firstCapture = gfx.GetFrameCount();
+			RunFrames( gfx,scene,script,0u,nCaptureRun,kbd,mouse );
+			if( opts.update || opts.checkImages )
+			{
+				for( const unsigned int frame : captureFrames )
+				{
+					const Surface& image = captured.at( frame );
+					const auto path = GetImagePath( opts.golden,key,frame );
+					if( opts.update )
+					{
+						image.Save( path.wstring() );
+						std::printf( "%-40s frame %3u: written %s\n",scene.GetName().c_str(),frame,path.string().c_str() );
+						continue;
+					}
+					if( !std::filesystem::exists( path ) )
+					{
+						std::printf( "%-40s frame %3u: FAILED, no reference %s (run with --update)\n",scene.GetName().c_str(),frame,path.string().c_str() );
+						nFailed++;
+						continue;
+					}
+					const Surface reference = Surface::FromFile( path.wstring() );
+					if( reference.GetWidth() != image.GetWidth() || reference.GetHeight() != image.GetHeight() )
+					{
+						std::printf( "%-40s frame %3u: FAILED, reference is %ux%u\n",scene.GetName().c_str(),frame,reference.GetWidth(),reference.GetHeight() );
+						nFailed++;
+						continue;
+					}
+					Surface diff( image.GetWidth(),image.GetHeight() );
+					const size_t nDiffering = Compare( image,reference,opts.tolerance,diff );
+					const double fraction = double( nDiffering ) / double( size_t( image.GetWidth() ) * image.GetHeight() );
+					const bool passed = fraction <= opts.maxDiffering;
+					std::printf( "%-40s frame %3u: %s, %zu pixels differ (%.4f%%)\n",scene.GetName().c_str(),frame,
+						passed ? "ok" : "FAILED",nDiffering,fraction * 100.0 );
+					if( !passed )
+					{
+						nFailed++;
+						const auto actual = GetImagePath( opts.diff,key + "_actual",frame );
+						const auto marked = GetImagePath( opts.diff,key + "_diff",frame );
+						image.Save( actual.wstring() );
+						diff.Save( marked.wstring() );
+						std::printf( "  frame written to %s, differing pixels marked in %s\n",actual.string().c_str(),marked.string().c_str() );
+					}
+				}
+			}
+
+			if( opts.update || opts.checkBudgets )
+			{
+				PipelineStats::Get().Reset();
+				auto frameTimes = RunFrames( gfx,scene,script,nCaptureRun,nTimedFrames,kbd,mouse );
+				unsigned long long fragments = 0u;
+				for( const auto& e : PipelineStats::Get().Collect() )
+				{
+					fragments += e.counters.fragments;
+				}
+				std::sort( frameTimes.begin(),frameTimes.end() );
+				const double msPerFrame = frameTimes[frameTimes.size() / 2u];
+				const unsigned long long fragmentsPerFrame = fragments / nTimedFrames;
+				if( opts.update )
+				{
+					budgets[key] = (unsigned long long)(double( fragmentsPerFrame ) * fragmentBudgetMargin);
+					std::printf( "%-40s budget: %llu fragments per frame (%.3f ms per frame)\n",scene.GetName().c_str(),
+						budgets[key],msPerFrame );
+					continue;
+				}
+				const auto b = budgets.find( key );
+				if( b == budgets.end() )
+				{
+					std::printf( "%-40s budget: FAILED, no budget for %s in %s (run with --update)\n",scene.GetName().c_str(),key.c_str(),budgetsFile.string().c_str() );
+					nFailed++;
+					continue;
+				}
+				// the time is only reported, the fragment count doesn't depend on the machine
+				const bool fragmentsOk = fragmentsPerFrame <= b->second;
+				std::printf( "%-40s budget: %s, %llu fragments per frame (budget %llu), %.3f ms per frame\n",
+					scene.GetName().c_str(),fragmentsOk ? "ok" : "FAILED",
+					fragmentsPerFrame,b->second,msPerFrame );
+				if( !fragmentsOk )
+				{
+					nFailed++;
+				}
+			}
+		}
+		if( !found )
+		{
+			std::cerr << "no scene [" << opts.scene << "]\n";
+			return 1;
+		}
+		if( opts.update )
+		{
+			SaveBudgets( budgetsFile,budgets );
+			return 0;
+		}
+		if( nFailed > 0u )
+		{
+			std::printf( "%u checks failed\n",nFailed );
+			return 1;
+		}
+	}
+	catch( const ChiliException& e )
+	{
+		std::wcerr << e.GetExceptionType() << L": " << e.GetFullMessage() << std::endl;
+		return 1;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "Unhandled STL Exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
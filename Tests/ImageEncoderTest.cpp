@@ -0,0 +1,171 @@
+// png encoder round trip: encodes synthetic surfaces that hit the different
+// paths of the deflater (noise that stays literal, flat runs of long matches,
+// repeats further apart than the window, odd sizes) and every image in the
+// Images directory, decodes them with ImageDecoder and expects the exact rgb
+#include "../Engine/ImageEncoder.h"
+#include "../Engine/ImageDecoder.h"
+#include "../Engine/Surface.h"
+#include "../Engine/ChiliException.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// pixels whose rgb differs after the round trip, or ~0u if the png didn't decode
+	unsigned int RoundTrip( const Surface& surface,size_t& pngSize )
+	{
+		const auto png = ImageEncoder::EncodePng( surface.GetBufferPtrConst(),surface.GetWidth(),surface.GetHeight(),surface.GetPitch() );
+		pngSize = png.size();
+		ImageDecoder::Image image;
+		if( !ImageDecoder::Decode( png.data(),png.size(),image ) ||
+			image.width != surface.GetWidth() || image.height != surface.GetHeight() )
+		{
+			return ~0u;
+		}
+		unsigned int nDiffering = 0u;
+		for( unsigned int y = 0; y < image.height; y++ )
+		{
+			for( unsigned int x = 0; x < image.width; x++ )
+			{
+				const Color expected = surface.GetPixel( x,y );
+				const Color actual = image.pPixels[size_t( y ) * image.width + x];
+				if( actual.GetR() != expected.GetR() || actual.GetG() != expected.GetG() ||
+					actual.GetB() != expected.GetB() || actual.GetA() != 255u )
+				{
+					nDiffering++;
+				}
+			}
+		}
+		return nDiffering;
+	}
+
+	struct Case
+	{
+		std::string name;
+		Surface surface;
+	};
+
+	std::vector<Case> MakeSynthetic()
+	{
+		std::vector<Case> cases;
+		std::mt19937 rng( 7u );
+		const auto Fill = [&]( const char* name,unsigned int width,unsigned int height,auto f )
+		{
+			Surface s( width,height );
+			for( unsigned int y = 0; y < height; y++ )
+			{
+				for( unsigned int x = 0; x < width; x++ )
+				{
+					s.PutPixel( x,y,f( x,y ) );
+				}
+			}
+			cases.push_back( { name,std::move( s ) } );
+		};
+		Fill( "1x1",1u,1u,[]( unsigned int,unsigned int ) { return Color( 12u,34u,56u ); } );
+		Fill( "flat 640x480",640u,480u,[]( unsigned int,unsigned int ) { return Colors::Red; } );
+		Fill( "gradient 257x3",257u,3u,[]( unsigned int x,unsigned int y )
+		{
+			return Color( (unsigned char)x,(unsigned char)(x * y),(unsigned char)(255u - x) );
+		} );
+		Fill( "noise 640x480",640u,480u,[&]( unsigned int,unsigned int )
+		{
+			return Color( (unsigned char)rng(),(unsigned char)rng(),(unsigned char)rng() );
+		} );
+		// rows of noise repeated every 16 rows (30 KB apart) and every 40 (75 KB,
+		// past the 32 KB window)
+		std::vector<Color> noiseRows( 640u * 40u );
+		for( auto& c : noiseRows )
+		{
+			c = Color( (unsigned char)rng(),(unsigned char)rng(),(unsigned char)rng() );
+		}
+		Fill( "repeats 640x480",640u,480u,[&]( unsigned int x,unsigned int y )
+		{
+			return y < 240u ? noiseRows[(y % 16u) * 640u + x] : noiseRows[(y % 40u) * 640u + x];
+		} );
+		// alpha is dropped by the encoder
+		Fill( "alpha 33x17",33u,17u,[]( unsigned int x,unsigned int y )
+		{
+			return Color( (unsigned char)x,(unsigned char)(x * y),(unsigned char)(x * 7u),(unsigned char)(y * 13u) );
+		} );
+		return cases;
+	}
+}
+
+int main( int argc,char** argv )
+{
+#ifdef CHILI_ASSET_DIR
+	std::string dataDir = CHILI_ASSET_DIR;
+#else
+	std::string dataDir = ".";
+#endif
+	if( argc == 3 && std::string( argv[1] ) == "--data" )
+	{
+		dataDir = argv[2];
+	}
+	else if( argc != 1 )
+	{
+		std::cout << "usage: image_encoder_test [--data <dir that holds Images>]\n";
+		return 1;
+	}
+
+	try
+	{
+		auto cases = MakeSynthetic();
+		std::vector<std::filesystem::path> images;
+		for( const auto& entry : std::filesystem::directory_iterator( std::filesystem::path( dataDir ) / "Images" ) )
+		{
+			if( entry.is_regular_file() )
+			{
+				images.push_back( entry.path() );
+			}
+		}
+		std::sort( images.begin(),images.end() );
+		for( const auto& path : images )
+		{
+			cases.push_back( { path.filename().string(),Surface::FromFile( path.wstring() ) } );
+		}
+
+		unsigned int nFailed = 0u;
+		for( const auto& c : cases )
+		{
+			size_t pngSize = 0u;
+			const unsigned int nDiffering = RoundTrip( c.surface,pngSize );
+			const double raw = double( c.surface.GetWidth() ) * c.surface.GetHeight() * 3.0;
+			if( nDiffering == ~0u )
+			{
+				std::printf( "%-28s FAILED: does not decode\n",c.name.c_str() );
+			}
+			else
+			{
+				std::printf( "%-28s %9zu bytes (%5.1f%% of rgb) %s",c.name.c_str(),pngSize,
+					double( pngSize ) * 100.0 / raw,nDiffering == 0u ? "ok\n" : "FAILED: " );
+				if( nDiffering > 0u )
+				{
+					std::printf( "%u pixels differ\n",nDiffering );
+				}
+			}
+			nFailed += nDiffering != 0u ? 1u : 0u;
+		}
+		if( nFailed > 0u )
+		{
+			std::printf( "%u of %zu images did not survive the round trip\n",nFailed,cases.size() );
+			return 1;
+		}
+	}
+	catch( const ChiliException& e )
+	{
+		std::wcerr << e.GetExceptionType() << L": " << e.GetFullMessage() << std::endl;
+		return 1;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "Unhandled STL Exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}